@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+/// Number of global `operator new` calls made by all threads so far. Allocations are counted by the replaced
+/// allocation functions defined next to this function, so only the programs using it, i.e. benchmarks, pay for that.
+size_t allocation_count() noexcept;
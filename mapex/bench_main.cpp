@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRectF>
+#include <QtCore/QThreadPool>
+
+#include <portable_concurrency/future>
+
+#include <mapex/generalization.hpp>
+#include <mapex/geo_point.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/poidb.hpp>
+#include <mapex/projection.hpp>
+
+namespace {
+
+constexpr geo_point nsk_center = {82.947932_lon, 54.988053_lat};
+
+struct sweep_options {
+  QPointF center;
+  QSizeF viewport;
+  int frames = 0;
+  int step = 0;
+};
+
+struct zoom_result {
+  int z_level = 0;
+  std::vector<double> latencies_ms;
+  generalization_work work;
+  size_t markers = 0;
+};
+
+// Nearest-rank percentile of the sorted `values`
+double percentile(const std::vector<double>& values, double p) {
+  if (values.empty())
+    return 0;
+  const size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+  return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+// Low z-level viewports are larger than the world and queries must not leave it
+QPointF clamped(QPointF pt) noexcept {
+  const QPointF world_max = pointf_from_point({~uint32_t{0}, ~uint32_t{0}});
+  return {std::clamp(pt.x(), 0., world_max.x()), std::clamp(pt.y(), 0., world_max.y())};
+}
+
+// Pans the viewport diagonally through the `center` by `step` pixels per frame. Markers are requested the same way as
+// the tile widget does: an area twice as large as the viewport is generalized once the viewport leaves the previous
+// one. Every query is waited for before the next frame so no query is cancelled.
+zoom_result run_sweep(const poidb& db, int z_level, const sweep_options& opts) {
+  zoom_result res;
+  res.z_level = z_level;
+  const double px_size = 1. / (double{1 << tile_pixel_size_log2} * (1 << z_level));
+  QRectF vp_rect{{}, opts.viewport * px_size};
+  QRectF area;
+  const generalization_work before = db.work_stats();
+  for (int frame = -opts.frames / 2; frame < opts.frames - opts.frames / 2; ++frame) {
+    const double shift = static_cast<double>(opts.step) * frame * px_size;
+    vp_rect.moveCenter(clamped(opts.center + QPointF{shift, shift}));
+    if (area.contains(vp_rect))
+      continue;
+    area.setSize(2 * vp_rect.size());
+    area.moveCenter(vp_rect.center());
+    const auto start = std::chrono::steady_clock::now();
+    res.markers += db.generalize({clamped(area.topLeft()), clamped(area.bottomRight())}, z_level).get().size();
+    res.latencies_ms.push_back(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+  const generalization_work after = db.work_stats();
+  res.work.queries = after.queries - before.queries;
+  res.work.cancelled = after.cancelled - before.cancelled;
+  res.work.keys_scanned = after.keys_scanned - before.keys_scanned;
+  res.work.wasted_keys_scanned = after.wasted_keys_scanned - before.wasted_keys_scanned;
+  res.work.bigmin_jumps = after.bigmin_jumps - before.bigmin_jumps;
+  std::sort(res.latencies_ms.begin(), res.latencies_ms.end());
+  return res;
+}
+
+QJsonObject to_json(const zoom_result& res) {
+  return {{QStringLiteral("z_level"), res.z_level}, {QStringLiteral("queries"), static_cast<qint64>(res.work.queries)},
+      {QStringLiteral("latency_ms"),
+          QJsonObject{{QStringLiteral("p50"), percentile(res.latencies_ms, 0.5)},
+              {QStringLiteral("p99"), percentile(res.latencies_ms, 0.99)},
+              {QStringLiteral("max"), res.latencies_ms.empty() ? 0. : res.latencies_ms.back()}}},
+      {QStringLiteral("keys_scanned"), static_cast<qint64>(res.work.keys_scanned)},
+      {QStringLiteral("bigmin_jumps"), static_cast<qint64>(res.work.bigmin_jumps)},
+      {QStringLiteral("markers"), static_cast<qint64>(res.markers)}};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app{argc, argv};
+  QCoreApplication::setApplicationName(QStringLiteral("mapex-bench"));
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      QStringLiteral("Runs scripted viewport sweeps over poi.bin and reports generalization stats as JSON"));
+  parser.addHelpOption();
+  parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("poi.bin file to load"));
+  const QCommandLineOption index_opt{QStringLiteral("index"),
+      QStringLiteral("POI index: pyramid, prefix_sums, blocks or quantized"), QStringLiteral("index"),
+      QStringLiteral("pyramid")};
+  const QCommandLineOption curve_opt{QStringLiteral("curve"), QStringLiteral("Key curve: morton or hilbert"),
+      QStringLiteral("curve"), QStringLiteral("morton")};
+  const QCommandLineOption threads_opt{
+      QStringLiteral("threads"), QStringLiteral("Number of worker threads"), QStringLiteral("count")};
+  const QCommandLineOption center_opt{QStringLiteral("center"), QStringLiteral("Sweep center as lat,lon"),
+      QStringLiteral("lat,lon"), QStringLiteral("%1,%2").arg(double(nsk_center.lat)).arg(double(nsk_center.lon))};
+  const QCommandLineOption min_zoom_opt{
+      QStringLiteral("min-zoom"), QStringLiteral("First z-level"), QStringLiteral("z"), QStringLiteral("0")};
+  const QCommandLineOption max_zoom_opt{QStringLiteral("max-zoom"), QStringLiteral("Last z-level"),
+      QStringLiteral("z"), QString::number(max_z_level)};
+  const QCommandLineOption viewport_opt{QStringLiteral("viewport"), QStringLiteral("Viewport size in pixels"),
+      QStringLiteral("WxH"), QStringLiteral("1920x1080")};
+  const QCommandLineOption frames_opt{QStringLiteral("frames"), QStringLiteral("Pan frames per z-level"),
+      QStringLiteral("count"), QStringLiteral("200")};
+  const QCommandLineOption step_opt{QStringLiteral("step"), QStringLiteral("Pan distance per frame in pixels"),
+      QStringLiteral("px"), QStringLiteral("64")};
+  const QCommandLineOption cache_opt{QStringLiteral("cache"),
+      QStringLiteral("Generalization cache budget in MiB, 0 disables caching"), QStringLiteral("MiB")};
+  const QCommandLineOption output_opt{
+      QStringLiteral("output"), QStringLiteral("JSON file to write instead of stdout"), QStringLiteral("file")};
+  parser.addOptions({index_opt, curve_opt, threads_opt, center_opt, min_zoom_opt, max_zoom_opt, viewport_opt,
+      frames_opt, step_opt, cache_opt, output_opt});
+  parser.process(app);
+
+  const QStringList args = parser.positionalArguments();
+  if (args.size() != 1)
+    parser.showHelp(1);
+  if (!QFileInfo::exists(args[0])) {
+    std::fprintf(stderr, "can't open %s\n", qUtf8Printable(args[0]));
+    return 1;
+  }
+
+  const QString index_name = parser.value(index_opt);
+  poi_index index = poi_index::pyramid;
+  if (index_name == QLatin1String("prefix_sums"))
+    index = poi_index::prefix_sums;
+  else if (index_name == QLatin1String("blocks"))
+    index = poi_index::blocks;
+  else if (index_name == QLatin1String("quantized"))
+    index = poi_index::quantized;
+  else if (index_name != QLatin1String("pyramid")) {
+    std::fprintf(stderr, "unknown index: %s\n", qUtf8Printable(index_name));
+    return 1;
+  }
+  const QString curve = parser.value(curve_opt);
+  if (curve != QLatin1String("morton") && curve != QLatin1String("hilbert")) {
+    std::fprintf(stderr, "unknown curve: %s\n", qUtf8Printable(curve));
+    return 1;
+  }
+  if (parser.isSet(threads_opt))
+    QThreadPool::globalInstance()->setMaxThreadCount(parser.value(threads_opt).toInt());
+
+  sweep_options opts;
+  const QStringList center = parser.value(center_opt).split(QLatin1Char(','));
+  bool lat_valid = false;
+  bool lon_valid = false;
+  if (center.size() == 2) {
+    opts.center = project({longitude{center[1].toDouble(&lon_valid)}, lattitude{center[0].toDouble(&lat_valid)}});
+  }
+  if (!lat_valid || !lon_valid || !is_projectable(opts.center)) {
+    std::fprintf(stderr, "invalid center: %s\n", qUtf8Printable(parser.value(center_opt)));
+    return 1;
+  }
+  const QStringList viewport = parser.value(viewport_opt).split(QLatin1Char('x'));
+  bool width_valid = false;
+  bool height_valid = false;
+  if (viewport.size() == 2)
+    opts.viewport = {viewport[0].toDouble(&width_valid), viewport[1].toDouble(&height_valid)};
+  if (!width_valid || !height_valid || opts.viewport.isEmpty()) {
+    std::fprintf(stderr, "invalid viewport: %s\n", qUtf8Printable(parser.value(viewport_opt)));
+    return 1;
+  }
+  bool frames_valid = false;
+  bool step_valid = false;
+  opts.frames = parser.value(frames_opt).toInt(&frames_valid);
+  opts.step = parser.value(step_opt).toInt(&step_valid);
+  if (!frames_valid || !step_valid || opts.frames <= 0) {
+    std::fprintf(stderr, "invalid pan script\n");
+    return 1;
+  }
+  bool zoom_valid = true;
+  const int min_zoom = parser.value(min_zoom_opt).toInt(&zoom_valid);
+  const int max_zoom = zoom_valid ? parser.value(max_zoom_opt).toInt(&zoom_valid) : 0;
+  if (!zoom_valid || min_zoom < 0 || max_zoom > max_z_level || min_zoom > max_zoom) {
+    std::fprintf(stderr, "invalid z-level range\n");
+    return 1;
+  }
+
+  poidb db{index, curve == QLatin1String("hilbert") ? key_curve::hilbert : key_curve::morton};
+  if (parser.isSet(cache_opt)) {
+    bool valid = false;
+    const size_t budget = static_cast<size_t>(parser.value(cache_opt).toULongLong(&valid)) << 20;
+    if (!valid) {
+      std::fprintf(stderr, "invalid cache budget\n");
+      return 1;
+    }
+    db.set_cache_budget(budget);
+  }
+
+  // POI are loaded on the pool and reported through the event loop
+  const auto load_start = std::chrono::steady_clock::now();
+  QObject::connect(&db, &poidb::updated, &app, &QCoreApplication::quit);
+  db.load(args[0]);
+  app.exec();
+  const std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - load_start;
+
+  QJsonArray zoom_levels;
+  for (int z_level = min_zoom; z_level <= max_zoom; ++z_level)
+    zoom_levels.append(to_json(run_sweep(db, z_level, opts)));
+
+  const QJsonObject report{{QStringLiteral("input"), args[0]}, {QStringLiteral("index"), index_name},
+      {QStringLiteral("curve"), curve}, {QStringLiteral("threads"), QThreadPool::globalInstance()->maxThreadCount()},
+      {QStringLiteral("viewport"),
+          QJsonObject{{QStringLiteral("width"), opts.viewport.width()},
+              {QStringLiteral("height"), opts.viewport.height()}}},
+      {QStringLiteral("frames"), opts.frames}, {QStringLiteral("step"), opts.step},
+      {QStringLiteral("load_seconds"), load_time.count()}, {QStringLiteral("zoom_levels"), zoom_levels}};
+  const QByteArray json = QJsonDocument{report}.toJson();
+
+  if (!parser.isSet(output_opt)) {
+    std::fwrite(json.constData(), 1, json.size(), stdout);
+    return 0;
+  }
+  QFile out{parser.value(output_opt)};
+  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(json) != json.size()) {
+    std::fprintf(stderr, "can't write %s\n", qUtf8Printable(out.fileName()));
+    return 1;
+  }
+  return 0;
+}
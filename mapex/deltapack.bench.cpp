@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/key_blocks.hpp>
+
+namespace {
+
+enum class codec { varint, varint_pull, scalar, ssse3, avx2, blocks_pull };
+
+// Decoding is repeated at least for this time to get stable throughput numbers
+constexpr std::chrono::milliseconds min_measure_time{200};
+
+} // namespace
+
+Q_DECLARE_METATYPE(codec);
+
+class deltapack_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  void decode(codec c, size_t count, uint64_t* keys) {
+    switch (c) {
+    case codec::varint:
+      delta::unpack(varint_.begin(), varint_.end(), keys);
+      break;
+    case codec::varint_pull: {
+      delta::decoder decoder{varint_.begin(), varint_.end()};
+      while (const auto key = decoder.next())
+        *keys++ = *key;
+      break;
+    }
+    case codec::scalar:
+      stream_vbyte::unpack_delta(stream_vbyte::kernel::scalar, svb_.data(), svb_.data() + svb_.size(), count, keys);
+      break;
+    case codec::ssse3:
+      stream_vbyte::unpack_delta(stream_vbyte::kernel::ssse3, svb_.data(), svb_.data() + svb_.size(), count, keys);
+      break;
+    case codec::avx2:
+      stream_vbyte::unpack_delta(stream_vbyte::kernel::avx2, svb_.data(), svb_.data() + svb_.size(), count, keys);
+      break;
+    case codec::blocks_pull: {
+      key_blocks::decoder decoder{blocks_};
+      while (const auto key = decoder.next())
+        *keys++ = *key;
+      break;
+    }
+    }
+  }
+
+private slots:
+  void decode_throughput_data() {
+    QTest::addColumn<codec>("decoder");
+    QTest::addColumn<int>("size_log2");
+    QTest::addColumn<int>("spread_log2");
+
+    // Spread is the range of random keys: full 64 bit range gives 5-6 bytes differences while 48 bit range gives
+    // mostly 3 bytes differences for the biggest sample
+    const std::pair<const char*, codec> codecs[] = {{"varint", codec::varint}, {"varint_pull", codec::varint_pull},
+        {"scalar", codec::scalar}, {"ssse3", codec::ssse3}, {"avx2", codec::avx2}, {"blocks_pull", codec::blocks_pull}};
+    for (auto [name, c] : codecs) {
+      for (int size_log2 : {16, 22}) {
+        for (int spread_log2 : {48, 64})
+          QTest::addRow("%s/2^%d/spread2^%d", name, size_log2, spread_log2) << c << size_log2 << spread_log2;
+      }
+    }
+  }
+  // Reports the size of decoded keys per second
+  void decode_throughput() {
+    QFETCH(codec, decoder);
+    QFETCH(int, size_log2);
+    QFETCH(int, spread_log2);
+    if ((decoder == codec::ssse3 && !stream_vbyte::is_supported(stream_vbyte::kernel::ssse3)) ||
+        (decoder == codec::avx2 && !stream_vbyte::is_supported(stream_vbyte::kernel::avx2)))
+      QSKIP("Kernel is not supported by this CPU");
+
+    std::uniform_int_distribution<uint64_t> dist{0, ~uint64_t{0} >> (64 - spread_log2)};
+    std::vector<uint64_t> keys(size_t{1} << size_log2);
+    std::generate(keys.begin(), keys.end(), [&] { return dist(rnd_engine_); });
+    std::sort(keys.begin(), keys.end());
+    varint_.clear();
+    delta::pack(keys.begin(), keys.end(), std::back_inserter(varint_));
+    svb_.resize(stream_vbyte::max_encoded_size(keys.size()));
+    svb_.resize(stream_vbyte::pack_delta(keys.data(), keys.size(), svb_.data()));
+    blocks_ = key_blocks{keys};
+
+    std::vector<uint64_t> decoded(keys.size());
+    size_t iterations = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = start - start;
+    for (; elapsed < min_measure_time; elapsed = std::chrono::steady_clock::now() - start, ++iterations)
+      decode(decoder, keys.size(), decoded.data());
+    QVERIFY(decoded == keys);
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    QTest::setBenchmarkResult(iterations * keys.size() * sizeof(uint64_t) / seconds, QTest::BytesPerSecond);
+  }
+
+  void count_keys_below_data() {
+    QTest::addColumn<bool>("pull");
+    QTest::addColumn<int>("percent");
+
+    for (int percent : {1, 10, 50, 100}) {
+      QTest::addRow("push/%d%%", percent) << false << percent;
+      QTest::addRow("pull/%d%%", percent) << true << percent;
+    }
+  }
+  // Counts keys below the bound which leaves the given percent of 2^22 keys. Push API has to decode the whole stream
+  // while pull decoder stops at the bound.
+  void count_keys_below() {
+    QFETCH(bool, pull);
+    QFETCH(int, percent);
+    std::vector<uint64_t> keys(size_t{1} << 22);
+    std::generate(keys.begin(), keys.end(), [&] { return rnd_engine_(); });
+    std::sort(keys.begin(), keys.end());
+    varint_.clear();
+    delta::pack(keys.begin(), keys.end(), std::back_inserter(varint_));
+    const size_t expected = keys.size() * percent / 100;
+    const uint64_t bound = expected == keys.size() ? ~uint64_t{0} : keys[expected];
+
+    size_t count = 0;
+    std::vector<uint64_t> decoded(keys.size());
+    QBENCHMARK {
+      if (pull) {
+        delta::decoder decoder{varint_.begin(), varint_.end()};
+        count = 0;
+        for (auto key = decoder.next(); key && *key < bound; key = decoder.next())
+          ++count;
+      } else {
+        delta::unpack(varint_.begin(), varint_.end(), decoded.data());
+        count = std::lower_bound(decoded.begin(), decoded.end(), bound) - decoded.begin();
+      }
+    }
+    QCOMPARE(count, expected);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  std::vector<char> varint_;
+  std::vector<char> svb_;
+  key_blocks blocks_;
+};
+
+QTEST_MAIN(deltapack_benchmarks)
+#include "deltapack.bench.moc"
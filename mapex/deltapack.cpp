@@ -0,0 +1,239 @@
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MAPEX_DELTAPACK_X86 1
+#endif
+
+#include <algorithm>
+#include <array>
+
+#include <mapex/deltapack.hpp>
+
+namespace stream_vbyte {
+
+namespace {
+
+constexpr unsigned value_size(unsigned control, unsigned idx) noexcept { return ((control >> (4 * idx)) & 0x7) + 1; }
+
+unsigned byte_size(uint64_t val) noexcept { return (71 - __builtin_clzll(val | 1)) / 8; }
+
+// Shuffle mask which moves bytes of two values described by the control byte into separate 64 bit lanes.
+struct alignas(16) shuffle_entry {
+  uint8_t mask[16];
+  uint8_t size;
+};
+
+constexpr std::array<shuffle_entry, 256> make_shuffle_table() noexcept {
+  std::array<shuffle_entry, 256> res{};
+  for (unsigned control = 0; control < res.size(); ++control) {
+    uint8_t src = 0;
+    for (unsigned idx = 0; idx < 2; ++idx) {
+      const unsigned sz = value_size(control, idx);
+      for (unsigned bt = 0; bt < sizeof(uint64_t); ++bt)
+        res[control].mask[sizeof(uint64_t) * idx + bt] = bt < sz ? src++ : 0x80;
+    }
+    res[control].size = src;
+  }
+  return res;
+}
+
+constexpr auto shuffle_table = make_shuffle_table();
+
+// Decodes values `[first_idx, count)` of the stream with the `control` section. `data` points to the value `first_idx`
+// which follows the `prev` value and `values` receives the value `first_idx`.
+const char* unpack_delta_scalar(const uint8_t* control, const char* data, const char*, size_t first_idx, size_t count,
+    uint64_t prev, uint64_t* values) noexcept {
+  for (size_t i = first_idx; i < count; ++i) {
+    const unsigned sz = value_size(control[i / 2], i % 2);
+    uint64_t val = 0;
+    for (unsigned bt = 0; bt < sz; ++bt)
+      val |= uint64_t{static_cast<uint8_t>(data[bt])} << (8 * bt);
+    data += sz;
+    prev += val;
+    *values++ = prev;
+  }
+  return data;
+}
+
+#if defined(MAPEX_DELTAPACK_X86)
+
+// SIMD kernels start from an even `first_idx` so that each control byte describes two values of the same iteration.
+// They load 16 bytes per control byte and leave the stream tail which might be shorter than that to the scalar loop.
+
+__attribute__((target("ssse3"))) const char* unpack_delta_ssse3(const uint8_t* control, const char* data,
+    const char* last, size_t first_idx, size_t count, uint64_t prev, uint64_t* values) noexcept {
+  __m128i sum = _mm_set1_epi64x(static_cast<long long>(prev));
+  size_t i = first_idx;
+  for (; i + 2 <= count && last - data >= 16; i += 2, values += 2) {
+    const shuffle_entry& entry = shuffle_table[control[i / 2]];
+    __m128i val = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(entry.mask)));
+    val = _mm_add_epi64(val, _mm_slli_si128(val, 8));
+    val = _mm_add_epi64(val, sum);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values), val);
+    sum = _mm_unpackhi_epi64(val, val);
+    data += entry.size;
+  }
+  return unpack_delta_scalar(control, data, last, i, count, i > first_idx ? values[-1] : prev, values);
+}
+
+__attribute__((target("avx2"))) const char* unpack_delta_avx2(const uint8_t* control, const char* data,
+    const char* last, size_t first_idx, size_t count, uint64_t prev, uint64_t* values) noexcept {
+  __m256i sum = _mm256_set1_epi64x(static_cast<long long>(prev));
+  size_t i = first_idx;
+  // Each of the two control bytes describes at most 16 data bytes so the second load never crosses `data + 32`
+  for (; i + 4 <= count && last - data >= 32; i += 4, values += 4) {
+    const shuffle_entry& lo = shuffle_table[control[i / 2]];
+    const shuffle_entry& hi = shuffle_table[control[i / 2 + 1]];
+    const __m256i bytes =
+        _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + lo.size)), 1);
+    const __m256i mask =
+        _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lo.mask))),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(hi.mask)), 1);
+    __m256i val = _mm256_shuffle_epi8(bytes, mask);
+    // Prefix sum within 128 bit lanes first then carry the sum of the low lane into the high one
+    val = _mm256_add_epi64(val, _mm256_slli_si256(val, 8));
+    val = _mm256_add_epi64(
+        val, _mm256_blend_epi32(_mm256_setzero_si256(), _mm256_permute4x64_epi64(val, 0x55), 0xf0));
+    val = _mm256_add_epi64(val, sum);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), val);
+    sum = _mm256_permute4x64_epi64(val, 0xff);
+    data += lo.size + hi.size;
+  }
+  return unpack_delta_scalar(control, data, last, i, count, i > first_idx ? values[-1] : prev, values);
+}
+
+#endif
+
+const char* unpack_delta(kernel k, const uint8_t* control, const char* data, const char* last, size_t first_idx,
+    size_t count, uint64_t prev, uint64_t* values) noexcept {
+#if defined(MAPEX_DELTAPACK_X86)
+  if (first_idx % 2 != 0 && first_idx < count) {
+    data = unpack_delta_scalar(control, data, last, first_idx, first_idx + 1, prev, values);
+    prev = *values++;
+    ++first_idx;
+  }
+  if (k == kernel::avx2)
+    return unpack_delta_avx2(control, data, last, first_idx, count, prev, values);
+  if (k == kernel::ssse3)
+    return unpack_delta_ssse3(control, data, last, first_idx, count, prev, values);
+#endif
+  return unpack_delta_scalar(control, data, last, first_idx, count, prev, values);
+}
+
+} // namespace
+
+bool is_supported(kernel k) noexcept {
+  if (k == kernel::scalar)
+    return true;
+#if defined(MAPEX_DELTAPACK_X86)
+  __builtin_cpu_init();
+  if (k == kernel::ssse3)
+    return __builtin_cpu_supports("ssse3");
+  if (k == kernel::avx2)
+    return __builtin_cpu_supports("avx2");
+#endif
+  return false;
+}
+
+kernel best_kernel() noexcept {
+  static const kernel res = is_supported(kernel::avx2) ? kernel::avx2
+                            : is_supported(kernel::ssse3) ? kernel::ssse3
+                                                          : kernel::scalar;
+  return res;
+}
+
+size_t encoded_size(const char* encoded, size_t count) noexcept {
+  const auto* control = reinterpret_cast<const uint8_t*>(encoded);
+  size_t res = control_size(count);
+  for (size_t i = 0; i < count / 2; ++i)
+    res += shuffle_table[control[i]].size;
+  if (count % 2 != 0)
+    res += value_size(control[count / 2], 0);
+  return res;
+}
+
+size_t pack_delta(const uint64_t* values, size_t count, char* encoded, uint64_t prev) noexcept {
+  auto* control = reinterpret_cast<uint8_t*>(encoded);
+  std::fill_n(control, control_size(count), 0);
+  char* data = encoded + control_size(count);
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t val = values[i] - prev;
+    prev = values[i];
+    const unsigned sz = byte_size(val);
+    control[i / 2] |= (sz - 1) << (4 * (i % 2));
+    for (unsigned bt = 0; bt < sz; ++bt, val >>= 8)
+      *data++ = static_cast<char>(val & 0xff);
+  }
+  return data - encoded;
+}
+
+const char* unpack_delta(
+    const char* first, const char* last, size_t count, uint64_t* values, uint64_t prev) noexcept {
+  return unpack_delta(best_kernel(), first, last, count, values, prev);
+}
+
+const char* unpack_delta(
+    kernel k, const char* first, const char* last, size_t count, uint64_t* values, uint64_t prev) noexcept {
+  return unpack_delta(
+      k, reinterpret_cast<const uint8_t*>(first), first + control_size(count), last, 0, count, prev, values);
+}
+
+const char* resumable_unpacker::unpack(const char* first, const char* last, std::vector<uint64_t>& values) {
+  const size_t ctl_size = control_size(count_);
+  if (control_.size() < ctl_size) {
+    const size_t size = std::min(ctl_size - control_.size(), static_cast<size_t>(last - first));
+    control_.insert(control_.end(), first, first + size);
+    first += size;
+    if (control_.size() < ctl_size)
+      return first;
+  }
+
+  // Complete the value split by the end of the previous chunk
+  if (!partial_.empty() && decoded_ < count_) {
+    const size_t sz = value_size(control_[decoded_ / 2], decoded_ % 2);
+    const size_t size = std::min(sz - partial_.size(), static_cast<size_t>(last - first));
+    partial_.insert(partial_.end(), first, first + size);
+    first += size;
+    if (partial_.size() < sz)
+      return first;
+    values.push_back(prev_);
+    unpack_delta_scalar(control_.data(), partial_.data(), nullptr, decoded_, decoded_ + 1, prev_, &values.back());
+    prev_ = values.back();
+    ++decoded_;
+    partial_.clear();
+  }
+
+  // Find the values with complete data, two values of a control byte at a time where possible
+  const auto available = static_cast<size_t>(last - first);
+  size_t end = decoded_;
+  size_t size = 0;
+  while (end < count_) {
+    if (end % 2 == 0 && end + 2 <= count_ && size + shuffle_table[control_[end / 2]].size <= available) {
+      size += shuffle_table[control_[end / 2]].size;
+      end += 2;
+      continue;
+    }
+    const unsigned sz = value_size(control_[end / 2], end % 2);
+    if (size + sz > available)
+      break;
+    size += sz;
+    ++end;
+  }
+
+  if (end > decoded_) {
+    const size_t pos = values.size();
+    values.resize(pos + (end - decoded_));
+    unpack_delta(best_kernel(), control_.data(), first, last, decoded_, end, prev_, values.data() + pos);
+    prev_ = values.back();
+    decoded_ = end;
+    first += size;
+  }
+  if (decoded_ < count_) {
+    partial_.assign(first, last);
+    first = last;
+  }
+  return first;
+}
+
+} // namespace stream_vbyte
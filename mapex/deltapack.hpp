@@ -2,7 +2,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 namespace varint {
 
@@ -61,7 +63,7 @@ namespace delta {
 template <typename InputIt>
 struct delta_iterator {
   uint64_t operator*() const noexcept(noexcept(*std::declval<InputIt>())) { return *it - prev; }
-  delta_iterator& operator++() noexcept(noexcept(++std::declval<InputIt>()) && noexcept(*std::declval<InputIt>())) {
+  delta_iterator& operator++() noexcept(noexcept(++std::declval<InputIt&>()) && noexcept(*std::declval<InputIt>())) {
     prev = *it;
     ++it;
     return *this;
@@ -77,7 +79,7 @@ struct delta_iterator {
 template <typename OutIt>
 struct delta_oiter {
   delta_oiter& operator*() noexcept { return *this; }
-  delta_oiter& operator++() noexcept(noexcept(++std::declval<OutIt>())) {
+  delta_oiter& operator++() noexcept(noexcept(++std::declval<OutIt&>())) {
     ++it;
     return *this;
   }
@@ -91,9 +93,11 @@ struct delta_oiter {
   uint64_t accum = 0;
 };
 
+/// Packs differences between consequent values. `prev` is the value preceding `first` which allows to pack a long
+/// sequence chunk by chunk.
 template <typename InputIt, typename OutIt>
-void pack(InputIt first, InputIt last, OutIt dest) {
-  varint::pack(delta_iterator<InputIt>{first}, delta_iterator<InputIt>{last}, dest);
+void pack(InputIt first, InputIt last, OutIt dest, uint64_t prev = 0) {
+  varint::pack(delta_iterator<InputIt>{first, prev}, delta_iterator<InputIt>{last}, dest);
 }
 
 template <typename InputIt, typename OutIt>
@@ -106,4 +110,146 @@ InputIt unpack_n(InputIt first, InputIt last, size_t count, OutIt dest) {
   return varint::unpack_n(first, last, count, delta_oiter<OutIt>{dest});
 }
 
+/// Pull-style decoder of varint encoded deltas. Values are decoded one by one on request so the caller may stop at any
+/// point without decoding the rest of the stream.
+template <typename InputIt>
+class decoder {
+public:
+  decoder(InputIt first, InputIt last, uint64_t prev = 0) : first_{first}, last_{last}, accum_{prev} {}
+
+  /// Decodes the next value. Returns `std::nullopt` at the end of the stream.
+  std::optional<uint64_t> next() {
+    uint64_t val = 0;
+    for (unsigned shift = 0; first_ != last_; shift += 7) {
+      const uint64_t bt = static_cast<uint8_t>(*first_);
+      ++first_;
+      val |= (bt & 0x7f) << shift;
+      if (!(bt & 0x80)) {
+        accum_ += val;
+        return accum_;
+      }
+    }
+    return std::nullopt;
+  }
+
+  /// Returns the first of the remaining values which is not less than `key`. Values must be sorted. Varint stream has
+  /// no index so the skipped values are decoded anyway.
+  std::optional<uint64_t> skip_to(uint64_t key) {
+    std::optional<uint64_t> res = next();
+    while (res && *res < key)
+      res = next();
+    return res;
+  }
+
+  /// Position of the next value in the stream.
+  InputIt position() const { return first_; }
+
+private:
+  InputIt first_;
+  InputIt last_;
+  uint64_t accum_;
+};
+
+/// Varint delta decoder which can be resumed with the next portion of the encoded stream. Keeps the partially read
+/// value and the running sum between calls so the stream may be split into chunks at any byte, e.g. while it is being
+/// downloaded.
+class resumable_unpacker {
+public:
+  explicit resumable_unpacker(uint64_t prev = 0) noexcept : accum_{prev} {}
+
+  /// Decodes values from `[first, last)` until `count` values are written to `dest` or the input ends. A value split by
+  /// the end of input is completed by the next call. Returns the iterator past the consumed input.
+  template <typename InputIt, typename OutIt>
+  InputIt unpack_n(InputIt first, InputIt last, size_t count, OutIt dest) {
+    for (; first != last && count > 0; ++first) {
+      const uint64_t bt = static_cast<uint8_t>(*first);
+      val_ |= (bt & 0x7f) << shift_;
+      shift_ += 7;
+      if (!(bt & 0x80)) {
+        accum_ += val_;
+        *dest = accum_;
+        ++dest;
+        val_ = 0;
+        shift_ = 0;
+        ++decoded_;
+        --count;
+      }
+    }
+    return first;
+  }
+
+  /// Number of values decoded so far.
+  size_t decoded() const noexcept { return decoded_; }
+  /// True if the last consumed byte is not the last byte of a value.
+  bool has_partial_value() const noexcept { return shift_ != 0; }
+  /// Last decoded value or the initial `prev` if nothing is decoded yet.
+  uint64_t last_value() const noexcept { return accum_; }
+
+private:
+  uint64_t accum_;
+  uint64_t val_ = 0;
+  unsigned shift_ = 0;
+  size_t decoded_ = 0;
+};
+
 } // namespace delta
+
+/// Stream VByte like codec for 64 bit values. Encoded stream consists of control bytes followed by data bytes. Each
+/// control byte holds two nibbles with lengths minus one of the next two values stored as little endian bytes in the
+/// data section. Separate control bytes allow to decode two values with a single byte shuffle instruction.
+namespace stream_vbyte {
+
+/// Decoding kernel implementations.
+enum class kernel { scalar, ssse3, avx2 };
+
+/// Returns true if the `k` kernel can be used on the current CPU.
+bool is_supported(kernel k) noexcept;
+/// Widest kernel supported by the current CPU.
+kernel best_kernel() noexcept;
+
+/// Size of the control section of `count` values.
+constexpr size_t control_size(size_t count) noexcept { return (count + 1) / 2; }
+/// Maximal size of the encoded stream of `count` values.
+constexpr size_t max_encoded_size(size_t count) noexcept { return control_size(count) + count * sizeof(uint64_t); }
+/// Size of the whole stream of `count` values calculated from its control section.
+size_t encoded_size(const char* encoded, size_t count) noexcept;
+
+/// Encodes `count` differences between consequent `values` into `encoded` buffer which must have at least
+/// `max_encoded_size(count)` bytes. The first difference is taken from the `prev` value. Sorted values give the
+/// smallest differences and so the shortest stream. Returns number of bytes written.
+size_t pack_delta(const uint64_t* values, size_t count, char* encoded, uint64_t prev = 0) noexcept;
+/// Decodes `count` values encoded with `pack_delta` from the stream starting at `first`. Whole stream must be in the
+/// range `[first, last)` which may contain more data after the stream. `prev` must be the same as passed to
+/// `pack_delta`. Returns the pointer past the decoded stream.
+const char* unpack_delta(
+    const char* first, const char* last, size_t count, uint64_t* values, uint64_t prev = 0) noexcept;
+/// Same as above but uses the `k` kernel instead of the best one. The kernel must be supported by the current CPU.
+const char* unpack_delta(
+    kernel k, const char* first, const char* last, size_t count, uint64_t* values, uint64_t prev = 0) noexcept;
+
+/// Stream VByte decoder which can be resumed with the next portion of the stream, e.g. while it is being downloaded.
+/// The control section is accumulated first and then the values are decoded as soon as their data bytes arrive. Only
+/// the bytes of a value split by the end of a chunk are kept between calls.
+class resumable_unpacker {
+public:
+  /// Prepares decoding of the stream of `count` values packed with the same `prev` value.
+  explicit resumable_unpacker(size_t count = 0, uint64_t prev = 0) noexcept : count_{count}, prev_{prev} {}
+
+  /// Consumes the stream bytes from `[first, last)` appending the decoded values to `values`. Returns the pointer past
+  /// the consumed input which is `last` unless the stream ends before it.
+  const char* unpack(const char* first, const char* last, std::vector<uint64_t>& values);
+
+  /// Number of values decoded so far.
+  size_t decoded() const noexcept { return decoded_; }
+  /// True if all values of the stream are decoded.
+  bool done() const noexcept { return decoded_ == count_; }
+
+private:
+  size_t count_;
+  uint64_t prev_;
+  size_t decoded_ = 0;
+  std::vector<uint8_t> control_;
+  std::vector<char> partial_;
+};
+
+} // namespace stream_vbyte
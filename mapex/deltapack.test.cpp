@@ -48,8 +48,33 @@ const std::pair<uint64_t, size_t> greatest_of_same_bits_range[] = {
     {0xffffffffffffffff, 10},
 };
 
+// Sorted values which differences take each of the possible stream VByte lengths
+std::vector<uint64_t> all_lengths_sample(size_t sample_size) {
+  std::vector<uint64_t> res(sample_size);
+  uint64_t val = 0;
+  for (size_t i = 0; i < sample_size; ++i) {
+    val += uint64_t{1} << (8 * (i % 8));
+    res[i] = val;
+  }
+  return res;
+}
+
+const char* kernel_name(stream_vbyte::kernel k) {
+  switch (k) {
+  case stream_vbyte::kernel::scalar:
+    return "scalar";
+  case stream_vbyte::kernel::ssse3:
+    return "ssse3";
+  case stream_vbyte::kernel::avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
 } // namespace
 
+Q_DECLARE_METATYPE(stream_vbyte::kernel);
+
 class deltapack_tests : public QObject {
   Q_OBJECT
 private:
@@ -174,6 +199,196 @@ private slots:
     QCOMPARE(restored, input_);
   }
 
+  void resumable_unpacker_restores_values_split_at_any_byte_data() {
+    QTest::addColumn<size_t>("chunk_size");
+
+    for (size_t chunk_size : {1, 2, 3, 7, 64, 1000})
+      QTest::addRow("%d", static_cast<int>(chunk_size)) << chunk_size;
+  }
+  void resumable_unpacker_restores_values_split_at_any_byte() {
+    QFETCH(size_t, chunk_size);
+
+    input_ = gen_random_sample<std::vector>(1000);
+    std::sort(input_.begin(), input_.end());
+    std::vector<char> packed;
+    delta::pack(input_.begin(), input_.end(), std::back_inserter(packed));
+
+    delta::resumable_unpacker unpacker;
+    std::vector<uint64_t> restored;
+    for (auto it = packed.begin(); it != packed.end();) {
+      const auto chunk_end = it + std::min<ptrdiff_t>(chunk_size, packed.end() - it);
+      QCOMPARE(unpacker.unpack_n(it, chunk_end, input_.size(), std::back_inserter(restored)), chunk_end);
+      it = chunk_end;
+    }
+    QVERIFY(!unpacker.has_partial_value());
+    QCOMPARE(unpacker.decoded(), input_.size());
+    QCOMPARE(unpacker.last_value(), input_.back());
+    QCOMPARE(restored, input_);
+  }
+
+  void resumable_unpacker_stops_after_requested_count() {
+    input_ = gen_random_sample<std::vector>(100);
+    std::sort(input_.begin(), input_.end());
+    std::vector<char> packed;
+    delta::pack(input_.begin(), input_.begin() + 40, std::back_inserter(packed));
+    delta::pack(input_.begin() + 40, input_.end(), std::back_inserter(packed));
+
+    std::vector<uint64_t> restored;
+    delta::resumable_unpacker head;
+    auto it = head.unpack_n(packed.begin(), packed.end(), 40, std::back_inserter(restored));
+    delta::resumable_unpacker tail;
+    QCOMPARE(tail.unpack_n(it, packed.end(), 1000, std::back_inserter(restored)), packed.end());
+    QCOMPARE(head.decoded(), size_t{40});
+    QCOMPARE(tail.decoded(), size_t{60});
+    QCOMPARE(restored, input_);
+  }
+
+  void decoder_pulls_packed_values_back() {
+    input_ = gen_random_sample<std::vector>(1000);
+    std::sort(input_.begin(), input_.end());
+    std::vector<char> packed;
+    delta::pack(input_.begin(), input_.end(), std::back_inserter(packed));
+
+    delta::decoder decoder{packed.begin(), packed.end()};
+    std::vector<uint64_t> restored;
+    while (const auto val = decoder.next())
+      restored.push_back(*val);
+    QCOMPARE(restored, input_);
+    QVERIFY(decoder.position() == packed.end());
+  }
+
+  void decoder_skips_to_first_not_less_value() {
+    input_ = gen_random_sample<std::vector>(1000);
+    std::sort(input_.begin(), input_.end());
+    std::vector<char> packed;
+    delta::pack(input_.begin(), input_.end(), std::back_inserter(packed));
+
+    delta::decoder decoder{packed.begin(), packed.end()};
+    QCOMPARE(decoder.skip_to(input_[100] + 1), std::optional{input_[101]});
+    QCOMPARE(decoder.next(), std::optional{input_[102]});
+    QCOMPARE(decoder.skip_to(input_[500]), std::optional{input_[500]});
+    QCOMPARE(decoder.skip_to(~uint64_t{0}), std::optional<uint64_t>{});
+  }
+
+  void stream_vbyte_unpacks_packed_values_back_data() {
+    QTest::addColumn<stream_vbyte::kernel>("kernel");
+    QTest::addColumn<size_t>("count");
+
+    for (auto k : {stream_vbyte::kernel::scalar, stream_vbyte::kernel::ssse3, stream_vbyte::kernel::avx2}) {
+      for (size_t count : {0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 32, 33, 1000})
+        QTest::addRow("%s/%d", kernel_name(k), static_cast<int>(count)) << k << count;
+    }
+  }
+  void stream_vbyte_unpacks_packed_values_back() {
+    QFETCH(stream_vbyte::kernel, kernel);
+    QFETCH(size_t, count);
+    if (!stream_vbyte::is_supported(kernel))
+      QSKIP("Kernel is not supported by this CPU");
+
+    for (const auto& sample : {all_lengths_sample(count), gen_random_sample<std::vector>(count)}) {
+      input_ = sample;
+      std::sort(input_.begin(), input_.end());
+      encoded_.resize(stream_vbyte::max_encoded_size(count));
+      encoded_.resize(stream_vbyte::pack_delta(input_.data(), count, encoded_.data()));
+      decoded_.resize(count);
+      const char* end = encoded_.data() + encoded_.size();
+      QCOMPARE(stream_vbyte::unpack_delta(kernel, encoded_.data(), end, count, decoded_.data()), end);
+      QCOMPARE(decoded_, input_);
+    }
+  }
+
+  void stream_vbyte_encoded_size_matches_packed_size_data() {
+    QTest::addColumn<size_t>("count");
+    for (size_t count : {0, 1, 2, 3, 100, 101})
+      QTest::addRow("%d", static_cast<int>(count)) << count;
+  }
+  void stream_vbyte_encoded_size_matches_packed_size() {
+    QFETCH(size_t, count);
+    input_ = all_lengths_sample(count);
+    encoded_.resize(stream_vbyte::max_encoded_size(count));
+    const size_t size = stream_vbyte::pack_delta(input_.data(), count, encoded_.data());
+    QCOMPARE(stream_vbyte::encoded_size(encoded_.data(), count), size);
+  }
+
+  void stream_vbyte_encodes_value_with_minimal_number_of_bytes() {
+    for (unsigned bytes = 1; bytes <= sizeof(uint64_t); ++bytes) {
+      input_ = {uint64_t{1} << (8 * bytes - 1)};
+      encoded_.resize(stream_vbyte::max_encoded_size(1));
+      QCOMPARE(stream_vbyte::pack_delta(input_.data(), 1, encoded_.data()), size_t{1 + bytes});
+    }
+  }
+
+  void stream_vbyte_unpack_alows_to_unpack_following_stream_data() {
+    QTest::addColumn<stream_vbyte::kernel>("kernel");
+    for (auto k : {stream_vbyte::kernel::scalar, stream_vbyte::kernel::ssse3, stream_vbyte::kernel::avx2})
+      QTest::addRow("%s", kernel_name(k)) << k;
+  }
+  void stream_vbyte_unpack_alows_to_unpack_following_stream() {
+    QFETCH(stream_vbyte::kernel, kernel);
+    if (!stream_vbyte::is_supported(kernel))
+      QSKIP("Kernel is not supported by this CPU");
+
+    const auto first = all_lengths_sample(77);
+    auto second = gen_random_sample<std::vector>(100);
+    std::sort(second.begin(), second.end());
+    encoded_.resize(stream_vbyte::max_encoded_size(first.size()) + stream_vbyte::max_encoded_size(second.size()));
+    size_t size = stream_vbyte::pack_delta(first.data(), first.size(), encoded_.data());
+    size += stream_vbyte::pack_delta(second.data(), second.size(), encoded_.data() + size);
+
+    std::vector<uint64_t> first_restored(first.size());
+    std::vector<uint64_t> second_restored(second.size());
+    const char* end = encoded_.data() + size;
+    const char* pos = stream_vbyte::unpack_delta(kernel, encoded_.data(), end, first.size(), first_restored.data());
+    stream_vbyte::unpack_delta(kernel, pos, end, second.size(), second_restored.data());
+    QCOMPARE(first_restored, first);
+    QCOMPARE(second_restored, second);
+  }
+
+  void stream_vbyte_resumable_unpacker_restores_values_split_at_any_byte_data() {
+    QTest::addColumn<size_t>("chunk_size");
+
+    for (size_t chunk_size : {1, 2, 3, 7, 64, 1000})
+      QTest::addRow("%d", static_cast<int>(chunk_size)) << chunk_size;
+  }
+  void stream_vbyte_resumable_unpacker_restores_values_split_at_any_byte() {
+    QFETCH(size_t, chunk_size);
+
+    input_ = all_lengths_sample(1001);
+    encoded_.resize(stream_vbyte::max_encoded_size(input_.size()));
+    encoded_.resize(stream_vbyte::pack_delta(input_.data(), input_.size(), encoded_.data()));
+
+    stream_vbyte::resumable_unpacker unpacker{input_.size()};
+    std::vector<uint64_t> restored;
+    for (const char* it = encoded_.data(); it != encoded_.data() + encoded_.size();) {
+      const char* chunk_end = it + std::min<ptrdiff_t>(chunk_size, encoded_.data() + encoded_.size() - it);
+      QCOMPARE(unpacker.unpack(it, chunk_end, restored), chunk_end);
+      QCOMPARE(restored.size(), unpacker.decoded());
+      it = chunk_end;
+    }
+    QVERIFY(unpacker.done());
+    QCOMPARE(restored, input_);
+  }
+
+  void stream_vbyte_resumable_unpacker_stops_at_the_end_of_stream() {
+    input_ = gen_random_sample<std::vector>(100);
+    std::sort(input_.begin(), input_.end());
+    encoded_.resize(stream_vbyte::max_encoded_size(input_.size()));
+    size_t size = stream_vbyte::pack_delta(input_.data(), 40, encoded_.data());
+    const size_t head_size = size;
+    size += stream_vbyte::pack_delta(input_.data() + 40, 60, encoded_.data() + size, input_[39]);
+    const char* end = encoded_.data() + size;
+
+    std::vector<uint64_t> restored;
+    stream_vbyte::resumable_unpacker head{40};
+    const char* pos = head.unpack(encoded_.data(), end, restored);
+    QCOMPARE(pos, encoded_.data() + head_size);
+    stream_vbyte::resumable_unpacker tail{60, input_[39]};
+    QCOMPARE(tail.unpack(pos, end, restored), end);
+    QVERIFY(head.done());
+    QVERIFY(tail.done());
+    QCOMPARE(restored, input_);
+  }
+
 private:
   std::default_random_engine rnd_engine_;
   std::vector<uint64_t> input_;
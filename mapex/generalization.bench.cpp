@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/generalization.hpp>
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/search_index.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 0x40'0000;
+// Points are spread over a square with the side of 2^24 world units around the world center which is close to a
+// size of a big city.
+constexpr uint32_t area_side_log2 = 24;
+constexpr uint32_t area_min = (uint32_t{1} << 31) - (uint32_t{1} << (area_side_log2 - 1));
+
+enum class query_path { scan, ranges, pyramid, prefix_sums, blocks, blocks_push, quantized };
+enum class curve_type { morton, hilbert };
+enum class key_storage { plain, blocks, quantized };
+
+} // namespace
+
+Q_DECLARE_METATYPE(query_path);
+Q_DECLARE_METATYPE(curve_type);
+Q_DECLARE_METATYPE(key_storage);
+
+class generalization_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  void thin_and_wide_rects() {
+    QTest::addColumn<curve_type>("curve");
+    QTest::addColumn<query_path>("path");
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+
+    const std::pair<const char*, query_path> paths[] = {
+        {"scan", query_path::scan}, {"ranges", query_path::ranges}, {"pyramid", query_path::pyramid},
+        {"prefix_sums", query_path::prefix_sums}, {"blocks", query_path::blocks},
+        {"blocks_push", query_path::blocks_push}, {"quantized", query_path::quantized}};
+    const std::pair<const char*, point> shapes[] = {{"thin", {2048, 16}}, {"wide", {2048, 2048}}};
+    const std::pair<const char*, curve_type> curves[] = {
+        {"morton", curve_type::morton}, {"hilbert", curve_type::hilbert}};
+    for (const auto& [curve_name, curve] : curves) {
+      for (const auto& [path_name, path] : paths) {
+        // Quantized keys are Morton codes only
+        if (path == query_path::quantized && curve == curve_type::hilbert)
+          continue;
+        for (const auto& [shape_name, size_px] : shapes) {
+          for (int z_level = 0; z_level <= max_z_level; ++z_level) {
+            const uint32_t px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+            const point size{size_px.x << px_log2, size_px.y << px_log2};
+            const point center{uint32_t{1} << 31, uint32_t{1} << 31};
+            const point min{center.x - size.x / 2, center.y - size.y / 2};
+            const point max{center.x + size.x / 2, center.y + size.y / 2};
+            QTest::addRow("%s/%s/%s/z%d", curve_name, path_name, shape_name, z_level)
+                << curve << path << z_level << morton::code(min) << morton::code(max);
+          }
+        }
+      }
+    }
+  }
+
+  template <typename Curve>
+  std::vector<point_group> run_query(const std::vector<uint64_t>& points, const cell_pyramid& pyramid,
+      const prefix_sums& sums, const key_blocks& blocks, query_path path, int z_level, uint64_t min, uint64_t max,
+      scan_stats* stats) {
+    switch (path) {
+    case query_path::scan:
+      return generalize<Curve>(points, min, max, z_level, stats);
+    case query_path::ranges:
+      return generalize_ranges<Curve>(points, min, max, z_level, default_max_ranges, stats);
+    case query_path::pyramid:
+      return generalize<Curve>(pyramid, min, max, z_level, stats);
+    case query_path::prefix_sums:
+      return generalize<Curve>(points, sums, min, max, z_level, stats);
+    case query_path::blocks:
+      return generalize<Curve>(blocks, min, max, z_level, default_block_ranges, stats);
+    case query_path::blocks_push: {
+      // Decodes every block overlapping the rect intervals into a vector before scanning it
+      std::vector<uint64_t> keys;
+      const size_t decoded = blocks.decode_ranges(Curve::decompose(min, max, default_block_ranges), keys);
+      if (stats)
+        stats->blocks_decoded += decoded;
+      return generalize_ranges<Curve>(keys, min, max, z_level, default_block_ranges, stats);
+    }
+    case query_path::quantized:
+      break;
+    }
+    return {};
+  }
+
+  // Rect corners are given as Morton codes for both curves
+  std::vector<point_group> run_query(
+      curve_type curve, query_path path, int z_level, uint64_t min, uint64_t max, scan_stats* stats) {
+    if (path == query_path::quantized) {
+      return generalize<morton::quantized_curve>({quantized_points_, &quantized_index_}, morton::quantize(min),
+          morton::quantize(max), z_level, stats);
+    }
+    if (curve == curve_type::hilbert) {
+      return run_query<hilbert::curve>(hilbert_points_, hilbert_pyramid_, hilbert_sums_, hilbert_blocks_, path,
+          z_level, hilbert::from_morton(min), hilbert::from_morton(max), stats);
+    }
+    return run_query<morton::curve>(points_, pyramid_, sums_, blocks_, path, z_level, min, max, stats);
+  }
+
+private slots:
+  void initTestCase() {
+    std::default_random_engine rnd_engine;
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + ((uint32_t{1} << area_side_log2) - 1)};
+    points_.resize(sample_size);
+    std::generate(points_.begin(), points_.end(), [&] { return morton::code({dist(rnd_engine), dist(rnd_engine)}); });
+    std::sort(points_.begin(), points_.end());
+    pyramid_ = cell_pyramid{points_};
+    sums_ = prefix_sums{points_};
+    blocks_ = key_blocks{points_};
+    quantized_points_.resize(points_.size());
+    std::transform(points_.begin(), points_.end(), quantized_points_.begin(), morton::quantize);
+    quantized_index_ = basic_search_index<uint32_t>{quantized_points_};
+
+    hilbert_points_.resize(points_.size());
+    std::transform(points_.begin(), points_.end(), hilbert_points_.begin(), hilbert::from_morton);
+    std::sort(hilbert_points_.begin(), hilbert_points_.end());
+    hilbert_pyramid_ = cell_pyramid{hilbert_points_, hilbert::curve{}};
+    hilbert_sums_ = prefix_sums{hilbert_points_, hilbert::curve{}};
+    hilbert_blocks_ = key_blocks{hilbert_points_};
+  }
+
+  void pyramid_build_time() {
+    QBENCHMARK { cell_pyramid{points_}; }
+  }
+
+  void prefix_sums_build_time() {
+    QBENCHMARK { prefix_sums{points_}; }
+  }
+
+  void hilbert_pyramid_build_time() {
+    QBENCHMARK { cell_pyramid{hilbert_points_, hilbert::curve{}}; }
+  }
+
+  void blocks_build_time() {
+    QBENCHMARK { key_blocks{points_}; }
+  }
+
+  // Memory used by the keys kept in compressed blocks or quantized compared to the plain keys array
+  void keys_memory_data() {
+    QTest::addColumn<key_storage>("storage");
+    QTest::addRow("keys") << key_storage::plain;
+    QTest::addRow("blocks") << key_storage::blocks;
+    QTest::addRow("quantized") << key_storage::quantized;
+  }
+  void keys_memory() {
+    QFETCH(key_storage, storage);
+    size_t size = points_.size() * sizeof(uint64_t);
+    if (storage == key_storage::blocks)
+      size = blocks_.data_size() + blocks_.headers().size() * sizeof(key_blocks::header);
+    else if (storage == key_storage::quantized)
+      size = quantized_points_.size() * sizeof(uint32_t);
+    QTest::setBenchmarkResult(size, QTest::Events);
+  }
+
+  void blocks_decoded_data() { thin_and_wide_rects(); }
+  void blocks_decoded() {
+    QFETCH(curve_type, curve);
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    if (path != query_path::blocks && path != query_path::blocks_push)
+      QSKIP("Only blocks paths decode blocks");
+    scan_stats stats;
+    run_query(curve, path, z_level, min, max, &stats);
+    QTest::setBenchmarkResult(stats.blocks_decoded, QTest::Events);
+  }
+
+  void query_time_data() { thin_and_wide_rects(); }
+  void query_time() {
+    QFETCH(curve_type, curve);
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QBENCHMARK { run_query(curve, path, z_level, min, max, nullptr); }
+  }
+
+  void runs_data() { thin_and_wide_rects(); }
+  void runs() {
+    QFETCH(curve_type, curve);
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    scan_stats stats;
+    run_query(curve, path, z_level, min, max, &stats);
+    QTest::setBenchmarkResult(stats.runs, QTest::Events);
+  }
+
+  void keys_scanned_data() { thin_and_wide_rects(); }
+  void keys_scanned() {
+    QFETCH(curve_type, curve);
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    scan_stats stats;
+    run_query(curve, path, z_level, min, max, &stats);
+    QTest::setBenchmarkResult(stats.keys_scanned, QTest::Events);
+  }
+
+  void bigmin_jumps_data() { thin_and_wide_rects(); }
+  void bigmin_jumps() {
+    QFETCH(curve_type, curve);
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    scan_stats stats;
+    run_query(curve, path, z_level, min, max, &stats);
+    QTest::setBenchmarkResult(stats.bigmin_jumps, QTest::Events);
+  }
+
+private:
+  std::vector<uint64_t> points_;
+  cell_pyramid pyramid_;
+  prefix_sums sums_;
+  key_blocks blocks_;
+  std::vector<uint32_t> quantized_points_;
+  basic_search_index<uint32_t> quantized_index_;
+  std::vector<uint64_t> hilbert_points_;
+  cell_pyramid hilbert_pyramid_;
+  prefix_sums hilbert_sums_;
+  key_blocks hilbert_blocks_;
+};
+
+QTEST_MAIN(generalization_benchmarks)
+#include "generalization.bench.moc"
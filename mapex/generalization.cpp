@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cassert>
+#include <array>
+#include <iterator>
+#include <optional>
+
+#include <mapex/generalization.hpp>
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_search.hpp>
+#include <mapex/morton_code.hpp>
+
+namespace {
+
+constexpr size_t decode_batch_size = 256;
+
+// Keys narrower than 64 bits drop the low bits of each coordinate. Cells smaller than the dropped part are reduced to
+// single keys.
+template <typename Key = uint64_t>
+class cell_layout {
+public:
+  explicit cell_layout(int z_level) noexcept
+      : axis_bits_{cell_coord_bits(z_level)},
+        bits_{2 * (axis_bits_ > dropped_axis_bits ? axis_bits_ - dropped_axis_bits : 0)} {}
+
+  Key cell_of(Key code) const noexcept { return code & (~Key{0} << bits_); }
+  point corner_of(point pt) const noexcept {
+    const uint32_t mask = ~uint32_t{0} << axis_bits_;
+    return {pt.x & mask, pt.y & mask};
+  }
+  /// Returns 0 for the last cell of the world.
+  Key next_cell(Key code) const noexcept { return static_cast<Key>(cell_of(code) + (Key{1} << bits_)); }
+
+private:
+  static constexpr unsigned dropped_axis_bits = world_coord_range_log2 - 4 * sizeof(Key);
+
+  unsigned axis_bits_;
+  unsigned bits_;
+};
+
+// Exponential search from the beginning of the range. Faster then plain binary search when the result is expected to be
+// close to `first` which is true for cells with small number of points.
+template <typename It>
+It gallop_lower_bound(It first, It last, typename std::iterator_traits<It>::value_type val) {
+  typename std::iterator_traits<It>::difference_type step = 1;
+  while (step < last - first && first[step] < val) {
+    first += step;
+    step *= 2;
+  }
+  return std::lower_bound(first, step < last - first ? first + step : last, val);
+}
+
+bool is_cancelled(const cancellation_token* cancel) noexcept { return cancel && cancel->is_cancelled(); }
+
+// Cells at high z-levels usually contain just a few points. Dispatching them to SIMD kernel costs more then decoding.
+constexpr ptrdiff_t min_batch_decode_size = 8;
+
+template <typename Curve, typename Codec, typename It>
+cell_sum sum_cell(Codec codec, uint64_t cell, It first, It last) {
+  cell_sum res{cell, 0, 0, static_cast<int>(last - first)};
+  if (last - first < min_batch_decode_size) {
+    for (; first != last; ++first) {
+      const point pt = codec.decode(*first);
+      res.x_sum += pt.x;
+      res.y_sum += pt.y;
+    }
+    return res;
+  }
+
+  std::array<point, decode_batch_size> decoded;
+  while (first != last) {
+    const size_t batch_size = std::min<size_t>(last - first, decoded.size());
+    Curve::decode_n(&*first, batch_size, decoded.data());
+    for (size_t i = 0; i < batch_size; ++i) {
+      res.x_sum += decoded[i].x;
+      res.y_sum += decoded[i].y;
+    }
+    first += batch_size;
+  }
+  return res;
+}
+
+point_group to_point_group(const cell_sum& sum) noexcept {
+  return {{static_cast<uint32_t>(sum.x_sum / sum.count), static_cast<uint32_t>(sum.y_sum / sum.count)}, sum.count};
+}
+
+// Collects cell sums into point groups. Single cell might be reported in several consequent parts if the cell is split
+// between several Z-order intervals.
+class group_builder {
+public:
+  void add(const cell_sum& sum) {
+    if (pending_.count > 0 && pending_.cell == sum.cell) {
+      pending_.x_sum += sum.x_sum;
+      pending_.y_sum += sum.y_sum;
+      pending_.count += sum.count;
+      return;
+    }
+    flush();
+    pending_ = sum;
+  }
+
+  std::vector<point_group> finish() && {
+    flush();
+    return std::move(res_);
+  }
+
+private:
+  void flush() {
+    if (pending_.count == 0)
+      return;
+    res_.push_back(to_point_group(pending_));
+    pending_ = {};
+  }
+
+private:
+  std::vector<point_group> res_;
+  cell_sum pending_ = {};
+};
+
+template <typename Key>
+struct scan_query {
+  const basic_sorted_keys<Key>& points;
+  Key vp_min;
+  Key vp_max;
+  point rect_min;
+  point rect_max;
+  cell_layout<Key> cells;
+  const cancellation_token* cancel;
+};
+
+// Aggregates points from [first, last) range of codes inside of the query rect bounding Z-order range. When `exact` is
+// false the range may contain out of rect codes which are skipped with bigmin.
+template <typename Curve, typename Codec, typename Key>
+void scan_cells(Codec codec, key_iterator<Key> first, key_iterator<Key> last, bool exact,
+    const scan_query<Key>& query, group_builder& groups, scan_stats& stats) {
+  bool in_run = false;
+  while (first != last && !is_cancelled(query.cancel)) {
+    if (!exact && !is_in_rect(codec.decode(*first), query.rect_min, query.rect_max)) {
+      ++stats.keys_scanned;
+      ++stats.bigmin_jumps;
+      ++stats.searches;
+      first = search(query.points, first, last, Curve::bigmin(*first, query.vp_min, query.vp_max));
+      in_run = false;
+      continue;
+    }
+    stats.runs += in_run ? 0 : 1;
+    in_run = true;
+
+    const Key next_cell_start = query.cells.next_cell(*first);
+    const auto cell_end = next_cell_start == 0 ? last : gallop_lower_bound(first, last, next_cell_start);
+    ++stats.searches;
+    stats.keys_scanned += cell_end - first;
+    groups.add(sum_cell<Curve>(codec, query.cells.cell_of(*first), first, cell_end));
+    first = cell_end;
+  }
+}
+
+template <typename Codec, typename Key>
+scan_query<Key> make_query(Codec codec, const basic_sorted_keys<Key>& points, Key vp_min, Key vp_max, int z_level,
+    const cancellation_token* cancel) noexcept {
+  return {points, vp_min, vp_max, codec.decode(vp_min), codec.decode(vp_max), cell_layout<Key>{z_level}, cancel};
+}
+
+// Intervals hold keys of the query type
+template <typename Curve, typename Codec, typename Key>
+void scan_ranges(Codec codec, const std::vector<morton::z_range>& ranges, const scan_query<Key>& query,
+    group_builder& groups, scan_stats& stats) {
+  const auto& keys = query.points.keys;
+  auto first = keys.begin();
+  for (const morton::z_range& range : ranges) {
+    if (is_cancelled(query.cancel))
+      return;
+    first = search(query.points, first, keys.end(), static_cast<Key>(range.min));
+    const auto last = search_after(query.points, first, keys.end(), static_cast<Key>(range.max));
+    stats.searches += 2;
+    scan_cells<Curve>(codec, first, last, range.exact, query, groups, stats);
+    first = last;
+  }
+}
+
+} // namespace
+
+template <typename Curve>
+std::vector<point_group> generalize(const basic_sorted_keys<key_type_of<Curve>>& points, key_type_of<Curve> vp_min,
+    key_type_of<Curve> vp_max, int z_level, scan_stats* stats, const cancellation_token* cancel) {
+  scan_stats local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    group_builder groups;
+    const auto first = search(points, points.keys.begin(), points.keys.end(), Curve::rect_first(vp_min, vp_max));
+    const auto last = search_after(points, first, points.keys.end(), Curve::rect_last(vp_min, vp_max));
+    scan_stats& res_stats = stats ? *stats : local_stats;
+    res_stats.searches += 2;
+    scan_cells<Curve>(
+        codec, first, last, false, make_query(codec, points, vp_min, vp_max, z_level, cancel), groups, res_stats);
+    return std::move(groups).finish();
+  });
+}
+
+template <typename Curve>
+std::vector<point_group> generalize_ranges(const basic_sorted_keys<key_type_of<Curve>>& points,
+    key_type_of<Curve> vp_min, key_type_of<Curve> vp_max, int z_level, size_t max_ranges, scan_stats* stats,
+    const cancellation_token* cancel) {
+  scan_stats local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    group_builder groups;
+    scan_ranges<Curve>(codec, Curve::decompose(vp_min, vp_max, max_ranges),
+        make_query(codec, points, vp_min, vp_max, z_level, cancel), groups, stats ? *stats : local_stats);
+    return std::move(groups).finish();
+  });
+}
+
+template <typename Curve>
+std::vector<point_group> generalize(const key_blocks& blocks, uint64_t vp_min, uint64_t vp_max, int z_level,
+    size_t max_ranges, scan_stats* stats, const cancellation_token* cancel) {
+  scan_stats local_stats;
+  scan_stats& res_stats = stats ? *stats : local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    const point rect_min = codec.decode(vp_min);
+    const point rect_max = codec.decode(vp_max);
+    const cell_layout cells{z_level};
+    group_builder groups;
+    // Keys are pulled one by one so decoding stops at the end of the last interval and out of rect runs are skipped
+    // without decoding the blocks they cover
+    key_blocks::decoder decoder{blocks};
+    std::optional<uint64_t> key;
+    for (const morton::z_range& range : Curve::decompose(vp_min, vp_max, max_ranges)) {
+      if (!key || *key < range.min) {
+        key = decoder.skip_to(range.min);
+        ++res_stats.searches;
+      }
+      bool in_run = false;
+      while (key && *key <= range.max && !is_cancelled(cancel)) {
+        if (!range.exact && !is_in_rect(codec.decode(*key), rect_min, rect_max)) {
+          ++res_stats.keys_scanned;
+          ++res_stats.bigmin_jumps;
+          ++res_stats.searches;
+          key = decoder.skip_to(Curve::bigmin(*key, vp_min, vp_max));
+          in_run = false;
+          continue;
+        }
+        res_stats.runs += in_run ? 0 : 1;
+        in_run = true;
+
+        // Like in the other overloads the whole part of the cell inside of the interval is taken once its first key
+        // is in the rect
+        const uint64_t next_cell_start = cells.next_cell(*key);
+        const uint64_t last = next_cell_start == 0 ? range.max : std::min(range.max, next_cell_start - 1);
+        cell_sum sum{cells.cell_of(*key), 0, 0, 0};
+        for (; key && *key <= last; key = decoder.next()) {
+          const point pt = codec.decode(*key);
+          sum.x_sum += pt.x;
+          sum.y_sum += pt.y;
+          ++sum.count;
+        }
+        ++res_stats.searches;
+        res_stats.keys_scanned += sum.count;
+        groups.add(sum);
+      }
+    }
+    res_stats.blocks_decoded += decoder.blocks_decoded();
+    return std::move(groups).finish();
+  });
+}
+
+template <typename Curve>
+cell_pyramid::cell_pyramid(const std::vector<uint64_t>& points, Curve) {
+  const cell_layout finest_cells{max_z_level};
+  std::vector<cell_sum>& finest = levels_[max_z_level];
+  std::array<point, decode_batch_size> decoded;
+  for (size_t pos = 0; pos < points.size(); pos += decoded.size()) {
+    const size_t batch_size = std::min(points.size() - pos, decoded.size());
+    Curve::decode_n(points.data() + pos, batch_size, decoded.data());
+    for (size_t i = 0; i < batch_size; ++i) {
+      const uint64_t cell = finest_cells.cell_of(points[pos + i]);
+      if (finest.empty() || finest.back().cell != cell)
+        finest.push_back({cell, 0, 0, 0});
+      finest.back().x_sum += decoded[i].x;
+      finest.back().y_sum += decoded[i].y;
+      ++finest.back().count;
+    }
+  }
+
+  for (int z_level = max_z_level - 1; z_level >= 0; --z_level) {
+    const cell_layout cells{z_level};
+    std::vector<cell_sum>& level = levels_[z_level];
+    for (const cell_sum& child : levels_[z_level + 1]) {
+      const uint64_t cell = cells.cell_of(child.cell);
+      if (level.empty() || level.back().cell != cell) {
+        level.push_back({cell, child.x_sum, child.y_sum, child.count});
+        continue;
+      }
+      level.back().x_sum += child.x_sum;
+      level.back().y_sum += child.y_sum;
+      level.back().count += child.count;
+    }
+  }
+}
+
+template <typename Curve>
+std::vector<point_group> generalize(const cell_pyramid& pyramid, uint64_t vp_min, uint64_t vp_max, int z_level,
+    scan_stats* stats, const cancellation_token* cancel) {
+  assert(z_level >= 0 && z_level <= max_z_level);
+  scan_stats local_stats;
+  scan_stats& res_stats = stats ? *stats : local_stats;
+  const cell_layout cells{z_level};
+  // Cell overlaps the rect if its top left corner is inside the rect extended to the cell boundary
+  const point rect_min = cells.corner_of(Curve::decode(vp_min));
+  const point rect_max = Curve::decode(vp_max);
+  const uint64_t cells_min = Curve::code(rect_min);
+
+  const auto by_cell = [](const cell_sum& sum, uint64_t code) { return sum.cell < code; };
+  const std::vector<cell_sum>& level = pyramid.level(z_level);
+  auto first =
+      std::lower_bound(level.begin(), level.end(), cells.cell_of(Curve::rect_first(cells_min, vp_max)), by_cell);
+  const auto last = std::upper_bound(first, level.end(), cells.cell_of(Curve::rect_last(cells_min, vp_max)),
+      [](uint64_t code, const cell_sum& sum) { return code < sum.cell; });
+  res_stats.searches += 2;
+
+  std::vector<point_group> res;
+  bool in_run = false;
+  while (first != last && !is_cancelled(cancel)) {
+    ++res_stats.keys_scanned;
+    if (!is_in_rect(cells.corner_of(Curve::decode(first->cell)), rect_min, rect_max)) {
+      ++res_stats.bigmin_jumps;
+      ++res_stats.searches;
+      first = std::lower_bound(first, last, cells.cell_of(Curve::bigmin(first->cell, cells_min, vp_max)), by_cell);
+      in_run = false;
+      continue;
+    }
+    res_stats.runs += in_run ? 0 : 1;
+    in_run = true;
+    res.push_back(to_point_group(*first));
+    ++first;
+  }
+  return res;
+}
+
+template <typename Curve>
+prefix_sums::prefix_sums(const std::vector<uint64_t>& points, Curve)
+    : x_sums_(points.size() + 1), y_sums_(points.size() + 1) {
+  std::array<point, decode_batch_size> decoded;
+  for (size_t pos = 0; pos < points.size(); pos += decoded.size()) {
+    const size_t batch_size = std::min(points.size() - pos, decoded.size());
+    Curve::decode_n(points.data() + pos, batch_size, decoded.data());
+    for (size_t i = 0; i < batch_size; ++i) {
+      x_sums_[pos + i + 1] = x_sums_[pos + i] + decoded[i].x;
+      y_sums_[pos + i + 1] = y_sums_[pos + i] + decoded[i].y;
+    }
+  }
+}
+
+template <typename Curve>
+std::vector<point_group> generalize(const sorted_keys& points, const prefix_sums& sums, uint64_t vp_min,
+    uint64_t vp_max, int z_level, scan_stats* stats, const cancellation_token* cancel) {
+  scan_stats local_stats;
+  scan_stats& res_stats = stats ? *stats : local_stats;
+  const cell_layout cells{z_level};
+  const point rect_min = cells.corner_of(Curve::decode(vp_min));
+  const point rect_max = Curve::decode(vp_max);
+  const uint64_t cells_min = Curve::code(rect_min);
+
+  // Cells on the rect border may contain points after the last rect key so the scanned range ends at the end of its
+  // cell.
+  const uint64_t cells_end = cells.next_cell(Curve::rect_last(cells_min, vp_max));
+  const auto& keys = points.keys;
+  auto first = search(points, keys.begin(), keys.end(), cells.cell_of(Curve::rect_first(cells_min, vp_max)));
+  const auto last = cells_end == 0 ? keys.end() : search(points, first, keys.end(), cells_end);
+  res_stats.searches += 2;
+
+  std::vector<point_group> res;
+  bool in_run = false;
+  while (first != last && !is_cancelled(cancel)) {
+    const uint64_t cell = cells.cell_of(*first);
+    ++res_stats.keys_scanned;
+    if (!is_in_rect(cells.corner_of(Curve::decode(cell)), rect_min, rect_max)) {
+      ++res_stats.bigmin_jumps;
+      ++res_stats.searches;
+      first = search(points, first, last, cells.cell_of(Curve::bigmin(cell, cells_min, vp_max)));
+      in_run = false;
+      continue;
+    }
+    res_stats.runs += in_run ? 0 : 1;
+    in_run = true;
+    const uint64_t next_cell_start = cells.next_cell(cell);
+    const auto cell_end = next_cell_start == 0 ? last : gallop_lower_bound(first, last, next_cell_start);
+    ++res_stats.searches;
+    const auto first_pos = static_cast<size_t>(first - keys.begin());
+    const auto end_pos = static_cast<size_t>(cell_end - keys.begin());
+    res.push_back(to_point_group({cell, sums.x_sum(end_pos) - sums.x_sum(first_pos),
+        sums.y_sum(end_pos) - sums.y_sum(first_pos), static_cast<int>(end_pos - first_pos)}));
+    first = cell_end;
+  }
+  return res;
+}
+
+template cell_pyramid::cell_pyramid(const std::vector<uint64_t>&, morton::curve);
+template prefix_sums::prefix_sums(const std::vector<uint64_t>&, morton::curve);
+template std::vector<point_group> generalize<morton::curve>(
+    const sorted_keys&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize_ranges<morton::curve>(
+    const sorted_keys&, uint64_t, uint64_t, int, size_t, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<morton::curve>(
+    const key_blocks&, uint64_t, uint64_t, int, size_t, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<morton::curve>(
+    const cell_pyramid&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<morton::curve>(
+    const sorted_keys&, const prefix_sums&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+
+template cell_pyramid::cell_pyramid(const std::vector<uint64_t>&, hilbert::curve);
+template prefix_sums::prefix_sums(const std::vector<uint64_t>&, hilbert::curve);
+template std::vector<point_group> generalize<hilbert::curve>(
+    const sorted_keys&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize_ranges<hilbert::curve>(
+    const sorted_keys&, uint64_t, uint64_t, int, size_t, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<hilbert::curve>(
+    const key_blocks&, uint64_t, uint64_t, int, size_t, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<hilbert::curve>(
+    const cell_pyramid&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize<hilbert::curve>(
+    const sorted_keys&, const prefix_sums&, uint64_t, uint64_t, int, scan_stats*, const cancellation_token*);
+
+template std::vector<point_group> generalize<morton::quantized_curve>(
+    const basic_sorted_keys<uint32_t>&, uint32_t, uint32_t, int, scan_stats*, const cancellation_token*);
+template std::vector<point_group> generalize_ranges<morton::quantized_curve>(
+    const basic_sorted_keys<uint32_t>&, uint32_t, uint32_t, int, size_t, scan_stats*, const cancellation_token*);
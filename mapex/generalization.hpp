@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/search_index.hpp>
+
+/// Group of points reported by generalization. `centroid` is the mean of the group points.
+struct point_group {
+  point centroid;
+  int count;
+};
+
+constexpr bool operator==(const point_group& l, const point_group& r) noexcept {
+  return l.centroid == r.centroid && l.count == r.count;
+}
+
+/// Sum of the coordinates of all points in a single cell. `cell` is the smallest key of the cell.
+struct cell_sum {
+  uint64_t cell;
+  uint64_t x_sum;
+  uint64_t y_sum;
+  int count;
+};
+
+/// Counters of the work done by a single generalization call.
+struct scan_stats {
+  /// Number of contiguous runs of keys or cells reported without a jump between them
+  size_t runs = 0;
+  size_t keys_scanned = 0;
+  size_t bigmin_jumps = 0;
+  size_t searches = 0;
+  size_t blocks_decoded = 0;
+};
+
+/// Flag shared between the generalization calls and the code waiting for their results. Once it is set from any thread
+/// the calls stop at the next cell and return incomplete results which must be dropped.
+class cancellation_token {
+public:
+  void cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+  bool is_cancelled() const noexcept { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<bool> cancelled_{false};
+};
+
+constexpr unsigned cell_pixel_size_log2 = 5;
+constexpr unsigned tile_pixel_size_log2 = 8;
+constexpr unsigned world_coord_range_log2 = 32;
+
+/// Log2 of the side of a generalization cell in world coordinates at the `z_level`.
+constexpr unsigned cell_coord_bits(int z_level) noexcept {
+  return world_coord_range_log2 - (tile_pixel_size_log2 - cell_pixel_size_log2 + z_level);
+}
+
+constexpr int max_z_level = 16;
+
+constexpr size_t default_max_ranges = 64;
+// Every key of a range has to be decoded when keys are kept in blocks so finer decomposition pays off sooner than for
+// the plain keys which are skipped with bigmin.
+constexpr size_t default_block_ranges = 256;
+
+/// Precomputed cell sums of sorted keys for every z-level in [0, max_z_level]. Allows to generalize a viewport
+/// in time depending on the number of visible cells instead of the number of visible points.
+class cell_pyramid {
+public:
+  cell_pyramid() = default;
+  template <typename Curve = morton::curve>
+  explicit cell_pyramid(const std::vector<uint64_t>& points, Curve curve = {});
+
+  /// Cell sums of the `z_level` sorted by cell code.
+  const std::vector<cell_sum>& level(int z_level) const noexcept { return levels_[z_level]; }
+
+private:
+  std::array<std::vector<cell_sum>, max_z_level + 1> levels_;
+};
+
+/// Cumulative coordinate sums of sorted keys. Sums of any cell are the difference of the prefix sums at the
+/// positions of the first point of the cell and the first point of the next cell. Point count is the difference of the
+/// positions themselves.
+class prefix_sums {
+public:
+  prefix_sums() = default;
+  template <typename Curve = morton::curve>
+  explicit prefix_sums(const std::vector<uint64_t>& points, Curve curve = {});
+
+  /// Sum of x coordinates of first `count` points.
+  uint64_t x_sum(size_t count) const noexcept { return x_sums_[count]; }
+  /// Sum of y coordinates of first `count` points.
+  uint64_t y_sum(size_t count) const noexcept { return y_sums_[count]; }
+
+private:
+  std::vector<uint64_t> x_sums_;
+  std::vector<uint64_t> y_sums_;
+};
+
+/// Key type of the `Curve` policy.
+template <typename Curve>
+using key_type_of = typename Curve::key_type;
+
+// Generalization functions are instantiated for `morton::curve` and `hilbert::curve` policies. Keys, pyramids and
+// prefix sums passed to them must be built with the same curve. Viewport corners `vp_min` and `vp_max` are the keys of
+// the top left and the bottom right corners of the rect. Calls are stopped early if the `cancel` token is set. Plain
+// sorted keys overloads are also instantiated for `morton::quantized_curve`.
+
+/// Groups sorted keys `points` lying in the rect with corners `vp_min` and `vp_max` by cells of `z_level`.
+/// Scans the whole key range of the rect skipping out of rect runs with bigmin. Long distance searches use the index
+/// of `points` if it is provided.
+template <typename Curve = morton::curve>
+std::vector<point_group> generalize(const basic_sorted_keys<key_type_of<Curve>>& points, key_type_of<Curve> vp_min,
+    key_type_of<Curve> vp_max, int z_level, scan_stats* stats = nullptr, const cancellation_token* cancel = nullptr);
+
+/// Same as `generalize` but splits the rect into at most `max_ranges` key intervals with `Curve::decompose` and
+/// searches each interval directly. Bigmin skipping is only performed inside of the intervals which are not exact.
+template <typename Curve = morton::curve>
+std::vector<point_group> generalize_ranges(const basic_sorted_keys<key_type_of<Curve>>& points,
+    key_type_of<Curve> vp_min, key_type_of<Curve> vp_max, int z_level, size_t max_ranges = default_max_ranges,
+    scan_stats* stats = nullptr, const cancellation_token* cancel = nullptr);
+
+/// Same as `generalize_ranges` over the keys kept compressed in `blocks`. Decodes only the blocks overlapping the
+/// rect key intervals.
+template <typename Curve = morton::curve>
+std::vector<point_group> generalize(const key_blocks& blocks, uint64_t vp_min, uint64_t vp_max, int z_level,
+    size_t max_ranges = default_block_ranges, scan_stats* stats = nullptr, const cancellation_token* cancel = nullptr);
+
+/// Reports cells of `pyramid.level(z_level)` overlapping the rect with corners `vp_min` and `vp_max`. Unlike the other
+/// overloads reports sums of all points in the cells on the rect border.
+template <typename Curve = morton::curve>
+std::vector<point_group> generalize(const cell_pyramid& pyramid, uint64_t vp_min, uint64_t vp_max, int z_level,
+    scan_stats* stats = nullptr, const cancellation_token* cancel = nullptr);
+
+/// Reports cells overlapping the rect with corners `vp_min` and `vp_max` computing their sums with two lookups of
+/// prefix `sums` of `points`. Like the pyramid overload reports sums of all points in the cells on the rect border.
+template <typename Curve = morton::curve>
+std::vector<point_group> generalize(const sorted_keys& points, const prefix_sums& sums, uint64_t vp_min,
+    uint64_t vp_max, int z_level, scan_stats* stats = nullptr, const cancellation_token* cancel = nullptr);
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/generalization.hpp>
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/search_index.hpp>
+#include <mapex/test_helpers.hpp>
+
+namespace {
+
+int total_count(const std::vector<point_group>& groups) {
+  int res = 0;
+  for (const point_group& group : groups)
+    res += group.count;
+  return res;
+}
+
+} // namespace
+
+class generalization_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_points(size_t count, unsigned coord_bits) {
+    std::uniform_int_distribution<uint32_t> dist{0, ~uint32_t{0} >> (32 - coord_bits)};
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return morton::code({dist(rnd_engine_), dist(rnd_engine_)}); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  void random_cell_aligned_rects() {
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+
+    for (int z_level = 0; z_level <= 16; ++z_level) {
+      const unsigned bits = cell_coord_bits(z_level);
+      std::uniform_int_distribution<uint32_t> cell_dist{0, ~uint32_t{0} >> bits};
+      for (int i = 0; i < 10; ++i) {
+        point min{cell_dist(rnd_engine_), cell_dist(rnd_engine_)};
+        point max{cell_dist(rnd_engine_), cell_dist(rnd_engine_)};
+        if (min.x > max.x)
+          std::swap(min.x, max.x);
+        if (min.y > max.y)
+          std::swap(min.y, max.y);
+        min = {min.x << bits, min.y << bits};
+        max = {(max.x << bits) | (~uint32_t{0} >> (32 - bits)), (max.y << bits) | (~uint32_t{0} >> (32 - bits))};
+        QTest::addRow("z%d/%d", z_level, i) << z_level << morton::code(min) << morton::code(max);
+      }
+    }
+  }
+
+  void random_rects() {
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+
+    std::uniform_int_distribution<uint32_t> dist;
+    for (int z_level = 0; z_level <= max_z_level; ++z_level) {
+      for (int i = 0; i < 10; ++i) {
+        point min{dist(rnd_engine_), dist(rnd_engine_)};
+        point max{dist(rnd_engine_), dist(rnd_engine_)};
+        if (min.x > max.x)
+          std::swap(min.x, max.x);
+        if (min.y > max.y)
+          std::swap(min.y, max.y);
+        QTest::addRow("z%d/%d", z_level, i) << z_level << morton::code(min) << morton::code(max);
+      }
+    }
+  }
+
+private slots:
+  void initTestCase() {
+    points_ = gen_points(0x10'0000, 32);
+    pyramid_ = cell_pyramid{points_};
+    sums_ = prefix_sums{points_};
+    index_ = search_index{points_};
+    blocks_ = key_blocks{points_};
+
+    hilbert_points_.resize(points_.size());
+    std::transform(points_.begin(), points_.end(), hilbert_points_.begin(), hilbert::from_morton);
+    std::sort(hilbert_points_.begin(), hilbert_points_.end());
+    hilbert_pyramid_ = cell_pyramid{hilbert_points_, hilbert::curve{}};
+    hilbert_sums_ = prefix_sums{hilbert_points_, hilbert::curve{}};
+    hilbert_blocks_ = key_blocks{hilbert_points_};
+
+    quantized_points_.resize(points_.size());
+    std::transform(points_.begin(), points_.end(), quantized_points_.begin(), morton::quantize);
+    quantized_index_ = basic_search_index<uint32_t>{quantized_points_};
+    snapped_points_.resize(points_.size());
+    std::transform(quantized_points_.begin(), quantized_points_.end(), snapped_points_.begin(),
+        [](uint32_t key) { return morton::code(morton::quantized_curve::decode(key)); });
+  }
+
+  void ranges_and_scan_give_same_groups_for_cell_aligned_rect_data() { random_cell_aligned_rects(); }
+  void ranges_and_scan_give_same_groups_for_cell_aligned_rect() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QVERIFY(generalize_ranges(points_, min, max, z_level) == generalize(points_, min, max, z_level));
+  }
+
+  void scan_counts_all_points_of_cell_aligned_rect_data() { random_cell_aligned_rects(); }
+  void scan_counts_all_points_of_cell_aligned_rect() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const auto expected = std::count_if(points_.begin(), points_.end(),
+        [&](uint64_t code) { return is_in_rect(morton::decode(code), morton::decode(min), morton::decode(max)); });
+    QCOMPARE(total_count(generalize(points_, min, max, z_level)), static_cast<int>(expected));
+  }
+
+  void pyramid_and_scan_give_same_groups_for_cell_aligned_rect_data() { random_cell_aligned_rects(); }
+  void pyramid_and_scan_give_same_groups_for_cell_aligned_rect() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QVERIFY(generalize(pyramid_, min, max, z_level) == generalize(points_, min, max, z_level));
+  }
+
+  void prefix_sums_and_pyramid_give_same_groups_data() { random_rects(); }
+  void prefix_sums_and_pyramid_give_same_groups() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QVERIFY(generalize(points_, sums_, min, max, z_level) == generalize(pyramid_, min, max, z_level));
+  }
+
+  void indexed_search_gives_same_groups_data() { random_rects(); }
+  void indexed_search_gives_same_groups() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const sorted_keys indexed{points_, &index_};
+    QVERIFY(generalize(indexed, min, max, z_level) == generalize(points_, min, max, z_level));
+    QVERIFY(generalize_ranges(indexed, min, max, z_level) == generalize_ranges(points_, min, max, z_level));
+    QVERIFY(generalize(indexed, sums_, min, max, z_level) == generalize(points_, sums_, min, max, z_level));
+  }
+
+  void blocks_and_ranges_give_same_groups_data() { random_rects(); }
+  void blocks_and_ranges_give_same_groups() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QVERIFY(generalize(blocks_, min, max, z_level) ==
+            generalize_ranges(points_, min, max, z_level, default_block_ranges));
+    const uint64_t hmin = hilbert::from_morton(min);
+    const uint64_t hmax = hilbert::from_morton(max);
+    QVERIFY(generalize<hilbert::curve>(hilbert_blocks_, hmin, hmax, z_level) ==
+            generalize_ranges<hilbert::curve>(hilbert_points_, hmin, hmax, z_level, default_block_ranges));
+  }
+
+  void blocks_decodes_only_blocks_of_small_rect() {
+    const point center{uint32_t{1} << 31, uint32_t{1} << 31};
+    const uint32_t half_side = uint32_t{1} << 24;
+    scan_stats stats;
+    generalize(blocks_, morton::code({center.x - half_side, center.y - half_side}),
+        morton::code({center.x + half_side, center.y + half_side}), max_z_level, default_block_ranges, &stats);
+    QVERIFY(stats.blocks_decoded > 0);
+    QVERIFY(stats.blocks_decoded < blocks_.headers().size() / 100);
+  }
+
+  void hilbert_and_morton_scans_give_same_groups_for_cell_aligned_rect_data() { random_cell_aligned_rects(); }
+  void hilbert_and_morton_scans_give_same_groups_for_cell_aligned_rect() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const uint64_t hmin = hilbert::from_morton(min);
+    const uint64_t hmax = hilbert::from_morton(max);
+    QVERIFY(sorted(generalize<hilbert::curve>(hilbert_points_, hmin, hmax, z_level)) ==
+            sorted(generalize(points_, min, max, z_level)));
+    QVERIFY(sorted(generalize_ranges<hilbert::curve>(hilbert_points_, hmin, hmax, z_level)) ==
+            sorted(generalize_ranges(points_, min, max, z_level)));
+  }
+
+  void hilbert_and_morton_cell_sums_give_same_groups_data() { random_rects(); }
+  void hilbert_and_morton_cell_sums_give_same_groups() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const uint64_t hmin = hilbert::from_morton(min);
+    const uint64_t hmax = hilbert::from_morton(max);
+    QVERIFY(sorted(generalize<hilbert::curve>(hilbert_pyramid_, hmin, hmax, z_level)) ==
+            sorted(generalize(pyramid_, min, max, z_level)));
+    QVERIFY(sorted(generalize<hilbert::curve>(hilbert_points_, hilbert_sums_, hmin, hmax, z_level)) ==
+            sorted(generalize(points_, sums_, min, max, z_level)));
+  }
+
+  void quantized_keys_give_groups_of_snapped_points_data() { random_rects(); }
+  void quantized_keys_give_groups_of_snapped_points() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    using curve = morton::quantized_curve;
+    const uint32_t qmin = morton::quantize(min);
+    const uint32_t qmax = morton::quantize(max);
+    const uint64_t snapped_min = morton::code(curve::decode(qmin));
+    const uint64_t snapped_max = morton::code(curve::decode(qmax));
+    const auto expected = generalize(snapped_points_, snapped_min, snapped_max, z_level);
+    const basic_sorted_keys<uint32_t> indexed{quantized_points_, &quantized_index_};
+    QVERIFY(generalize<curve>(quantized_points_, qmin, qmax, z_level) == expected);
+    QVERIFY(generalize<curve>(indexed, qmin, qmax, z_level) == expected);
+  }
+
+  void quantized_ranges_and_scan_give_same_groups_for_cell_aligned_rect_data() { random_cell_aligned_rects(); }
+  void quantized_ranges_and_scan_give_same_groups_for_cell_aligned_rect() {
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    using curve = morton::quantized_curve;
+    const uint32_t qmin = morton::quantize(min);
+    const uint32_t qmax = morton::quantize(max);
+    const basic_sorted_keys<uint32_t> indexed{quantized_points_, &quantized_index_};
+    QVERIFY(generalize_ranges<curve>(indexed, qmin, qmax, z_level) ==
+            generalize<curve>(quantized_points_, qmin, qmax, z_level));
+  }
+
+  void pyramid_reports_whole_border_cells() {
+    const point center{uint32_t{1} << 31, uint32_t{1} << 31};
+    for (int z_level = 0; z_level <= max_z_level; ++z_level) {
+      const unsigned bits = cell_coord_bits(z_level);
+      const uint64_t min = morton::code({center.x - (uint32_t{1} << (bits - 1)), center.y});
+      const uint64_t max = morton::code({center.x, center.y + 1});
+      const uint64_t cells_min = morton::code({center.x - (uint32_t{1} << bits), center.y});
+      const uint32_t cell_last = ~uint32_t{0} >> (32 - bits);
+      const uint64_t cells_max = morton::code({center.x + cell_last, center.y + cell_last});
+      QVERIFY(generalize(pyramid_, min, max, z_level) == generalize(points_, cells_min, cells_max, z_level));
+    }
+  }
+
+  void exact_ranges_count_only_rect_points() {
+    constexpr unsigned coord_bits = 12;
+    const auto points = gen_points(0x1'0000, coord_bits);
+    std::uniform_int_distribution<uint32_t> dist{0, ~uint32_t{0} >> (32 - coord_bits)};
+    for (int i = 0; i < 100; ++i) {
+      point min{dist(rnd_engine_), dist(rnd_engine_)};
+      point max{dist(rnd_engine_), dist(rnd_engine_)};
+      if (min.x > max.x)
+        std::swap(min.x, max.x);
+      if (min.y > max.y)
+        std::swap(min.y, max.y);
+      const auto expected = std::count_if(
+          points.begin(), points.end(), [&](uint64_t code) { return is_in_rect(morton::decode(code), min, max); });
+      scan_stats stats;
+      const auto groups = generalize_ranges(points, morton::code(min), morton::code(max), 16, 0x1'0000, &stats);
+      QCOMPARE(total_count(groups), static_cast<int>(expected));
+      QCOMPARE(stats.bigmin_jumps, size_t{0});
+    }
+  }
+
+  void cancelled_calls_stop_scanning() {
+    const uint64_t min = morton::code({0, 0});
+    const uint64_t max = morton::code({~uint32_t{0}, ~uint32_t{0}});
+    const int z_level = 4;
+    cancellation_token cancel;
+    cancel.cancel();
+    scan_stats stats;
+    QVERIFY(generalize(points_, min, max, z_level, &stats, &cancel).empty());
+    QVERIFY(generalize_ranges(points_, min, max, z_level, default_max_ranges, &stats, &cancel).empty());
+    QVERIFY(generalize(blocks_, min, max, z_level, default_block_ranges, &stats, &cancel).empty());
+    QVERIFY(generalize(pyramid_, min, max, z_level, &stats, &cancel).empty());
+    QVERIFY(generalize(points_, sums_, min, max, z_level, &stats, &cancel).empty());
+    QCOMPARE(stats.keys_scanned, size_t{0});
+    QVERIFY(!generalize(points_, min, max, z_level, &stats).empty());
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  std::vector<uint64_t> points_;
+  cell_pyramid pyramid_;
+  prefix_sums sums_;
+  search_index index_;
+  key_blocks blocks_;
+  std::vector<uint64_t> hilbert_points_;
+  cell_pyramid hilbert_pyramid_;
+  prefix_sums hilbert_sums_;
+  key_blocks hilbert_blocks_;
+  std::vector<uint32_t> quantized_points_;
+  basic_search_index<uint32_t> quantized_index_;
+  // Full keys of the quantized points decoded to the centers of their squares
+  std::vector<uint64_t> snapped_points_;
+};
+
+QTEST_MAIN(generalization_tests)
+#include "generalization.test.moc"
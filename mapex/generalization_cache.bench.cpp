@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/generalization.hpp>
+#include <mapex/generalization_cache.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 0x40'0000;
+// Points are spread over a square with the side of 2^24 world units around the world center which is close to a
+// size of a big city.
+constexpr uint32_t area_side_log2 = 24;
+constexpr uint32_t area_min = (uint32_t{1} << 31) - (uint32_t{1} << (area_side_log2 - 1));
+
+// Full HD viewport panned diagonally by 16 pixels per frame
+constexpr point vp_size{1920, 1080};
+constexpr point pan_step{16, 9};
+constexpr int pan_frames = 240;
+
+enum class query_path { scan, pyramid, blocks };
+
+point clamped_point(int64_t x, int64_t y) noexcept {
+  constexpr int64_t world_max = (int64_t{1} << world_coord_range_log2) - 1;
+  return {static_cast<uint32_t>(std::clamp<int64_t>(x, 0, world_max)),
+      static_cast<uint32_t>(std::clamp<int64_t>(y, 0, world_max))};
+}
+
+// Areas requested by the tile widget while the viewport is panned from the world center. Area twice as large as the
+// viewport is requested once the viewport leaves the previous one.
+std::vector<std::pair<point, point>> pan_areas(int z_level) {
+  const unsigned px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+  const int64_t half_w = (int64_t{vp_size.x} << px_log2) / 2;
+  const int64_t half_h = (int64_t{vp_size.y} << px_log2) / 2;
+  std::vector<std::pair<point, point>> res;
+  for (int frame = 0; frame < pan_frames; ++frame) {
+    const int64_t x = (int64_t{1} << 31) + (int64_t{pan_step.x} * frame << px_log2);
+    const int64_t y = (int64_t{1} << 31) + (int64_t{pan_step.y} * frame << px_log2);
+    const point vp_min = clamped_point(x - half_w, y - half_h);
+    const point vp_max = clamped_point(x + half_w, y + half_h);
+    if (!res.empty() && is_in_rect(vp_min, res.back().first, res.back().second) &&
+        is_in_rect(vp_max, res.back().first, res.back().second))
+      continue;
+    res.emplace_back(clamped_point(x - 2 * half_w, y - 2 * half_h), clamped_point(x + 2 * half_w, y + 2 * half_h));
+  }
+  return res;
+}
+
+} // namespace
+
+Q_DECLARE_METATYPE(query_path);
+
+class generalization_cache_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  void pan_sequences() {
+    QTest::addColumn<query_path>("path");
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<bool>("cached");
+
+    const std::pair<const char*, query_path> paths[] = {
+        {"scan", query_path::scan}, {"pyramid", query_path::pyramid}, {"blocks", query_path::blocks}};
+    for (const auto& [path_name, path] : paths) {
+      for (int z_level : {8, 10, 12, 14, 16}) {
+        QTest::addRow("%s/z%d/from_scratch", path_name, z_level) << path << z_level << false;
+        QTest::addRow("%s/z%d/cached", path_name, z_level) << path << z_level << true;
+      }
+    }
+  }
+
+  // Runs the whole pan sequence and returns the number of generalized blocks. Without the cache every area is
+  // generalized from scratch as a single rect.
+  size_t run_pan(query_path path, int z_level, bool cached, scan_stats* stats) {
+    auto generalize_rect = [&](point min, point max) {
+      switch (path) {
+      case query_path::scan:
+        return generalize(points_, morton::code(min), morton::code(max), z_level, stats);
+      case query_path::pyramid:
+        return generalize(pyramid_, morton::code(min), morton::code(max), z_level, stats);
+      case query_path::blocks:
+        return generalize(blocks_, morton::code(min), morton::code(max), z_level, default_block_ranges, stats);
+      }
+      return std::vector<point_group>{};
+    };
+    generalization_cache cache;
+    for (const auto& [min, max] : pan_areas(z_level)) {
+      if (!cached) {
+        generalize_rect(min, max);
+        continue;
+      }
+      generalize_blocks(cache, cache.generation(), 0, min, max, z_level,
+          [&](const cell_block& block) { return generalize_rect(block.min, block.max); });
+    }
+    return cache.stats().misses;
+  }
+
+private slots:
+  void initTestCase() {
+    std::default_random_engine rnd_engine;
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + ((uint32_t{1} << area_side_log2) - 1)};
+    points_.resize(sample_size);
+    std::generate(points_.begin(), points_.end(), [&] { return morton::code({dist(rnd_engine), dist(rnd_engine)}); });
+    std::sort(points_.begin(), points_.end());
+    pyramid_ = cell_pyramid{points_};
+    blocks_ = key_blocks{points_};
+  }
+
+  void pan_time_data() { pan_sequences(); }
+  void pan_time() {
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(bool, cached);
+    QBENCHMARK { run_pan(path, z_level, cached, nullptr); }
+  }
+
+  // Work per frame of the pan sequence
+  void keys_scanned_per_frame_data() { pan_sequences(); }
+  void keys_scanned_per_frame() {
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(bool, cached);
+    if (path == query_path::pyramid)
+      QSKIP("Pyramid doesn't scan keys");
+    scan_stats stats;
+    run_pan(path, z_level, cached, &stats);
+    QTest::setBenchmarkResult(static_cast<qreal>(stats.keys_scanned) / pan_frames, QTest::Events);
+  }
+
+  void searches_per_frame_data() { pan_sequences(); }
+  void searches_per_frame() {
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(bool, cached);
+    scan_stats stats;
+    run_pan(path, z_level, cached, &stats);
+    QTest::setBenchmarkResult(static_cast<qreal>(stats.searches) / pan_frames, QTest::Events);
+  }
+
+  void blocks_generalized_per_frame_data() { pan_sequences(); }
+  void blocks_generalized_per_frame() {
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+    QFETCH(bool, cached);
+    if (!cached)
+      QSKIP("Areas are generalized as a whole without the cache");
+    const size_t blocks = run_pan(path, z_level, cached, nullptr);
+    QTest::setBenchmarkResult(static_cast<qreal>(blocks) / pan_frames, QTest::Events);
+  }
+
+private:
+  std::vector<uint64_t> points_;
+  cell_pyramid pyramid_;
+  key_blocks blocks_;
+};
+
+QTEST_MAIN(generalization_cache_benchmarks)
+#include "generalization_cache.bench.moc"
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <iterator>
+
+#include <mapex/generalization_cache.hpp>
+
+namespace {
+
+// Approximate memory used by the list node, the map node and the shared vector header of a single entry
+constexpr size_t entry_overhead = 160;
+
+constexpr point cell_corner(point pt, int z_level) noexcept {
+  const uint32_t mask = ~uint32_t{0} << cell_coord_bits(z_level);
+  return {pt.x & mask, pt.y & mask};
+}
+
+} // namespace
+
+std::vector<cell_block> cover_with_blocks(point vp_min, point vp_max, int z_level) {
+  std::vector<cell_block> res;
+  cover_with_blocks(vp_min, vp_max, z_level, res);
+  return res;
+}
+
+void cover_with_blocks(point vp_min, point vp_max, int z_level, std::vector<cell_block>& res) {
+  // Blocks of the lowest z-levels are larger than the world
+  const unsigned side_log2 = std::min(cell_coord_bits(z_level) + cell_block_size_log2, world_coord_range_log2);
+  const uint64_t side = uint64_t{1} << side_log2;
+  const uint64_t mask = ~(side - 1);
+  res.clear();
+  for (uint64_t y = vp_min.y & mask; y <= vp_max.y; y += side) {
+    for (uint64_t x = vp_min.x & mask; x <= vp_max.x; x += side) {
+      res.push_back({z_level, {static_cast<uint32_t>(x), static_cast<uint32_t>(y)},
+          {static_cast<uint32_t>(x + side - 1), static_cast<uint32_t>(y + side - 1)}});
+    }
+  }
+}
+
+void append_overlapping(
+    const std::vector<point_group>& groups, point vp_min, point vp_max, int z_level, std::vector<point_group>& res) {
+  const point min_cell = cell_corner(vp_min, z_level);
+  // Block groups bound the appended ones. Capacity still grows geometrically since blocks are appended one by one
+  if (res.capacity() - res.size() < groups.size())
+    res.reserve(std::max(res.size() + groups.size(), 2 * res.capacity()));
+  std::copy_if(groups.begin(), groups.end(), std::back_inserter(res), [&](const point_group& group) {
+    return is_in_rect(cell_corner(group.centroid, z_level), min_cell, vp_max);
+  });
+}
+
+uint64_t generalization_cache::generation() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return generation_;
+}
+
+generalization_cache::groups_ptr generalization_cache::find(
+    uint64_t generation, unsigned layer, const cell_block& block) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  const auto it = generation == generation_ ? index_.find({layer, block.z_level, block.min.x, block.min.y})
+                                            : index_.end();
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->groups;
+}
+
+void generalization_cache::insert(uint64_t generation, unsigned layer, const cell_block& block, groups_ptr groups) {
+  const key block_key{layer, block.z_level, block.min.x, block.min.y};
+  const size_t size = entry_overhead + groups->capacity() * sizeof(point_group);
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (generation != generation_ || size > memory_budget_)
+    return;
+  // Same block may be computed by concurrent queries
+  if (const auto it = index_.find(block_key); it != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+  while (stats_.memory_usage + size > memory_budget_)
+    evict_lru();
+  entries_.push_front({block_key, std::move(groups), size});
+  index_.emplace(block_key, entries_.begin());
+  stats_.memory_usage += size;
+}
+
+void generalization_cache::clear() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  ++generation_;
+  index_.clear();
+  entries_.clear();
+  stats_.memory_usage = 0;
+}
+
+generalization_cache_stats generalization_cache::stats() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return stats_;
+}
+
+void generalization_cache::evict_lru() {
+  const entry& lru = entries_.back();
+  stats_.memory_usage -= lru.size;
+  ++stats_.evictions;
+  index_.erase(lru.block_key);
+  entries_.pop_back();
+}
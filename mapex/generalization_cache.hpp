@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <mapex/generalization.hpp>
+#include <mapex/morton_code.hpp>
+
+/// Number of cells along each side of a cached block is `2^cell_block_size_log2`.
+constexpr unsigned cell_block_size_log2 = 4;
+
+constexpr size_t default_generalization_cache_budget = size_t{16} << 20;
+
+/// Square block of `z_level` cells aligned to its own size. Corners are inclusive. Blocks are aligned independently of
+/// the viewport so that overlapping viewports share them.
+struct cell_block {
+  int z_level;
+  point min;
+  point max;
+};
+
+/// Aligned blocks covering the rect with corners `vp_min` and `vp_max` row by row.
+std::vector<cell_block> cover_with_blocks(point vp_min, point vp_max, int z_level);
+/// Same as above but replaces the content of `res` reusing its memory.
+void cover_with_blocks(point vp_min, point vp_max, int z_level, std::vector<cell_block>& res);
+
+/// Appends to `res` those of the block `groups` which belong to `z_level` cells overlapping the rect with corners
+/// `vp_min` and `vp_max`.
+void append_overlapping(
+    const std::vector<point_group>& groups, point vp_min, point vp_max, int z_level, std::vector<point_group>& res);
+
+/// Counters of the cache lookups since construction.
+struct generalization_cache_stats {
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+  size_t memory_usage = 0;
+};
+
+/// LRU cache of generalization results per POI layer and cell block bounded by the approximate memory usage.
+/// Thread safe. Results computed for the data replaced by the `clear` call are never stored or returned: lookups and
+/// insertions are made for the `generation` obtained before the query start and are ignored if it is outdated.
+class generalization_cache {
+public:
+  using groups_ptr = std::shared_ptr<const std::vector<point_group>>;
+
+  explicit generalization_cache(size_t memory_budget = default_generalization_cache_budget) noexcept
+      : memory_budget_{memory_budget} {}
+
+  uint64_t generation() const;
+  /// Returns nullptr and counts a miss if the groups of the `block` are not cached for the `generation`.
+  groups_ptr find(uint64_t generation, unsigned layer, const cell_block& block);
+  /// Evicts least recently used blocks if needed. Results larger than the whole budget are not stored.
+  void insert(uint64_t generation, unsigned layer, const cell_block& block, groups_ptr groups);
+  /// Drops all cached results and starts a new generation. Counters are kept.
+  void clear();
+
+  generalization_cache_stats stats() const;
+
+private:
+  using key = std::tuple<unsigned, int, uint32_t, uint32_t>;
+  struct entry {
+    key block_key;
+    groups_ptr groups;
+    size_t size;
+  };
+
+  void evict_lru();
+
+  mutable std::mutex mutex_;
+  size_t memory_budget_;
+  uint64_t generation_ = 0;
+  // Most recently used entries go first
+  std::list<entry> entries_;
+  std::map<key, std::list<entry>::iterator> index_;
+  generalization_cache_stats stats_;
+};
+
+/// Generalizes the rect with corners `vp_min` and `vp_max` block by block over the `[first, last)` range of the blocks
+/// covering it and appends the groups to `res`. Blocks missing in the `cache` are computed with
+/// `generalize_block(const cell_block&)` and stored, so a rect overlapping the recent ones only aggregates the blocks
+/// which were not visible before and a `res` buffer reused across such rects makes no heap allocations. Reports the
+/// groups of the cells overlapping the rect in the same order regardless of which blocks were taken from the cache, so
+/// the results of consecutive ranges can be concatenated. Once the `cancel` token is set the remaining blocks are
+/// skipped and the block being generalized is not cached since its result may be incomplete.
+template <typename F>
+void generalize_blocks(generalization_cache& cache, uint64_t generation, unsigned layer,
+    std::vector<cell_block>::const_iterator first, std::vector<cell_block>::const_iterator last, point vp_min,
+    point vp_max, F&& generalize_block, std::vector<point_group>& res, const cancellation_token* cancel = nullptr) {
+  for (; first != last; ++first) {
+    const cell_block& block = *first;
+    if (cancel && cancel->is_cancelled())
+      break;
+    generalization_cache::groups_ptr groups = cache.find(generation, layer, block);
+    if (!groups) {
+      groups = std::make_shared<const std::vector<point_group>>(generalize_block(block));
+      if (cancel && cancel->is_cancelled())
+        break;
+      cache.insert(generation, layer, block, groups);
+    }
+    append_overlapping(*groups, vp_min, vp_max, block.z_level, res);
+  }
+}
+
+/// Same as above but returns the groups.
+template <typename F>
+std::vector<point_group> generalize_blocks(generalization_cache& cache, uint64_t generation, unsigned layer,
+    std::vector<cell_block>::const_iterator first, std::vector<cell_block>::const_iterator last, point vp_min,
+    point vp_max, F&& generalize_block, const cancellation_token* cancel = nullptr) {
+  std::vector<point_group> res;
+  generalize_blocks(
+      cache, generation, layer, first, last, vp_min, vp_max, std::forward<F>(generalize_block), res, cancel);
+  return res;
+}
+
+/// Same as the overload above over all the blocks covering the rect.
+template <typename F>
+std::vector<point_group> generalize_blocks(generalization_cache& cache, uint64_t generation, unsigned layer,
+    point vp_min, point vp_max, int z_level, F&& generalize_block, const cancellation_token* cancel = nullptr) {
+  const std::vector<cell_block> blocks = cover_with_blocks(vp_min, vp_max, z_level);
+  return generalize_blocks(cache, generation, layer, blocks.begin(), blocks.end(), vp_min, vp_max,
+      std::forward<F>(generalize_block), cancel);
+}
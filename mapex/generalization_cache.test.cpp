@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/generalization.hpp>
+#include <mapex/generalization_cache.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/test_helpers.hpp>
+
+namespace {
+
+enum class query_path { scan, pyramid, blocks };
+
+} // namespace
+
+Q_DECLARE_METATYPE(point);
+Q_DECLARE_METATYPE(query_path);
+
+namespace {
+
+generalization_cache::groups_ptr make_groups(size_t count) {
+  return std::make_shared<const std::vector<point_group>>(count, point_group{{}, 1});
+}
+
+constexpr cell_block block_at(uint32_t x) noexcept { return {10, {x, 0}, {x + 0xffff, 0xffff}}; }
+
+point clamped_point(int64_t x, int64_t y) noexcept {
+  constexpr int64_t world_max = (int64_t{1} << world_coord_range_log2) - 1;
+  return {static_cast<uint32_t>(std::clamp<int64_t>(x, 0, world_max)),
+      static_cast<uint32_t>(std::clamp<int64_t>(y, 0, world_max))};
+}
+
+// Areas requested while the viewport of `vp_size` pixels is moved by `step` pixels per frame from the world center.
+// Like the tile widget requests an area twice as large as the viewport once the viewport leaves the previous one.
+std::vector<std::pair<point, point>> pan_areas(int z_level, point vp_size, point step, int frames) {
+  const unsigned px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+  const int64_t half_w = (int64_t{vp_size.x} << px_log2) / 2;
+  const int64_t half_h = (int64_t{vp_size.y} << px_log2) / 2;
+  std::vector<std::pair<point, point>> res;
+  for (int frame = 0; frame < frames; ++frame) {
+    const int64_t x = (int64_t{1} << 31) + (int64_t{step.x} * frame << px_log2);
+    const int64_t y = (int64_t{1} << 31) + (int64_t{step.y} * frame << px_log2);
+    const point vp_min = clamped_point(x - half_w, y - half_h);
+    const point vp_max = clamped_point(x + half_w, y + half_h);
+    if (!res.empty() && is_in_rect(vp_min, res.back().first, res.back().second) &&
+        is_in_rect(vp_max, res.back().first, res.back().second))
+      continue;
+    res.emplace_back(clamped_point(x - 2 * half_w, y - 2 * half_h), clamped_point(x + 2 * half_w, y + 2 * half_h));
+  }
+  return res;
+}
+
+} // namespace
+
+class generalization_cache_tests : public QObject {
+  Q_OBJECT
+private slots:
+  void initTestCase() {
+    std::uniform_int_distribution<uint32_t> dist;
+    points_.resize(0x10'0000);
+    std::generate(points_.begin(), points_.end(), [&] { return morton::code({dist(rnd_engine_), dist(rnd_engine_)}); });
+    std::sort(points_.begin(), points_.end());
+    pyramid_ = cell_pyramid{points_};
+    blocks_ = key_blocks{points_};
+  }
+
+  void blocks_cover_rect_data() {
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<point>("min");
+    QTest::addColumn<point>("max");
+
+    for (int z_level = 0; z_level <= max_z_level; ++z_level) {
+      // Viewports of up to 64 cells along each side
+      const unsigned cell_bits = cell_coord_bits(z_level);
+      const uint64_t max_side = std::min(uint64_t{64} << cell_bits, uint64_t{1} << world_coord_range_log2);
+      std::uniform_int_distribution<uint32_t> side_dist{0, static_cast<uint32_t>(max_side - 1)};
+      std::uniform_int_distribution<uint32_t> dist;
+      for (int i = 0; i < 10; ++i) {
+        point min{dist(rnd_engine_), dist(rnd_engine_)};
+        const point side{side_dist(rnd_engine_), side_dist(rnd_engine_)};
+        min = {std::min(min.x, ~uint32_t{0} - side.x), std::min(min.y, ~uint32_t{0} - side.y)};
+        QTest::addRow("z%d/%d", z_level, i) << z_level << min << min + side;
+      }
+    }
+  }
+  void blocks_cover_rect() {
+    QFETCH(int, z_level);
+    QFETCH(point, min);
+    QFETCH(point, max);
+
+    const std::vector<cell_block> blocks = cover_with_blocks(min, max, z_level);
+    QVERIFY(!blocks.empty());
+    QVERIFY(blocks.front().min.x <= min.x && blocks.front().min.y <= min.y);
+    QVERIFY(blocks.back().max.x >= max.x && blocks.back().max.y >= max.y);
+    for (const cell_block& block : blocks) {
+      QCOMPARE(block.z_level, z_level);
+      const uint64_t side = uint64_t{block.max.x} - block.min.x + 1;
+      QCOMPARE(uint64_t{block.max.y} - block.min.y + 1, side);
+      QCOMPARE(block.min.x % side, uint64_t{0});
+      QCOMPARE(block.min.y % side, uint64_t{0});
+    }
+  }
+
+  void blockwise_generalization_matches_rect_generalization_data() { blocks_cover_rect_data(); }
+  void blockwise_generalization_matches_rect_generalization() {
+    QFETCH(int, z_level);
+    QFETCH(point, min);
+    QFETCH(point, max);
+
+    std::vector<point_group> blockwise;
+    for (const cell_block& block : cover_with_blocks(min, max, z_level)) {
+      append_overlapping(generalize(pyramid_, morton::code(block.min), morton::code(block.max), z_level), min, max,
+          z_level, blockwise);
+    }
+    QVERIFY(sorted(blockwise) == sorted(generalize(pyramid_, morton::code(min), morton::code(max), z_level)));
+  }
+
+  void concatenated_block_ranges_match_whole_rect_data() { blocks_cover_rect_data(); }
+  void concatenated_block_ranges_match_whole_rect() {
+    QFETCH(int, z_level);
+    QFETCH(point, min);
+    QFETCH(point, max);
+
+    auto generalize_block = [&](const cell_block& block) {
+      return generalize(points_, morton::code(block.min), morton::code(block.max), z_level);
+    };
+    generalization_cache cache{0};
+    const auto whole = generalize_blocks(cache, cache.generation(), 0, min, max, z_level, generalize_block);
+    const auto blocks = cover_with_blocks(min, max, z_level);
+    for (size_t parts : {2, 3, 7}) {
+      std::vector<point_group> concatenated;
+      for (size_t part = 0; part < parts; ++part) {
+        const auto groups = generalize_blocks(cache, cache.generation(), 0,
+            blocks.begin() + blocks.size() * part / parts, blocks.begin() + blocks.size() * (part + 1) / parts, min,
+            max, generalize_block);
+        concatenated.insert(concatenated.end(), groups.begin(), groups.end());
+      }
+      QVERIFY(concatenated == whole);
+    }
+  }
+
+  void block_ranges_appended_to_reused_buffer_match_whole_rect_data() { blocks_cover_rect_data(); }
+  void block_ranges_appended_to_reused_buffer_match_whole_rect() {
+    QFETCH(int, z_level);
+    QFETCH(point, min);
+    QFETCH(point, max);
+
+    auto generalize_block = [&](const cell_block& block) {
+      return generalize(points_, morton::code(block.min), morton::code(block.max), z_level);
+    };
+    generalization_cache cache;
+    const auto whole = generalize_blocks(cache, cache.generation(), 0, min, max, z_level, generalize_block);
+    std::vector<cell_block> blocks{{z_level, {0, 0}, {0, 0}}};
+    cover_with_blocks(min, max, z_level, blocks);
+    QCOMPARE(blocks.size(), cover_with_blocks(min, max, z_level).size());
+    std::vector<point_group> res;
+    for (size_t parts : {7, 3, 1}) {
+      res.clear();
+      for (size_t part = 0; part < parts; ++part) {
+        generalize_blocks(cache, cache.generation(), 0, blocks.begin() + blocks.size() * part / parts,
+            blocks.begin() + blocks.size() * (part + 1) / parts, min, max, generalize_block, res);
+      }
+      QVERIFY(res == whole);
+    }
+  }
+
+  void panning_reuses_blocks_data() {
+    QTest::addColumn<query_path>("path");
+    QTest::addColumn<int>("z_level");
+
+    const std::pair<const char*, query_path> paths[] = {
+        {"scan", query_path::scan}, {"pyramid", query_path::pyramid}, {"blocks", query_path::blocks}};
+    for (const auto& [name, path] : paths) {
+      for (int z_level : {0, 4, 8, 12, 16})
+        QTest::addRow("%s/z%d", name, z_level) << path << z_level;
+    }
+  }
+  void panning_reuses_blocks() {
+    QFETCH(query_path, path);
+    QFETCH(int, z_level);
+
+    auto generalize_block = [&](const cell_block& block) {
+      const uint64_t min = morton::code(block.min);
+      const uint64_t max = morton::code(block.max);
+      switch (path) {
+      case query_path::scan:
+        return generalize(points_, min, max, z_level);
+      case query_path::pyramid:
+        return generalize(pyramid_, min, max, z_level);
+      case query_path::blocks:
+        return generalize(blocks_, min, max, z_level);
+      }
+      return std::vector<point_group>{};
+    };
+    generalization_cache cache;
+    size_t misses = 0;
+    for (const auto& [min, max] : pan_areas(z_level, {1024, 768}, {40, 25}, 100)) {
+      generalization_cache from_scratch;
+      const auto expected = generalize_blocks(from_scratch, from_scratch.generation(), 0, min, max, z_level,
+          generalize_block);
+      QVERIFY(generalize_blocks(cache, cache.generation(), 0, min, max, z_level, generalize_block) == expected);
+      QVERIFY(sorted(expected) == sorted(generalize(pyramid_, morton::code(min), morton::code(max), z_level)));
+      misses += from_scratch.stats().misses;
+    }
+    // Only the blocks exposed by the panning are generalized
+    QVERIFY(cache.stats().hits != 0 || z_level < 4);
+    QCOMPARE(cache.stats().hits + cache.stats().misses, misses);
+  }
+
+  void lookups_are_counted() {
+    generalization_cache cache;
+    const uint64_t generation = cache.generation();
+    QVERIFY(!cache.find(generation, 0, block_at(0)));
+    const auto groups = make_groups(10);
+    cache.insert(generation, 0, block_at(0), groups);
+    QCOMPARE(cache.find(generation, 0, block_at(0)), groups);
+    QVERIFY(!cache.find(generation, 1, block_at(0)));
+    QVERIFY(!cache.find(generation, 0, block_at(0x10000)));
+
+    const generalization_cache_stats stats = cache.stats();
+    QCOMPARE(stats.hits, size_t{1});
+    QCOMPARE(stats.misses, size_t{3});
+    QCOMPARE(stats.evictions, size_t{0});
+    QVERIFY(stats.memory_usage >= 10 * sizeof(point_group));
+  }
+
+  void least_recently_used_blocks_are_evicted() {
+    generalization_cache cache{3 * 1000 * sizeof(point_group)};
+    const uint64_t generation = cache.generation();
+    cache.insert(generation, 0, block_at(0), make_groups(900));
+    cache.insert(generation, 0, block_at(0x10000), make_groups(900));
+    QVERIFY(cache.find(generation, 0, block_at(0)));
+    cache.insert(generation, 0, block_at(0x20000), make_groups(900));
+    cache.insert(generation, 0, block_at(0x30000), make_groups(900));
+
+    QVERIFY(cache.find(generation, 0, block_at(0)));
+    QVERIFY(!cache.find(generation, 0, block_at(0x10000)));
+    QVERIFY(cache.find(generation, 0, block_at(0x20000)));
+    QVERIFY(cache.find(generation, 0, block_at(0x30000)));
+    QCOMPARE(cache.stats().evictions, size_t{1});
+    QVERIFY(cache.stats().memory_usage <= 3 * 1000 * sizeof(point_group));
+
+    // Result larger than the budget doesn't evict anything
+    cache.insert(generation, 0, block_at(0x40000), make_groups(3000));
+    QVERIFY(!cache.find(generation, 0, block_at(0x40000)));
+    QCOMPARE(cache.stats().evictions, size_t{1});
+  }
+
+  void results_of_outdated_generation_are_ignored() {
+    generalization_cache cache;
+    const uint64_t outdated = cache.generation();
+    cache.insert(outdated, 0, block_at(0), make_groups(10));
+    cache.clear();
+    const uint64_t generation = cache.generation();
+    QVERIFY(generation != outdated);
+    QVERIFY(!cache.find(generation, 0, block_at(0)));
+
+    // Query started before the clear call completes after it
+    cache.insert(outdated, 0, block_at(0x10000), make_groups(10));
+    QVERIFY(!cache.find(generation, 0, block_at(0x10000)));
+    cache.insert(generation, 0, block_at(0x10000), make_groups(10));
+    QVERIFY(!cache.find(outdated, 0, block_at(0x10000)));
+    QVERIFY(cache.find(generation, 0, block_at(0x10000)));
+  }
+
+  void cancelled_blocks_are_not_cached() {
+    const int z_level = 10;
+    const auto [min, max] = pan_areas(z_level, {1920, 1080}, {0, 0}, 1).front();
+    const auto blocks = cover_with_blocks(min, max, z_level);
+    QVERIFY(blocks.size() > 2);
+
+    generalization_cache cache;
+    const uint64_t generation = cache.generation();
+    cancellation_token cancel;
+    size_t generalized = 0;
+    generalize_blocks(cache, generation, 0, min, max, z_level,
+        [&](const cell_block& block) {
+          // Query is abandoned while the second block is generalized
+          if (++generalized == 2)
+            cancel.cancel();
+          return generalize(points_, morton::code(block.min), morton::code(block.max), z_level, nullptr, &cancel);
+        },
+        &cancel);
+    QCOMPARE(generalized, size_t{2});
+    QVERIFY(cache.find(generation, 0, blocks[0]));
+    QVERIFY(!cache.find(generation, 0, blocks[1]));
+    QVERIFY(!cache.find(generation, 0, blocks[2]));
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  std::vector<uint64_t> points_;
+  cell_pyramid pyramid_;
+  key_blocks blocks_;
+};
+
+QTEST_MAIN(generalization_cache_tests)
+#include "generalization_cache.test.moc"
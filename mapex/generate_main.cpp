@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QThreadPool>
+
+#include <mapex/poi_pack.hpp>
+
+namespace {
+
+// Peak resident set size of the process in KiB or 0 if unknown
+long peak_rss_kib() {
+#if defined(__linux__)
+  rusage usage{};
+  if (::getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app{argc, argv};
+  QCoreApplication::setApplicationName(QStringLiteral("mapex-generate"));
+
+  // Projected unit is the length of the equator
+  constexpr double equator_km = 40075.017;
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(QStringLiteral("Writes poi.bin with synthetic POI clustered around cities"));
+  parser.addHelpOption();
+  parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("poi.bin file to write"));
+  const QCommandLineOption count_opt{QStringLiteral("count"), QStringLiteral("Number of POI"),
+      QStringLiteral("count"), QStringLiteral("1000000")};
+  const QCommandLineOption seed_opt{
+      QStringLiteral("seed"), QStringLiteral("Random seed"), QStringLiteral("seed"), QStringLiteral("0")};
+  const QCommandLineOption cities_opt{QStringLiteral("cities"), QStringLiteral("Number of cities"),
+      QStringLiteral("count"), QStringLiteral("100")};
+  const QCommandLineOption radius_opt{QStringLiteral("city-radius"),
+      QStringLiteral("Standard deviation of POI around the largest city at the equator"), QStringLiteral("km"),
+      QStringLiteral("20")};
+  const QCommandLineOption noise_opt{QStringLiteral("noise"),
+      QStringLiteral("Share of POI spread uniformly over the world"), QStringLiteral("ratio"), QStringLiteral("0.1")};
+  const QCommandLineOption advertized_opt{QStringLiteral("advertized"), QStringLiteral("Share of advertized POI"),
+      QStringLiteral("ratio"), QStringLiteral("0.001")};
+  const QCommandLineOption memory_opt{QStringLiteral("memory"), QStringLiteral("Memory budget in MiB"),
+      QStringLiteral("MiB"), QStringLiteral("256")};
+  const QCommandLineOption curve_opt{QStringLiteral("curve"), QStringLiteral("Key curve: morton or hilbert"),
+      QStringLiteral("curve"), QStringLiteral("morton")};
+  const QCommandLineOption temp_opt{
+      QStringLiteral("temp-dir"), QStringLiteral("Directory for the sorted runs"), QStringLiteral("dir")};
+  const QCommandLineOption threads_opt{
+      QStringLiteral("threads"), QStringLiteral("Number of worker threads"), QStringLiteral("count")};
+  parser.addOptions({count_opt, seed_opt, cities_opt, radius_opt, noise_opt, advertized_opt, memory_opt, curve_opt,
+      temp_opt, threads_opt});
+  parser.process(app);
+
+  const QStringList args = parser.positionalArguments();
+  if (args.size() != 1)
+    parser.showHelp(1);
+
+  generate_options generation;
+  bool valid = true;
+  generation.count = parser.value(count_opt).toULongLong(&valid);
+  if (!valid || generation.count == 0) {
+    std::fprintf(stderr, "invalid POI count\n");
+    return 1;
+  }
+  generation.seed = parser.value(seed_opt).toULongLong(&valid);
+  if (!valid) {
+    std::fprintf(stderr, "invalid seed\n");
+    return 1;
+  }
+  generation.cities = static_cast<size_t>(parser.value(cities_opt).toULongLong(&valid));
+  if (!valid) {
+    std::fprintf(stderr, "invalid number of cities\n");
+    return 1;
+  }
+  generation.city_radius = parser.value(radius_opt).toDouble(&valid) / equator_km;
+  if (!valid || generation.city_radius <= 0) {
+    std::fprintf(stderr, "invalid city radius\n");
+    return 1;
+  }
+  generation.noise_ratio = parser.value(noise_opt).toDouble(&valid);
+  if (!valid || generation.noise_ratio < 0 || generation.noise_ratio > 1) {
+    std::fprintf(stderr, "invalid noise ratio\n");
+    return 1;
+  }
+  generation.advertized_ratio = parser.value(advertized_opt).toDouble(&valid);
+  if (!valid || generation.advertized_ratio < 0 || generation.advertized_ratio > 1) {
+    std::fprintf(stderr, "invalid advertized ratio\n");
+    return 1;
+  }
+
+  pack_options options;
+  options.memory_budget = static_cast<size_t>(parser.value(memory_opt).toULongLong(&valid)) << 20;
+  if (!valid || options.memory_budget == 0) {
+    std::fprintf(stderr, "invalid memory budget\n");
+    return 1;
+  }
+  const QString curve = parser.value(curve_opt);
+  if (curve != QLatin1String("morton") && curve != QLatin1String("hilbert")) {
+    std::fprintf(stderr, "unknown curve: %s\n", qUtf8Printable(curve));
+    return 1;
+  }
+  options.curve = curve == QLatin1String("hilbert") ? key_curve::hilbert : key_curve::morton;
+  options.temp_dir = parser.value(temp_opt);
+  if (parser.isSet(threads_opt))
+    QThreadPool::globalInstance()->setMaxThreadCount(parser.value(threads_opt).toInt());
+
+  std::filebuf out;
+  if (!out.open(QFile::encodeName(args[0]).constData(), std::ios::out | std::ios::trunc | std::ios::binary)) {
+    std::fprintf(stderr, "can't create %s\n", qUtf8Printable(args[0]));
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  pack_stats stats;
+  try {
+    stats = generate_poi(out, generation, options);
+    if (!out.close())
+      throw std::system_error{std::make_error_code(std::errc::io_error), "write poi.bin"};
+  } catch (const std::exception& err) {
+    std::fprintf(stderr, "%s\n", err.what());
+    return 1;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::printf("keys: %llu advertized, %llu regular\n", static_cast<unsigned long long>(stats.advertized),
+      static_cast<unsigned long long>(stats.regular));
+  std::printf("runs: %zu, merge passes: %zu\n", stats.runs, stats.merge_passes);
+  std::printf("time: %.3f s, %.0f keys/s\n", elapsed.count(), stats.rows / elapsed.count());
+  std::printf("peak RSS: %ld KiB\n", peak_rss_kib());
+  return 0;
+}
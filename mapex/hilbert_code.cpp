@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cassert>
+
+#include <mapex/hilbert_code.hpp>
+
+namespace hilbert {
+namespace {
+
+// Quadrant of the curve with its spatial position and curve orientation known so that children can be examined
+// without decoding their keys.
+struct quadrant {
+  uint64_t first_code;
+  point corner;
+  unsigned side_log2;
+  unsigned state;
+
+  uint64_t last_code() const noexcept {
+    return first_code | (side_log2 == 32 ? ~uint64_t{0} : (uint64_t{1} << (2 * side_log2)) - 1);
+  }
+  point max_corner() const noexcept {
+    const auto side_mask = static_cast<uint32_t>((uint64_t{1} << side_log2) - 1);
+    return {corner.x | side_mask, corner.y | side_mask};
+  }
+
+  quadrant child(unsigned digit) const noexcept {
+    assert(side_log2 > 0);
+    unsigned child_state = state;
+    const unsigned morton_digit = detail::morton_digit(child_state, digit);
+    const unsigned child_side_log2 = side_log2 - 1;
+    return {first_code | (uint64_t{digit} << (2 * child_side_log2)),
+        {corner.x | ((morton_digit & 1) << child_side_log2), corner.y | ((morton_digit >> 1) << child_side_log2)},
+        child_side_log2, child_state};
+  }
+};
+
+constexpr quadrant world{0, {0, 0}, 32, 0};
+
+bool overlaps(const quadrant& quad, point rect_min, point rect_max) noexcept {
+  const point quad_max = quad.max_corner();
+  return quad_max.x >= rect_min.x && quad_max.y >= rect_min.y && quad.corner.x <= rect_max.x &&
+         quad.corner.y <= rect_max.y;
+}
+
+bool is_inside(const quadrant& quad, point rect_min, point rect_max) noexcept {
+  return is_in_rect(quad.corner, rect_min, rect_max) && is_in_rect(quad.max_corner(), rect_min, rect_max);
+}
+
+// Smallest key of the rect points inside of the quadrant overlapping the rect.
+uint64_t first_in_quadrant(quadrant quad, point rect_min, point rect_max) noexcept {
+  assert(overlaps(quad, rect_min, rect_max));
+  while (!is_inside(quad, rect_min, rect_max)) {
+    unsigned digit = 0;
+    while (!overlaps(quad.child(digit), rect_min, rect_max))
+      ++digit;
+    quad = quad.child(digit);
+  }
+  return quad.first_code;
+}
+
+// Largest key of the rect points inside of the quadrant overlapping the rect.
+uint64_t last_in_quadrant(quadrant quad, point rect_min, point rect_max) noexcept {
+  assert(overlaps(quad, rect_min, rect_max));
+  while (!is_inside(quad, rect_min, rect_max)) {
+    unsigned digit = 3;
+    while (!overlaps(quad.child(digit), rect_min, rect_max))
+      --digit;
+    quad = quad.child(digit);
+  }
+  return quad.last_code();
+}
+
+} // namespace
+
+void decode_n(const uint64_t* codes, size_t count, point* points) noexcept {
+  // Deinterleaving is the same as for Morton codes and uses SIMD kernels, the rest is plain bitwise arithmetic.
+  morton::decode_n(codes, count, points);
+  std::transform(points, points + count, points, [](point digit_bits) {
+    return detail::from_digit_bits(digit_bits.x, digit_bits.y);
+  });
+}
+
+void encode_n(const point* points, size_t count, uint64_t* codes) noexcept {
+  morton::encode_n(points, count, codes);
+  std::transform(codes, codes + count, codes, from_morton);
+}
+
+uint64_t rect_first(uint64_t min, uint64_t max) noexcept { return first_in_quadrant(world, decode(min), decode(max)); }
+
+uint64_t rect_last(uint64_t min, uint64_t max) noexcept { return last_in_quadrant(world, decode(min), decode(max)); }
+
+uint64_t bigmin(uint64_t division_point, uint64_t min, uint64_t max) noexcept {
+  const point rect_min = decode(min);
+  const point rect_max = decode(max);
+  assert(division_point < rect_last(min, max));
+  // Follow the division point down the tree remembering the deepest quadrant overlapping the rect which follows the
+  // path. Deeper quadrants contain smaller keys than the ones found on the upper levels.
+  quadrant quad = world;
+  quadrant next = world;
+  while (quad.side_log2 > 0) {
+    const auto digit = static_cast<unsigned>(division_point >> (2 * (quad.side_log2 - 1))) & 3;
+    for (unsigned next_digit = digit + 1; next_digit < 4; ++next_digit) {
+      const quadrant candidate = quad.child(next_digit);
+      if (overlaps(candidate, rect_min, rect_max)) {
+        next = candidate;
+        break;
+      }
+    }
+    quad = quad.child(digit);
+    if (!overlaps(quad, rect_min, rect_max))
+      break;
+    if (is_inside(quad, rect_min, rect_max))
+      return division_point;
+  }
+  assert(next.side_log2 < 32);
+  return first_in_quadrant(next, rect_min, rect_max);
+}
+
+std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges) {
+  const point rect_min = decode(min);
+  const point rect_max = decode(max);
+  return morton::detail::decompose(hilbert::decode, first_in_quadrant(world, rect_min, rect_max),
+      last_in_quadrant(world, rect_min, rect_max), rect_min, rect_max, max_ranges);
+}
+
+} // namespace hilbert
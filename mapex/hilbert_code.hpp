@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <mapex/morton_code.hpp>
+
+/// Hilbert curve keys. Unlike Morton codes consequent keys always belong to adjacent points so rects are split into
+/// much less contiguous key runs. Keys have the same quadtree prefix property: the first 2*N bits of a key identify
+/// the quadrant of the level N containing the point.
+namespace hilbert {
+
+namespace detail {
+
+// Orientation of the curve inside of a quadrant is one of 4 transforms of the base curve: identity, transposition,
+// inversion of both coordinates and antitransposition. Bit 0 of the state is transposition and bit 1 is inversion.
+// The transforms commute so the state of a quadrant is a xor of its parent state and the transform of the child.
+constexpr unsigned transposed = 1;
+constexpr unsigned inverted = 2;
+
+// Converts Morton digit (y << 1 | x) into Hilbert digit and updates the state.
+constexpr unsigned hilbert_digit(unsigned& state, unsigned morton_digit) noexcept {
+  const unsigned inversion = (state & inverted) ? 1 : 0;
+  const unsigned x = ((state & transposed) ? morton_digit >> 1 : morton_digit & 1) ^ inversion;
+  const unsigned y = ((state & transposed) ? morton_digit & 1 : morton_digit >> 1) ^ inversion;
+  if (y == 0)
+    state ^= transposed | (x == 1 ? inverted : 0);
+  return (3 * x) ^ y;
+}
+
+// Converts Hilbert digit into Morton digit (y << 1 | x) and updates the state.
+constexpr unsigned morton_digit(unsigned& state, unsigned hilbert_digit) noexcept {
+  const unsigned x = hilbert_digit >> 1;
+  const unsigned y = (hilbert_digit ^ x) & 1;
+  const unsigned inversion = (state & inverted) ? 1 : 0;
+  const unsigned raw_x = ((state & transposed) ? y : x) ^ inversion;
+  const unsigned raw_y = ((state & transposed) ? x : y) ^ inversion;
+  if (y == 0)
+    state ^= transposed | (x == 1 ? inverted : 0);
+  return (raw_y << 1) | raw_x;
+}
+
+// Converts 4 Morton digits packed into a byte at once. Lower byte of an entry is the converted byte, bits 8-9 are the
+// state after the conversion.
+struct byte_table {
+  uint16_t entries[4][256];
+};
+
+constexpr byte_table make_byte_table() noexcept {
+  byte_table res{};
+  for (unsigned initial_state = 0; initial_state < 4; ++initial_state) {
+    for (unsigned byte = 0; byte < 256; ++byte) {
+      unsigned state = initial_state;
+      unsigned converted = 0;
+      for (int digit_pos = 3; digit_pos >= 0; --digit_pos)
+        converted = (converted << 2) | hilbert_digit(state, (byte >> (2 * digit_pos)) & 3);
+      res.entries[initial_state][byte] = static_cast<uint16_t>(converted | (state << 8));
+    }
+  }
+  return res;
+}
+
+inline constexpr byte_table from_morton_table = make_byte_table();
+
+// Bit N of the result is xor of the bits of `val` starting from N up to the most significant one.
+constexpr uint32_t prefix_xor(uint32_t val) noexcept {
+  val ^= val >> 1;
+  val ^= val >> 2;
+  val ^= val >> 4;
+  val ^= val >> 8;
+  val ^= val >> 16;
+  return val;
+}
+
+// Decodes a key from its deinterleaved lower and higher digit bits. The state of every level depends only on the
+// digits of the levels above it so all of the states are computed at once with prefix xor instead of table lookups
+// chain. Compiles into straight bitwise code which vectorizes well.
+constexpr point from_digit_bits(uint32_t low_bits, uint32_t high_bits) noexcept {
+  const uint32_t rx = high_bits;
+  const uint32_t ry = low_bits ^ high_bits;
+  const uint32_t transposed_levels = prefix_xor(~ry) >> 1;
+  const uint32_t inverted_levels = prefix_xor(rx & ~ry) >> 1;
+  const uint32_t swapped = transposed_levels & (rx ^ ry);
+  return {rx ^ swapped ^ inverted_levels, ry ^ swapped ^ inverted_levels};
+}
+
+} // namespace detail
+
+/// Converts Morton code into the Hilbert key of the same point.
+constexpr uint64_t from_morton(uint64_t code) noexcept {
+  uint64_t res = 0;
+  unsigned state = 0;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    const uint16_t entry = detail::from_morton_table.entries[state][(code >> shift) & 0xff];
+    res |= uint64_t{entry & 0xffu} << shift;
+    state = entry >> 8;
+  }
+  return res;
+}
+
+constexpr uint64_t code(point pt) noexcept { return from_morton(morton::code(pt)); }
+constexpr point decode(uint64_t code) noexcept {
+  return detail::from_digit_bits(morton::deinterleave(code), morton::deinterleave(code >> 1));
+}
+
+/// Converts Hilbert key into the Morton code of the same point.
+constexpr uint64_t to_morton(uint64_t code) noexcept { return morton::code(decode(code)); }
+
+/// Codec using `MortonCodec` for bits interleaving.
+template <typename MortonCodec>
+struct codec {
+  static uint64_t code(point pt) noexcept { return from_morton(MortonCodec::code(pt)); }
+  static point decode(uint64_t code) noexcept {
+    const point digit_bits = MortonCodec::decode(code);
+    return detail::from_digit_bits(digit_bits.x, digit_bits.y);
+  }
+};
+
+/// Decodes `count` keys into `points` array.
+void decode_n(const uint64_t* codes, size_t count, point* points) noexcept;
+/// Encodes `count` points into `codes` array.
+void encode_n(const point* points, size_t count, uint64_t* codes) noexcept;
+
+/// Calls `func` with the fastest codec available on the current CPU.
+template <typename Func>
+decltype(auto) with_fast_codec(Func&& func) {
+  return morton::with_fast_codec(
+      [&](auto morton_codec) { return std::forward<Func>(func)(codec<decltype(morton_codec)>{}); });
+}
+
+/// Smallest key of the points in the rect with corners `min` and `max`.
+uint64_t rect_first(uint64_t min, uint64_t max) noexcept;
+/// Largest key of the points in the rect with corners `min` and `max`.
+uint64_t rect_last(uint64_t min, uint64_t max) noexcept;
+
+/// Smallest key greater then `division_point` of the points in the rect with corners `min` and `max`. Same as
+/// `morton::bigmin` `division_point` must not belong to the rect and must be less then `rect_last(min, max)`.
+uint64_t bigmin(uint64_t division_point, uint64_t min, uint64_t max) noexcept;
+
+using morton::z_range;
+
+/// Splits the rect with corners `min` and `max` into at most `max_ranges` sorted non overlapping intervals of keys.
+/// Has the same guaranties as `morton::decompose`.
+std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges);
+
+/// Hilbert curve policy for the algorithms generic over the space filling curve.
+struct curve {
+  using key_type = uint64_t;
+
+  static constexpr uint64_t code(point pt) noexcept { return hilbert::code(pt); }
+  static constexpr point decode(uint64_t code) noexcept { return hilbert::decode(code); }
+  static void decode_n(const uint64_t* codes, size_t count, point* points) noexcept {
+    hilbert::decode_n(codes, count, points);
+  }
+  static void encode_n(const point* points, size_t count, uint64_t* codes) noexcept {
+    hilbert::encode_n(points, count, codes);
+  }
+  template <typename Func>
+  static decltype(auto) with_fast_codec(Func&& func) {
+    return hilbert::with_fast_codec(std::forward<Func>(func));
+  }
+  static uint64_t rect_first(uint64_t min, uint64_t max) noexcept { return hilbert::rect_first(min, max); }
+  static uint64_t rect_last(uint64_t min, uint64_t max) noexcept { return hilbert::rect_last(min, max); }
+  static uint64_t bigmin(uint64_t division_point, uint64_t min, uint64_t max) noexcept {
+    return hilbert::bigmin(division_point, min, max);
+  }
+  static std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges) {
+    return hilbert::decompose(min, max, max_ranges);
+  }
+};
+
+} // namespace hilbert
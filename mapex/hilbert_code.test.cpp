@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/hilbert_code.hpp>
+
+namespace {
+
+static_assert(hilbert::code({0, 0}) == 0, "curve should start at the top left corner of the world");
+static_assert(hilbert::code({1, 0}) == 1, "curve orientation at the finest level is transposed by 31 levels above");
+static_assert(hilbert::code({1, 1}) == 2);
+static_assert(hilbert::code({0, 1}) == 3);
+static_assert(hilbert::code({~uint32_t{0}, 0}) == ~uint64_t{0}, "curve should end at the world top right corner");
+static_assert(hilbert::decode(hilbert::code({12345, 67890})) == point{12345, 67890});
+static_assert(hilbert::to_morton(hilbert::from_morton(0xdead'beef'0bad'f00d)) == 0xdead'beef'0bad'f00d);
+
+// Keys below 4^N belong to the square with side 2^N in the top left corner of the world.
+constexpr unsigned small_world_bits = 6;
+constexpr uint64_t small_world_size = uint64_t{1} << (2 * small_world_bits);
+
+} // namespace
+
+class hilbert_code_tests : public QObject {
+  Q_OBJECT
+private:
+  std::pair<point, point> random_rect(unsigned coord_bits) {
+    std::uniform_int_distribution<uint32_t> coord_dist{0, ~uint32_t{0} >> (32 - coord_bits)};
+    point min{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
+    point max{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
+    if (min.x > max.x)
+      std::swap(min.x, max.x);
+    if (min.y > max.y)
+      std::swap(min.y, max.y);
+    return {min, max};
+  }
+
+  void random_small_rects() {
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+    QTest::addColumn<size_t>("max_ranges");
+
+    for (unsigned i = 0; i < 100; ++i) {
+      const auto [min, max] = random_rect(small_world_bits);
+      const size_t max_ranges = 1 + i % 64;
+      QTest::addRow("(%u, %u)-(%u, %u)/%d", min.x, min.y, max.x, max.y, static_cast<int>(max_ranges))
+          << hilbert::code(min) << hilbert::code(max) << max_ranges;
+    }
+  }
+
+  std::vector<uint64_t> small_rect_keys(uint64_t min, uint64_t max) {
+    std::vector<uint64_t> res;
+    for (uint64_t key = 0; key < small_world_size; ++key) {
+      if (is_in_rect(hilbert::decode(key), hilbert::decode(min), hilbert::decode(max)))
+        res.push_back(key);
+    }
+    return res;
+  }
+
+private slots:
+  void consequent_keys_belong_to_adjacent_points() {
+    for (uint64_t key = 1; key < small_world_size; ++key) {
+      const point prev = hilbert::decode(key - 1);
+      const point cur = hilbert::decode(key);
+      const uint32_t dist = std::max(prev.x, cur.x) - std::min(prev.x, cur.x) + std::max(prev.y, cur.y) -
+                            std::min(prev.y, cur.y);
+      QCOMPARE(dist, uint32_t{1});
+    }
+  }
+
+  void code_and_decode_are_inverse() {
+    std::uniform_int_distribution<uint32_t> dist;
+    for (int i = 0; i < 10000; ++i) {
+      const point pt{dist(rnd_engine_), dist(rnd_engine_)};
+      QCOMPARE(hilbert::decode(hilbert::code(pt)), pt);
+    }
+  }
+
+  void decode_n_and_encode_n_match_scalar_versions() {
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> keys(1023);
+    std::generate(keys.begin(), keys.end(), [&] { return dist(rnd_engine_); });
+    std::vector<point> points(keys.size());
+    hilbert::decode_n(keys.data(), keys.size(), points.data());
+    for (size_t i = 0; i < keys.size(); ++i)
+      QCOMPARE(points[i], hilbert::decode(keys[i]));
+    std::vector<uint64_t> encoded(points.size());
+    hilbert::encode_n(points.data(), points.size(), encoded.data());
+    QVERIFY(encoded == keys);
+  }
+
+  void rect_first_and_last_are_extreme_rect_keys_data() { random_small_rects(); }
+  void rect_first_and_last_are_extreme_rect_keys() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const auto keys = small_rect_keys(min, max);
+    QCOMPARE(hilbert::rect_first(min, max), keys.front());
+    QCOMPARE(hilbert::rect_last(min, max), keys.back());
+  }
+
+  void bigmin_returns_next_rect_key_data() { random_small_rects(); }
+  void bigmin_returns_next_rect_key() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    const auto keys = small_rect_keys(min, max);
+    for (uint64_t div_pt = 0; div_pt < keys.back(); ++div_pt) {
+      if (std::binary_search(keys.begin(), keys.end(), div_pt))
+        continue;
+      QCOMPARE(hilbert::bigmin(div_pt, min, max), *std::upper_bound(keys.begin(), keys.end(), div_pt));
+    }
+  }
+
+  void decompose_ranges_cover_all_rect_points_data() { random_small_rects(); }
+  void decompose_ranges_cover_all_rect_points() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, max_ranges);
+    const auto ranges = hilbert::decompose(min, max, max_ranges);
+    const auto keys = small_rect_keys(min, max);
+    QVERIFY(ranges.size() <= max_ranges);
+    QCOMPARE(ranges.front().min, keys.front());
+    QCOMPARE(ranges.back().max, keys.back());
+    auto range_it = ranges.begin();
+    for (uint64_t key = keys.front(); key <= keys.back(); ++key) {
+      while (range_it != ranges.end() && range_it->max < key)
+        ++range_it;
+      const bool in_range = range_it != ranges.end() && range_it->min <= key;
+      const bool in_rect = std::binary_search(keys.begin(), keys.end(), key);
+      if (in_rect)
+        QVERIFY(in_range);
+      if (in_range && range_it->exact)
+        QVERIFY(in_rect);
+    }
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(hilbert_code_tests)
+#include "hilbert_code.test.moc"
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/key_blocks.hpp>
+
+key_blocks::key_blocks(const std::vector<uint64_t>& keys) : size_{keys.size()} {
+  headers_.reserve((keys.size() + block_size - 1) / block_size);
+  std::vector<char> data(stream_vbyte::max_encoded_size(keys.size()));
+  size_t offset = 0;
+  for (size_t pos = 0; pos < keys.size(); pos += block_size) {
+    const auto count = static_cast<uint32_t>(std::min(block_size, keys.size() - pos));
+    headers_.push_back({keys[pos], offset, count});
+    offset += stream_vbyte::pack_delta(keys.data() + pos + 1, count - 1, data.data() + offset, keys[pos]);
+  }
+  data.resize(offset);
+  data.shrink_to_fit();
+  auto storage = std::make_shared<const std::vector<char>>(std::move(data));
+  data_ = storage->data();
+  data_size_ = storage->size();
+  storage_ = std::move(storage);
+}
+
+key_blocks::key_blocks(std::vector<header> headers, std::vector<char> data) : headers_{std::move(headers)} {
+  auto storage = std::make_shared<const std::vector<char>>(std::move(data));
+  data_ = storage->data();
+  data_size_ = storage->size();
+  storage_ = std::move(storage);
+  for (const header& hdr : headers_)
+    size_ += hdr.count;
+}
+
+key_blocks::key_blocks(
+    std::vector<header> headers, std::shared_ptr<const void> storage, const char* data, size_t data_size)
+    : headers_{std::move(headers)}, storage_{std::move(storage)}, data_{data}, data_size_{data_size} {
+  for (const header& hdr : headers_)
+    size_ += hdr.count;
+}
+
+void key_blocks::decode_block(size_t idx, uint64_t* keys) const noexcept {
+  const header& hdr = headers_[idx];
+  keys[0] = hdr.first_key;
+  stream_vbyte::unpack_delta(data_ + hdr.offset, data_ + data_size_, hdr.count - 1, keys + 1, hdr.first_key);
+}
+
+size_t key_blocks::decode_ranges(const std::vector<morton::z_range>& ranges, std::vector<uint64_t>& keys) const {
+  const auto by_first_key = [](const header& hdr, uint64_t key) { return hdr.first_key < key; };
+  // Overlapping blocks are found first so the output is resized only once
+  std::vector<std::pair<size_t, size_t>> spans;
+  size_t count = 0;
+  auto next = headers_.begin();
+  for (const morton::z_range& range : ranges) {
+    // Block might contain keys up to the first key of the next block so the block preceding the first one starting at
+    // or after `range.min` overlaps the range as well.
+    auto first = std::lower_bound(next, headers_.end(), range.min, by_first_key);
+    if (first != headers_.begin())
+      first = std::max(std::prev(first), next);
+    const auto last = std::upper_bound(first, headers_.end(), range.max,
+        [](uint64_t key, const header& hdr) { return key < hdr.first_key; });
+    if (first != last)
+      spans.emplace_back(first - headers_.begin(), last - headers_.begin());
+    for (; first != last; ++first)
+      count += first->count;
+    next = last;
+  }
+
+  size_t pos = keys.size();
+  keys.resize(pos + count);
+  size_t res = 0;
+  for (auto [first, last] : spans) {
+    for (size_t idx = first; idx != last; pos += headers_[idx].count, ++idx)
+      decode_block(idx, keys.data() + pos);
+    res += last - first;
+  }
+  return res;
+}
+
+std::vector<uint64_t> key_blocks::decode_all() const {
+  std::vector<uint64_t> res(size_);
+  size_t pos = 0;
+  for (size_t idx = 0; idx < headers_.size(); pos += headers_[idx].count, ++idx)
+    decode_block(idx, res.data() + pos);
+  return res;
+}
+
+std::optional<uint64_t> key_blocks::decoder::next() noexcept {
+  if (pos_ == size_) {
+    if (next_block_ == blocks_->headers_.size())
+      return std::nullopt;
+    load(next_block_++);
+  }
+  return keys_[pos_++];
+}
+
+std::optional<uint64_t> key_blocks::decoder::skip_to(uint64_t key) noexcept {
+  if (pos_ < size_ && keys_[size_ - 1] >= key) {
+    pos_ = std::lower_bound(keys_.begin() + pos_, keys_.begin() + size_, key) - keys_.begin();
+    return keys_[pos_++];
+  }
+
+  // Only the block preceding the first block starting from not less key may contain keys before it
+  const std::vector<header>& headers = blocks_->headers_;
+  const auto first_not_less = std::lower_bound(headers.begin() + next_block_, headers.end(), key,
+      [](const header& hdr, uint64_t val) { return hdr.first_key < val; });
+  const size_t idx = first_not_less - headers.begin();
+  if (idx > next_block_) {
+    load(idx - 1);
+    const auto it = std::lower_bound(keys_.begin(), keys_.begin() + size_, key);
+    if (it != keys_.begin() + size_) {
+      pos_ = it - keys_.begin() + 1;
+      next_block_ = idx;
+      return *it;
+    }
+  }
+  pos_ = size_;
+  next_block_ = idx;
+  return next();
+}
+
+void key_blocks::decoder::load(size_t idx) noexcept {
+  blocks_->decode_block(idx, keys_.data());
+  pos_ = 0;
+  size_ = blocks_->headers_[idx].count;
+  ++blocks_decoded_;
+}
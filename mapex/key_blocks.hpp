@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <mapex/morton_code.hpp>
+
+/// Sorted keys stored as fixed size blocks of stream VByte encoded differences. Every block starts from an absolute
+/// key so blocks can be decoded independently. Allows to keep the keys compressed in memory and decode only the blocks
+/// overlapping queried key ranges.
+class key_blocks {
+public:
+  /// Number of keys in every block except the last one.
+  static constexpr size_t block_size = 128;
+
+  struct header {
+    /// Smallest key of the block. Not included into the encoded block data.
+    uint64_t first_key;
+    /// Position of the encoded block in the data.
+    uint64_t offset;
+    uint32_t count;
+  };
+
+  /// Pull-style decoder of the keys. Decodes a single block at a time and jumps over the blocks which can't contain
+  /// the key requested with `skip_to` without decoding them.
+  class decoder {
+  public:
+    explicit decoder(const key_blocks& blocks) noexcept : blocks_{&blocks} {}
+
+    /// Decodes the next key. Returns `std::nullopt` after the last key.
+    std::optional<uint64_t> next() noexcept;
+    /// Returns the first of the remaining keys which is not less than `key`.
+    std::optional<uint64_t> skip_to(uint64_t key) noexcept;
+
+    size_t blocks_decoded() const noexcept { return blocks_decoded_; }
+
+  private:
+    void load(size_t idx) noexcept;
+
+    const key_blocks* blocks_;
+    // Index of the block following the loaded one
+    size_t next_block_ = 0;
+    size_t pos_ = 0;
+    size_t size_ = 0;
+    size_t blocks_decoded_ = 0;
+    std::array<uint64_t, block_size> keys_;
+  };
+
+  key_blocks() = default;
+  explicit key_blocks(const std::vector<uint64_t>& keys);
+  /// Adopts already encoded blocks. Headers must describe consequent non-empty blocks of `data`.
+  key_blocks(std::vector<header> headers, std::vector<char> data);
+  /// Adopts encoded blocks stored in the `[data, data + data_size)` region owned by `storage` without copying them.
+  /// Allows to query the blocks in place of a memory mapped file.
+  key_blocks(std::vector<header> headers, std::shared_ptr<const void> storage, const char* data, size_t data_size);
+
+  size_t size() const noexcept { return size_; }
+  const std::vector<header>& headers() const noexcept { return headers_; }
+  const char* data() const noexcept { return data_; }
+  size_t data_size() const noexcept { return data_size_; }
+
+  /// Decodes keys of the block `idx` into `keys` array which must have room for `headers()[idx].count` keys.
+  void decode_block(size_t idx, uint64_t* keys) const noexcept;
+  /// Appends keys of all blocks overlapping any of the sorted `ranges` to `keys`. Each block is decoded at most once
+  /// so appended keys stay sorted. Returns number of decoded blocks.
+  size_t decode_ranges(const std::vector<morton::z_range>& ranges, std::vector<uint64_t>& keys) const;
+  std::vector<uint64_t> decode_all() const;
+
+private:
+  std::vector<header> headers_;
+  std::shared_ptr<const void> storage_;
+  const char* data_ = nullptr;
+  size_t data_size_ = 0;
+  size_t size_ = 0;
+};
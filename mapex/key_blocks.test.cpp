@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/key_blocks.hpp>
+
+class key_blocks_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count, uint64_t max_key) {
+    std::uniform_int_distribution<uint64_t> dist{0, max_key};
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  void sizes() {
+    QTest::addColumn<size_t>("count");
+    QTest::addColumn<uint64_t>("max_key");
+
+    for (size_t count : {0, 1, 2, 127, 128, 129, 256, 1000, 100000}) {
+      QTest::addRow("unique/%d", static_cast<int>(count)) << count << ~uint64_t{0};
+      QTest::addRow("with_duplicates/%d", static_cast<int>(count)) << count << uint64_t{count / 8};
+    }
+  }
+
+private slots:
+  void decode_all_restores_keys_data() { sizes(); }
+  void decode_all_restores_keys() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    QCOMPARE(blocks.size(), keys.size());
+    QVERIFY(blocks.decode_all() == keys);
+  }
+
+  void adopted_blocks_restore_keys_data() { sizes(); }
+  void adopted_blocks_restore_keys() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    const key_blocks adopted{blocks.headers(), std::vector<char>(blocks.data(), blocks.data() + blocks.data_size())};
+    QCOMPARE(adopted.size(), keys.size());
+    QVERIFY(adopted.decode_all() == keys);
+  }
+
+  void blocks_over_external_storage_restore_keys_data() { sizes(); }
+  void blocks_over_external_storage_restore_keys() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    auto storage = std::make_shared<const std::vector<char>>(blocks.data(), blocks.data() + blocks.data_size());
+    const key_blocks in_place{blocks.headers(), storage, storage->data(), storage->size()};
+    QCOMPARE(in_place.data(), storage->data());
+    QCOMPARE(in_place.size(), keys.size());
+    QVERIFY(in_place.decode_all() == keys);
+  }
+
+  void decoded_ranges_contain_all_range_keys_data() { sizes(); }
+  void decoded_ranges_contain_all_range_keys() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    for (int i = 0; i < 10; ++i) {
+      auto bounds = gen_keys(6, max_key);
+      std::vector<morton::z_range> ranges;
+      for (size_t pos = 0; pos < bounds.size(); pos += 2)
+        ranges.push_back({bounds[pos], bounds[pos + 1], true});
+
+      std::vector<uint64_t> decoded;
+      const size_t decoded_blocks = blocks.decode_ranges(ranges, decoded);
+      QVERIFY(decoded_blocks <= blocks.headers().size());
+      QVERIFY(std::is_sorted(decoded.begin(), decoded.end()));
+      for (const morton::z_range& range : ranges) {
+        const auto expected = std::count_if(
+            keys.begin(), keys.end(), [&](uint64_t key) { return key >= range.min && key <= range.max; });
+        const auto actual = std::count_if(
+            decoded.begin(), decoded.end(), [&](uint64_t key) { return key >= range.min && key <= range.max; });
+        QCOMPARE(actual, expected);
+      }
+    }
+  }
+
+  void decoder_returns_all_keys_data() { sizes(); }
+  void decoder_returns_all_keys() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    key_blocks::decoder decoder{blocks};
+    std::vector<uint64_t> decoded;
+    while (const auto key = decoder.next())
+      decoded.push_back(*key);
+    QVERIFY(decoded == keys);
+    QCOMPARE(decoder.blocks_decoded(), blocks.headers().size());
+  }
+
+  void decoder_skips_to_first_not_less_key_data() { sizes(); }
+  void decoder_skips_to_first_not_less_key() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+    const auto keys = gen_keys(count, max_key);
+    const key_blocks blocks{keys};
+    key_blocks::decoder decoder{blocks};
+    auto pos = keys.begin();
+    for (uint64_t target : gen_keys(20, max_key)) {
+      // Skip targets are sorted, the next key is read between them to check that skipping continues from it
+      pos = std::max(pos, std::lower_bound(keys.begin(), keys.end(), target));
+      const auto key = decoder.skip_to(target);
+      QCOMPARE(key.has_value(), pos != keys.end());
+      if (!key)
+        return;
+      QCOMPARE(*key, *pos++);
+      const auto next = decoder.next();
+      QCOMPARE(next.has_value(), pos != keys.end());
+      if (!next)
+        return;
+      QCOMPARE(*next, *pos++);
+    }
+  }
+
+  void decoder_skip_decodes_only_target_blocks() {
+    const auto keys = gen_keys(key_blocks::block_size * 100, ~uint64_t{0});
+    const key_blocks blocks{keys};
+    key_blocks::decoder decoder{blocks};
+    constexpr size_t block_size = key_blocks::block_size;
+    for (size_t pos : {10 * block_size + 5, 10 * block_size + 7, 50 * block_size + 1})
+      QCOMPARE(decoder.skip_to(keys[pos]), std::optional{keys[pos]});
+    QCOMPARE(decoder.blocks_decoded(), size_t{2});
+  }
+
+  void single_range_decodes_only_overlapping_blocks() {
+    const auto keys = gen_keys(key_blocks::block_size * 100, ~uint64_t{0});
+    const key_blocks blocks{keys};
+    const size_t first = 10 * key_blocks::block_size + 5;
+    const size_t last = 12 * key_blocks::block_size + 5;
+    std::vector<uint64_t> decoded;
+    QCOMPARE(blocks.decode_ranges({{keys[first], keys[last], true}}, decoded), size_t{3});
+    QVERIFY(std::equal(decoded.begin(), decoded.end(), keys.begin() + 10 * key_blocks::block_size));
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(key_blocks_tests)
+#include "key_blocks.test.moc"
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <mapex/morton_code.hpp>
+#include <mapex/search_index.hpp>
+
+// Helpers shared by the generalization and the POI queries over sorted keys.
+
+// Index lookup costs a few cache misses regardless of the range length while binary search over a short range touches
+// just a couple of cache lines.
+constexpr ptrdiff_t min_indexed_search_size = 1024;
+
+template <typename Key>
+using key_iterator = typename std::vector<Key>::const_iterator;
+
+/// Returns the first key of `[first, last)` subrange of `points` not less than `key`. Long ranges are searched with the
+/// index if `points` have one.
+template <typename Key>
+key_iterator<Key> search(
+    const basic_sorted_keys<Key>& points, key_iterator<Key> first, key_iterator<Key> last, Key key) {
+  if (!points.index || last - first < min_indexed_search_size)
+    return std::lower_bound(first, last, key);
+  return std::clamp(points.keys.begin() + points.index->lower_bound(points.keys, key), first, last);
+}
+
+/// Returns the first key of `[first, last)` subrange of `points` greater than `key`.
+template <typename Key>
+key_iterator<Key> search_after(
+    const basic_sorted_keys<Key>& points, key_iterator<Key> first, key_iterator<Key> last, Key key) {
+  return key == ~Key{0} ? last : search(points, first, last, static_cast<Key>(key + 1));
+}
+
+inline double squared_distance(point l, point r) noexcept {
+  const double dx = static_cast<double>(l.x) - r.x;
+  const double dy = static_cast<double>(l.y) - r.y;
+  return dx * dx + dy * dy;
+}
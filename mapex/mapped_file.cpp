@@ -0,0 +1,18 @@
+#include <system_error>
+
+#include <QtCore/QString>
+
+#include <mapex/mapped_file.hpp>
+#include <mapex/qfile_category.hpp>
+
+mapped_file::mapped_file(const QString& path) : file_{path} {
+  if (!file_.open(QIODevice::ReadOnly))
+    throw file_error(file_, "open");
+  size_ = static_cast<size_t>(file_.size());
+  // Empty file can't be mapped
+  if (size_ == 0)
+    return;
+  data_ = reinterpret_cast<const char*>(file_.map(0, file_.size()));
+  if (!data_)
+    throw file_error(file_, "map");
+}
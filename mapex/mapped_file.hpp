@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#include <QtCore/QFile>
+
+class QString;
+
+/// Read only memory mapping of a whole file. The mapped region stays valid while the object exists.
+class mapped_file {
+public:
+  /// Maps the file at `path`. Throws `std::system_error` if the file can't be opened or mapped.
+  explicit mapped_file(const QString& path);
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  const char* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+
+private:
+  QFile file_;
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
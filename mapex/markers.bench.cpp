@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/allocation_count.hpp>
+#include <mapex/generalization.hpp>
+#include <mapex/markers.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/reference_markers.hpp>
+
+namespace {
+
+constexpr int z_level = 12;
+constexpr unsigned cell_bits = cell_coord_bits(z_level);
+// Half of the cells of the viewport have a group, about 5% of the groups are advertized
+constexpr double cells_filled = 0.5;
+constexpr double advertized_ratio = 0.05;
+// Reference merge scans all groups for every box
+constexpr size_t max_reference_groups = 10'000;
+
+struct merge_input {
+  std::vector<point_group> ads;
+  std::vector<point_group> poi;
+  point vp_min;
+  point vp_max;
+};
+
+} // namespace
+
+class markers_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  // Viewport around the world center with `group_count` groups in random cells
+  merge_input gen_input(size_t group_count) {
+    const auto side_cells = static_cast<uint32_t>(std::ceil(std::sqrt(group_count / cells_filled)));
+    merge_input res;
+    res.vp_min = {(uint32_t{1} << 31) - (side_cells << (cell_bits - 1)),
+        (uint32_t{1} << 31) - (side_cells << (cell_bits - 1))};
+    const uint32_t side = side_cells << cell_bits;
+    res.vp_max = {res.vp_min.x + side - 1, res.vp_min.y + side - 1};
+
+    std::vector<uint64_t> cells(uint64_t{side_cells} * side_cells);
+    std::iota(cells.begin(), cells.end(), 0);
+    std::shuffle(cells.begin(), cells.end(), rnd_engine_);
+    cells.resize(group_count);
+    std::sort(cells.begin(), cells.end());
+    std::uniform_int_distribution<uint32_t> offset_dist{0, (uint32_t{1} << cell_bits) - 1};
+    std::uniform_int_distribution<int> count_dist{1, 100};
+    std::bernoulli_distribution adv_dist{advertized_ratio};
+    for (uint64_t cell : cells) {
+      const point cell_min{res.vp_min.x + (static_cast<uint32_t>(cell % side_cells) << cell_bits),
+          res.vp_min.y + (static_cast<uint32_t>(cell / side_cells) << cell_bits)};
+      const point centroid{cell_min.x + offset_dist(rnd_engine_), cell_min.y + offset_dist(rnd_engine_)};
+      (adv_dist(rnd_engine_) ? res.ads : res.poi).push_back({centroid, count_dist(rnd_engine_)});
+    }
+    return res;
+  }
+
+  void group_counts() {
+    QTest::addColumn<size_t>("group_count");
+    QTest::addColumn<bool>("reference");
+
+    for (size_t group_count : {100, 1'000, 10'000, 100'000}) {
+      QTest::addRow("grid/%d", static_cast<int>(group_count)) << group_count << false;
+      QTest::addRow("reference/%d", static_cast<int>(group_count)) << group_count << true;
+    }
+  }
+
+private slots:
+  void merge_time_data() { group_counts(); }
+  void merge_time() {
+    QFETCH(size_t, group_count);
+    QFETCH(bool, reference);
+    if (reference && group_count > max_reference_groups)
+      QSKIP("Reference merge is quadratic");
+    const merge_input input = gen_input(group_count);
+    if (reference)
+      QBENCHMARK { reference_merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level); }
+    else
+      QBENCHMARK { merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level); }
+  }
+
+  void markers_produced_data() { group_counts(); }
+  void markers_produced() {
+    QFETCH(size_t, group_count);
+    QFETCH(bool, reference);
+    if (reference)
+      QSKIP("Reference produces the same markers");
+    const merge_input input = gen_input(group_count);
+    const auto markers = merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level);
+    QTest::setBenchmarkResult(markers.size(), QTest::Events);
+  }
+
+  // Heap allocations of a merge into the vector filled by the previous merge of the same groups on the same thread
+  void allocations_per_merge_data() { group_counts(); }
+  void allocations_per_merge() {
+    QFETCH(size_t, group_count);
+    QFETCH(bool, reference);
+    if (reference && group_count > max_reference_groups)
+      QSKIP("Reference merge is quadratic");
+    const merge_input input = gen_input(group_count);
+    std::vector<marker> markers;
+    size_t before = allocation_count();
+    if (reference) {
+      markers = reference_merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level);
+    } else {
+      merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level, markers);
+      before = allocation_count();
+      merge_generalizations(input.ads, input.poi, input.vp_min, input.vp_max, z_level, markers);
+    }
+    QTest::setBenchmarkResult(allocation_count() - before, QTest::Events);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(markers_benchmarks)
+#include "markers.bench.moc"
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include <mapex/markers.hpp>
+#include <mapex/projection.hpp>
+
+namespace {
+
+constexpr point aligned_point(point pt, unsigned bit_alignment) noexcept {
+  const uint32_t mask = ~uint32_t{0} << bit_alignment;
+  return {pt.x & mask, pt.y & mask};
+}
+
+QPointF abs(QPointF pt) noexcept { return {std::abs(pt.x()), std::abs(pt.y())}; }
+
+bool marker_overlaps(const QPointF& lhs, const QPointF& rhs, uint32_t min_dist) noexcept {
+  const point diff = pointf_to_point(abs(rhs - lhs));
+  return diff.x < min_dist || diff.y < min_dist;
+}
+
+marker merge_marker(marker lhs, marker rhs) noexcept {
+  marker res{(lhs.poi_count * lhs.point + rhs.poi_count * rhs.point) / (lhs.poi_count + rhs.poi_count),
+      (lhs.poi_count + rhs.poi_count), lhs.has_advertizers || rhs.has_advertizers};
+  return res;
+}
+
+constexpr size_t no_box = std::numeric_limits<size_t>::max();
+constexpr uint32_t no_entry = std::numeric_limits<uint32_t>::max();
+
+// Boxes are two cells wide
+constexpr unsigned group_bit_alignment(int z_level) noexcept { return cell_coord_bits(z_level) + 1; }
+
+// Boxes of the sweep. Box `(col, row)` has the top left corner `step` times `(col, row)` away from the aligned top left
+// corner of the rect and the side of two steps. Boxes are counted in the sweep order, columns first.
+class box_layout {
+public:
+  box_layout(point vp_min, point vp_max, int z_level) noexcept
+      : origin_{aligned_point(vp_min, group_bit_alignment(z_level))}, step_log2_{group_bit_alignment(z_level) - 1},
+        columns_{steps_before(origin_.x, vp_max.x)}, rows_{steps_before(origin_.y, vp_max.y)} {}
+
+  size_t columns() const noexcept { return columns_; }
+  size_t rows() const noexcept { return rows_; }
+  uint32_t step() const noexcept { return uint32_t{1} << step_log2_; }
+
+  point box_min(size_t col, size_t row) const noexcept {
+    return {origin_.x + static_cast<uint32_t>(col << step_log2_), origin_.y + static_cast<uint32_t>(row << step_log2_)};
+  }
+  point box_max(size_t col, size_t row) const noexcept {
+    const point min = box_min(col, row);
+    return {clamped(uint64_t{min.x} + (uint64_t{2} << step_log2_)),
+        clamped(uint64_t{min.y} + (uint64_t{2} << step_log2_))};
+  }
+
+  /// Index of the first box of the sweep containing the point or `no_box` if the point is out of all boxes.
+  size_t first_box(point pt) const noexcept {
+    const size_t col = first_step(origin_.x, pt.x, columns_);
+    const size_t row = first_step(origin_.y, pt.y, rows_);
+    return col == no_box || row == no_box ? no_box : col * rows_ + row;
+  }
+
+  /// Half box cell containing the point. Points out of the boxes are put to the border cells.
+  size_t cell_column(uint32_t x) const noexcept { return cell_of(origin_.x, x, columns_); }
+  size_t cell_row(uint32_t y) const noexcept { return cell_of(origin_.y, y, rows_); }
+
+private:
+  static uint32_t clamped(uint64_t coord) noexcept {
+    return static_cast<uint32_t>(std::min<uint64_t>(coord, std::numeric_limits<uint32_t>::max()));
+  }
+
+  size_t steps_before(uint32_t origin, uint32_t max) const noexcept {
+    return max > origin ? static_cast<size_t>((uint64_t{max} - origin + step() - 1) >> step_log2_) : 0;
+  }
+
+  // Smallest index of the box ending at or after the `coord`
+  size_t first_step(uint32_t origin, uint32_t coord, size_t count) const noexcept {
+    if (coord < origin)
+      return no_box;
+    const uint64_t offset = coord - origin;
+    const uint64_t side = uint64_t{2} << step_log2_;
+    const size_t index = offset <= side ? 0 : static_cast<size_t>((offset - side + step() - 1) >> step_log2_);
+    return index < count ? index : no_box;
+  }
+
+  size_t cell_of(uint32_t origin, uint32_t coord, size_t count) const noexcept {
+    return coord < origin ? 0 : std::min<size_t>((coord - origin) >> step_log2_, count + 1);
+  }
+
+  point origin_;
+  unsigned step_log2_;
+  size_t columns_;
+  size_t rows_;
+};
+
+struct grid_entry {
+  marker value;
+  point pos;
+  uint64_t seq;
+  uint32_t next;
+};
+
+// Scratch memory of a merge. Kept per thread and reused by the following merges, so a merge on a warm thread
+// allocates nothing unless it is larger than all the previous ones.
+struct merge_buffers {
+  std::vector<size_t> group_boxes;
+  std::vector<size_t> box_groups;
+  std::vector<size_t> positions;
+  std::vector<marker> items;
+  std::vector<marker> box_markers;
+  std::vector<uint32_t> grid_heads;
+  std::vector<grid_entry> grid_entries;
+  std::vector<uint32_t> grid_found;
+};
+
+// Markers put to the half box cells. Each box overlaps 3x3 cells. Every cell keeps a list of its markers linked through
+// the entry indices so moving markers between the cells allocates nothing. Entries of the removed markers are reused.
+class marker_grid {
+public:
+  marker_grid(const box_layout& boxes, merge_buffers& buffers)
+      : boxes_{boxes}, rows_{boxes.rows() + 2}, heads_{buffers.grid_heads}, entries_{buffers.grid_entries},
+        found_{buffers.grid_found} {
+    heads_.assign((boxes.columns() + 2) * rows_, no_entry);
+    entries_.clear();
+  }
+
+  void add(const marker& value) {
+    const point pos = pointf_to_point(value.point);
+    uint32_t idx = free_;
+    if (idx != no_entry) {
+      free_ = entries_[idx].next;
+    } else {
+      idx = static_cast<uint32_t>(entries_.size());
+      entries_.emplace_back();
+    }
+    uint32_t& head = heads_[boxes_.cell_column(pos.x) * rows_ + boxes_.cell_row(pos.y)];
+    entries_[idx] = {value, pos, next_seq_++, head};
+    head = idx;
+  }
+
+  /// Moves the markers lying in the box to `res` in the order they were added.
+  void extract(size_t col, size_t row, std::vector<marker>& res) {
+    const point min = boxes_.box_min(col, row);
+    const point max = boxes_.box_max(col, row);
+    found_.clear();
+    for (size_t cell_col = col; cell_col < col + 3; ++cell_col) {
+      for (size_t cell_row = row; cell_row < row + 3; ++cell_row) {
+        for (uint32_t* link = &heads_[cell_col * rows_ + cell_row]; *link != no_entry;) {
+          grid_entry& item = entries_[*link];
+          if (!is_in_rect(item.pos, min, max)) {
+            link = &item.next;
+            continue;
+          }
+          found_.push_back(*link);
+          *link = item.next;
+        }
+      }
+    }
+    sort_found();
+    for (uint32_t idx : found_) {
+      res.push_back(entries_[idx].value);
+      entries_[idx].next = free_;
+      free_ = idx;
+    }
+  }
+
+  /// Replaces `res` content with all markers in the order they were added.
+  void markers(std::vector<marker>& res) {
+    found_.clear();
+    for (uint32_t head : heads_) {
+      for (uint32_t idx = head; idx != no_entry; idx = entries_[idx].next)
+        found_.push_back(idx);
+    }
+    sort_found();
+    res.clear();
+    res.reserve(found_.size());
+    for (uint32_t idx : found_)
+      res.push_back(entries_[idx].value);
+  }
+
+private:
+  void sort_found() {
+    std::sort(
+        found_.begin(), found_.end(), [this](uint32_t l, uint32_t r) { return entries_[l].seq < entries_[r].seq; });
+  }
+
+  const box_layout& boxes_;
+  size_t rows_;
+  std::vector<uint32_t>& heads_;
+  std::vector<grid_entry>& entries_;
+  std::vector<uint32_t>& found_;
+  uint32_t free_ = no_entry;
+  uint64_t next_seq_ = 0;
+};
+
+} // namespace
+
+void merge_marker(std::vector<marker>& markers, marker item, uint32_t min_dist) noexcept {
+  for (auto it = markers.begin(); it != markers.end();) {
+    if (!marker_overlaps(it->point, item.point, min_dist)) {
+      ++it;
+      continue;
+    }
+    item = merge_marker(item, *it);
+    it = markers.erase(it);
+    return merge_marker(markers, item, min_dist);
+  }
+  markers.push_back(item);
+}
+
+std::vector<marker> merge_generalizations(const std::vector<point_group>& ads, const std::vector<point_group>& poi,
+    point vp_min, point vp_max, int z_level) {
+  std::vector<marker> res;
+  merge_generalizations(ads, poi, vp_min, vp_max, z_level, res);
+  return res;
+}
+
+void merge_generalizations(const std::vector<point_group>& ads, const std::vector<point_group>& poi, point vp_min,
+    point vp_max, int z_level, std::vector<marker>& res) {
+  thread_local merge_buffers buffers;
+  const box_layout boxes{vp_min, vp_max, z_level};
+
+  // Groups are sorted by the first box containing them with counting sort. Advertized groups of the box go first.
+  std::vector<size_t>& group_boxes = buffers.group_boxes;
+  group_boxes.clear();
+  std::vector<size_t>& box_groups = buffers.box_groups;
+  box_groups.assign(boxes.columns() * boxes.rows() + 1, 0);
+  for (const std::vector<point_group>* groups : {&ads, &poi}) {
+    for (const point_group& group : *groups) {
+      const size_t box = boxes.first_box(group.centroid);
+      group_boxes.push_back(box);
+      if (box != no_box)
+        ++box_groups[box + 1];
+    }
+  }
+  std::partial_sum(box_groups.begin(), box_groups.end(), box_groups.begin());
+  std::vector<marker>& items = buffers.items;
+  items.resize(box_groups.back());
+  std::vector<size_t>& positions = buffers.positions;
+  positions.assign(box_groups.begin(), box_groups.end() - 1);
+  auto group_box = group_boxes.begin();
+  for (const std::vector<point_group>* groups : {&ads, &poi}) {
+    for (const point_group& group : *groups) {
+      const size_t box = *group_box++;
+      if (box != no_box)
+        items[positions[box]++] = {pointf_from_point(group.centroid), group.count, groups == &ads};
+    }
+  }
+
+  marker_grid grid{boxes, buffers};
+  std::vector<marker>& box_markers = buffers.box_markers;
+  for (size_t col = 0; col < boxes.columns(); ++col) {
+    for (size_t row = 0; row < boxes.rows(); ++row) {
+      // No markers in the grid overlap. No need to search and merge overlaps
+      box_markers.clear();
+      grid.extract(col, row, box_markers);
+      const size_t box = col * boxes.rows() + row;
+      for (size_t i = box_groups[box]; i < box_groups[box + 1]; ++i)
+        merge_marker(box_markers, items[i], boxes.step());
+      for (const marker& item : box_markers)
+        grid.add(item);
+    }
+  }
+  grid.markers(res);
+}
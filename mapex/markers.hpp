@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include <QtCore/QPointF>
+
+#include <mapex/generalization.hpp>
+#include <mapex/morton_code.hpp>
+
+struct marker {
+  QPointF point;
+  int poi_count = 1;
+  bool has_advertizers = false;
+};
+
+/// Merges groups of advertized and regular POI reported for the rect with corners `vp_min` and `vp_max` into markers.
+/// Rect is swept with boxes of two `z_level` cells side moved by a single cell, columns first. Groups are merged with
+/// the markers of the first box they fall into and those markers are merged with the groups of every following box
+/// they fall into. Groups and markers are bucketed by half box cells so every box only looks at its neighbourhood.
+std::vector<marker> merge_generalizations(const std::vector<point_group>& ads, const std::vector<point_group>& poi,
+    point vp_min, point vp_max, int z_level);
+/// Same as above but replaces the content of `res` reusing its memory. Scratch memory is kept per thread, so repeated
+/// merges of similar size on the same thread make no heap allocations.
+void merge_generalizations(const std::vector<point_group>& ads, const std::vector<point_group>& poi, point vp_min,
+    point vp_max, int z_level, std::vector<marker>& res);
+
+/// Adds `item` to `markers` merging it with the markers closer than `min_dist` along any axis. Every merged marker is
+/// removed and the merged one is added the same way since it may overlap more markers.
+void merge_marker(std::vector<marker>& markers, marker item, uint32_t min_dist) noexcept;
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/generalization.hpp>
+#include <mapex/markers.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/reference_markers.hpp>
+
+namespace {
+
+bool same_marker(const marker& l, const marker& r) noexcept {
+  return l.point == r.point && l.poi_count == r.poi_count && l.has_advertizers == r.has_advertizers;
+}
+
+int total_count(const std::vector<marker>& markers) {
+  int res = 0;
+  for (const marker& item : markers)
+    res += item.poi_count;
+  return res;
+}
+
+} // namespace
+
+class markers_tests : public QObject {
+  Q_OBJECT
+private:
+  // Groups of the cells in the rect of `side_cells` cells with the top left corner at the `min` cell. Some cells are
+  // left empty and some groups are placed outside of the rect like the ones of the cells on the rect border.
+  std::vector<point_group> gen_groups(int z_level, point min, uint32_t side_cells, double fill) {
+    const unsigned bits = cell_coord_bits(z_level);
+    std::bernoulli_distribution fill_dist{fill};
+    std::uniform_int_distribution<uint32_t> offset_dist{0, (uint32_t{1} << bits) - 1};
+    std::uniform_int_distribution<int> count_dist{1, 100};
+    std::vector<point_group> res;
+    for (uint32_t x = 0; x <= side_cells + 1; ++x) {
+      for (uint32_t y = 0; y <= side_cells + 1; ++y) {
+        if (!fill_dist(rnd_engine_))
+          continue;
+        const point cell{min.x + ((x - 1) << bits), min.y + ((y - 1) << bits)};
+        const point centroid{cell.x + offset_dist(rnd_engine_), cell.y + offset_dist(rnd_engine_)};
+        res.push_back({centroid, count_dist(rnd_engine_)});
+      }
+    }
+    std::shuffle(res.begin(), res.end(), rnd_engine_);
+    return res;
+  }
+
+private slots:
+  void grid_and_reference_give_same_markers_data() {
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<uint32_t>("side_cells");
+    QTest::addColumn<double>("ads_fill");
+    QTest::addColumn<double>("poi_fill");
+
+    for (int z_level = 3; z_level <= max_z_level; ++z_level) {
+      for (uint32_t side_cells : {1, 7, 40}) {
+        // Rect has to fit into the middle half of the world
+        if (side_cells > (1u << (world_coord_range_log2 - cell_coord_bits(z_level) - 2)))
+          continue;
+        QTest::addRow("z%d/%d/sparse", z_level, side_cells) << z_level << side_cells << 0.01 << 0.1;
+        QTest::addRow("z%d/%d/dense", z_level, side_cells) << z_level << side_cells << 0.2 << 1.;
+      }
+    }
+  }
+  void grid_and_reference_give_same_markers() {
+    QFETCH(int, z_level);
+    QFETCH(uint32_t, side_cells);
+    QFETCH(double, ads_fill);
+    QFETCH(double, poi_fill);
+
+    // Rect starts in the middle of a cell and is far enough from the world edges
+    const unsigned bits = cell_coord_bits(z_level);
+    std::uniform_int_distribution<uint32_t> cell_dist{1u << (32 - bits - 2), 3u << (32 - bits - 2)};
+    const point min_cell{cell_dist(rnd_engine_) << bits, cell_dist(rnd_engine_) << bits};
+    const point vp_min{min_cell.x + (1u << (bits - 1)), min_cell.y + (1u << (bits - 1))};
+    const point vp_max{vp_min.x + (side_cells << bits), vp_min.y + (side_cells << bits)};
+    const auto ads = gen_groups(z_level, min_cell, side_cells, ads_fill);
+    const auto poi = gen_groups(z_level, min_cell, side_cells, poi_fill);
+
+    const auto expected = reference_merge_generalizations(ads, poi, vp_min, vp_max, z_level);
+    const auto markers = merge_generalizations(ads, poi, vp_min, vp_max, z_level);
+    QCOMPARE(markers.size(), expected.size());
+    QVERIFY(std::equal(markers.begin(), markers.end(), expected.begin(), same_marker));
+  }
+
+  void groups_out_of_rect_are_dropped() {
+    const int z_level = 10;
+    const unsigned bits = cell_coord_bits(z_level);
+    const point vp_min{1000u << bits, 1000u << bits};
+    const point vp_max{1010u << bits, 1010u << bits};
+    const std::vector<point_group> poi{{{vp_min.x + 10, vp_min.y + 10}, 3}, {{vp_min.x - 10, vp_min.y + 10}, 5},
+        {{vp_max.x + (4u << bits), vp_max.y}, 7}};
+
+    const auto markers = merge_generalizations({}, poi, vp_min, vp_max, z_level);
+    QCOMPARE(total_count(markers), 3);
+    QCOMPARE(markers.size(), size_t{1});
+    QCOMPARE(markers.front().has_advertizers, false);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(markers_tests)
+#include "markers.test.moc"
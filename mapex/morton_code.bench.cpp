@@ -0,0 +1,82 @@
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/morton_code.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 0x40'0000;
+
+} // namespace
+
+class morton_code_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  template <typename Codec>
+  void decode_all() {
+    uint64_t sum = 0;
+    QBENCHMARK {
+      for (uint64_t code : codes_) {
+        const point pt = Codec::decode(code);
+        sum += pt.x ^ pt.y;
+      }
+    }
+    sink_ = sum;
+  }
+
+  template <typename Codec>
+  void code_all() {
+    uint64_t sum = 0;
+    QBENCHMARK {
+      for (point pt : points_)
+        sum ^= Codec::code(pt);
+    }
+    sink_ = sum;
+  }
+
+private slots:
+  void initTestCase() {
+    std::default_random_engine rnd_engine;
+    std::uniform_int_distribution<uint32_t> dist;
+    points_.resize(sample_size);
+    std::generate(points_.begin(), points_.end(), [&] { return point{dist(rnd_engine), dist(rnd_engine)}; });
+    codes_.resize(sample_size);
+    std::transform(points_.begin(), points_.end(), codes_.begin(), morton::code);
+  }
+
+  void decode_portable() { decode_all<morton::portable_codec>(); }
+  void decode_bmi2() {
+    if (!morton::has_fast_bmi2())
+      QSKIP("BMI2 is not available on this CPU");
+    decode_all<morton::bmi2_codec>();
+  }
+
+  void code_portable() { code_all<morton::portable_codec>(); }
+  void code_bmi2() {
+    if (!morton::has_fast_bmi2())
+      QSKIP("BMI2 is not available on this CPU");
+    code_all<morton::bmi2_codec>();
+  }
+
+  void decode_n() {
+    std::vector<point> decoded(codes_.size());
+    QBENCHMARK { morton::decode_n(codes_.data(), codes_.size(), decoded.data()); }
+    sink_ = decoded.back().x;
+  }
+
+  void encode_n() {
+    std::vector<uint64_t> encoded(points_.size());
+    QBENCHMARK { morton::encode_n(points_.data(), points_.size(), encoded.data()); }
+    sink_ = encoded.back();
+  }
+
+private:
+  std::vector<point> points_;
+  std::vector<uint64_t> codes_;
+  volatile uint64_t sink_ = 0;
+};
+
+QTEST_MAIN(morton_code_benchmarks)
+#include "morton_code.bench.moc"
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#include <mapex/morton_code.hpp>
+
+namespace morton {
+
+namespace {
+
+static_assert(sizeof(point) == sizeof(uint64_t), "SIMD kernels load and store points as 64 bit lanes");
+
+void decode_n_scalar(const uint64_t* codes, size_t count, point* points) noexcept {
+  with_fast_codec([&](auto codec) { std::transform(codes, codes + count, points, codec.decode); });
+}
+
+void encode_n_scalar(const point* points, size_t count, uint64_t* codes) noexcept {
+  with_fast_codec([&](auto codec) { std::transform(points, points + count, codes, codec.code); });
+}
+
+#if defined(MAPEX_MORTON_X86)
+
+// SIMD kernels do not separate axes. They perform perfect unshuffle of the code bits (or perfect shuffle when encoding)
+// as a sequence of delta swaps: even bits go to the low half of a 64 bit lane and odd bits go to the high half which is
+// exactly the memory layout of `point` on a little endian machine. See "Hacker's Delight", 7-2 "Shuffling Bits".
+template <unsigned Shift>
+__m128i delta_swap(__m128i val, uint64_t mask) noexcept {
+  const __m128i t = _mm_and_si128(_mm_xor_si128(val, _mm_srli_epi64(val, Shift)), _mm_set1_epi64x(mask));
+  return _mm_xor_si128(_mm_xor_si128(val, t), _mm_slli_epi64(t, Shift));
+}
+
+__m128i unshuffle(__m128i val) noexcept {
+  val = delta_swap<1>(val, 0x2222'2222'2222'2222);
+  val = delta_swap<2>(val, 0x0c0c'0c0c'0c0c'0c0c);
+  val = delta_swap<4>(val, 0x00f0'00f0'00f0'00f0);
+  val = delta_swap<8>(val, 0x0000'ff00'0000'ff00);
+  return delta_swap<16>(val, 0x0000'0000'ffff'0000);
+}
+
+__m128i shuffle(__m128i val) noexcept {
+  val = delta_swap<16>(val, 0x0000'0000'ffff'0000);
+  val = delta_swap<8>(val, 0x0000'ff00'0000'ff00);
+  val = delta_swap<4>(val, 0x00f0'00f0'00f0'00f0);
+  val = delta_swap<2>(val, 0x0c0c'0c0c'0c0c'0c0c);
+  return delta_swap<1>(val, 0x2222'2222'2222'2222);
+}
+
+// 64 bit shifts, and & xor are all in SSE2 which is a part of x86-64 baseline so this kernel needs no runtime check.
+void decode_n_sse2(const uint64_t* codes, size_t count, point* points) noexcept {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(points + i), unshuffle(val));
+  }
+  decode_n_scalar(codes + i, count - i, points + i);
+}
+
+void encode_n_sse2(const point* points, size_t count, uint64_t* codes) noexcept {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i*>(points + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + i), shuffle(val));
+  }
+  encode_n_scalar(points + i, count - i, codes + i);
+}
+
+template <unsigned Shift>
+__attribute__((target("avx2"))) __m256i delta_swap(__m256i val, uint64_t mask) noexcept {
+  const __m256i t = _mm256_and_si256(_mm256_xor_si256(val, _mm256_srli_epi64(val, Shift)), _mm256_set1_epi64x(mask));
+  return _mm256_xor_si256(_mm256_xor_si256(val, t), _mm256_slli_epi64(t, Shift));
+}
+
+__attribute__((target("avx2"))) __m256i unshuffle(__m256i val) noexcept {
+  val = delta_swap<1>(val, 0x2222'2222'2222'2222);
+  val = delta_swap<2>(val, 0x0c0c'0c0c'0c0c'0c0c);
+  val = delta_swap<4>(val, 0x00f0'00f0'00f0'00f0);
+  val = delta_swap<8>(val, 0x0000'ff00'0000'ff00);
+  return delta_swap<16>(val, 0x0000'0000'ffff'0000);
+}
+
+__attribute__((target("avx2"))) __m256i shuffle(__m256i val) noexcept {
+  val = delta_swap<16>(val, 0x0000'0000'ffff'0000);
+  val = delta_swap<8>(val, 0x0000'ff00'0000'ff00);
+  val = delta_swap<4>(val, 0x00f0'00f0'00f0'00f0);
+  val = delta_swap<2>(val, 0x0c0c'0c0c'0c0c'0c0c);
+  return delta_swap<1>(val, 0x2222'2222'2222'2222);
+}
+
+__attribute__((target("avx2"))) void decode_n_avx2(const uint64_t* codes, size_t count, point* points) noexcept {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(points + i), unshuffle(val));
+  }
+  decode_n_sse2(codes + i, count - i, points + i);
+}
+
+__attribute__((target("avx2"))) void encode_n_avx2(const point* points, size_t count, uint64_t* codes) noexcept {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(points + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(codes + i), shuffle(val));
+  }
+  encode_n_sse2(points + i, count - i, codes + i);
+}
+
+bool has_avx2() noexcept {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+struct quadrant {
+  uint64_t first_code;
+  unsigned side_log2;
+
+  uint64_t last_code() const noexcept {
+    return first_code | (side_log2 == 32 ? ~uint64_t{0} : (uint64_t{1} << (2 * side_log2)) - 1);
+  }
+  uint32_t side_mask() const noexcept { return static_cast<uint32_t>((uint64_t{1} << side_log2) - 1); }
+};
+
+enum class overlap { none, partial, full };
+
+// Any key of the quadrant decodes to a point inside of it so the quadrant corners are found by masking.
+overlap classify(point (*decode)(uint64_t), quadrant quad, point rect_min, point rect_max) noexcept {
+  const point some_point = decode(quad.first_code);
+  const point quad_min{some_point.x & ~quad.side_mask(), some_point.y & ~quad.side_mask()};
+  const point quad_max{quad_min.x | quad.side_mask(), quad_min.y | quad.side_mask()};
+  if (quad_max.x < rect_min.x || quad_max.y < rect_min.y || quad_min.x > rect_max.x || quad_min.y > rect_max.y)
+    return overlap::none;
+  if (is_in_rect(quad_min, rect_min, rect_max) && is_in_rect(quad_max, rect_min, rect_max))
+    return overlap::full;
+  return overlap::partial;
+}
+
+unsigned common_quadrant_side_log2(uint64_t min, uint64_t max) noexcept {
+  unsigned res = 0;
+  for (uint64_t diff = min ^ max; diff != 0; diff >>= 2)
+    ++res;
+  return res;
+}
+
+} // namespace
+
+#if defined(MAPEX_MORTON_X86)
+
+bool has_fast_bmi2() noexcept {
+  // AMD family 17h (Zen, Zen 2) implements pdep/pext in microcode with latency depending on the mask population. They
+  // are much slower there than the portable shift/mask sequence.
+  static const bool res = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam17h");
+  }();
+  return res;
+}
+
+void decode_n(const uint64_t* codes, size_t count, point* points) noexcept {
+  static const auto impl = has_avx2() ? decode_n_avx2 : decode_n_sse2;
+  impl(codes, count, points);
+}
+
+void encode_n(const point* points, size_t count, uint64_t* codes) noexcept {
+  static const auto impl = has_avx2() ? encode_n_avx2 : encode_n_sse2;
+  impl(points, count, codes);
+}
+
+#else
+
+bool has_fast_bmi2() noexcept { return false; }
+
+void decode_n(const uint64_t* codes, size_t count, point* points) noexcept { decode_n_scalar(codes, count, points); }
+void encode_n(const point* points, size_t count, uint64_t* codes) noexcept { encode_n_scalar(points, count, codes); }
+
+#endif
+
+std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges) {
+  return detail::decompose(morton::decode, min, max, decode(min), decode(max), max_ranges);
+}
+
+void decode_n(const uint32_t* codes, size_t count, point* points) noexcept {
+  constexpr uint32_t half_quantum = uint32_t{1} << (quantized_axis_shift - 1);
+  std::array<uint64_t, 256> full;
+  for (size_t pos = 0; pos < count; pos += full.size()) {
+    const size_t batch_size = std::min(count - pos, full.size());
+    std::transform(codes + pos, codes + pos + batch_size, full.begin(), dequantize);
+    decode_n(full.data(), batch_size, points + pos);
+    std::for_each(
+        points + pos, points + pos + batch_size, [](point& pt) { pt = pt + point{half_quantum, half_quantum}; });
+  }
+}
+
+void encode_n(const point* points, size_t count, uint32_t* codes) noexcept {
+  std::array<uint64_t, 256> full;
+  for (size_t pos = 0; pos < count; pos += full.size()) {
+    const size_t batch_size = std::min(count - pos, full.size());
+    encode_n(points + pos, batch_size, full.data());
+    std::transform(full.begin(), full.begin() + batch_size, codes + pos, quantize);
+  }
+}
+
+std::vector<z_range> decompose(uint32_t min, uint32_t max, size_t max_ranges) {
+  // Rect of the whole squares is split at the square boundaries so the full code intervals convert exactly
+  std::vector<z_range> res = decompose(dequantize(min), dequantize(max) | ~uint32_t{0}, max_ranges);
+  for (z_range& range : res)
+    range = {quantize(range.min), quantize(range.max), range.exact};
+  return res;
+}
+
+std::vector<z_range> detail::decompose(point (*decode)(uint64_t), uint64_t first, uint64_t last, point rect_min,
+    point rect_max, size_t max_ranges) {
+  assert(max_ranges > 0);
+  assert(rect_min.x <= rect_max.x);
+  assert(rect_min.y <= rect_max.y);
+  assert(first <= last);
+  const unsigned root_side_log2 = common_quadrant_side_log2(first, last);
+  const quadrant root{root_side_log2 == 32 ? 0 : first & (~uint64_t{0} << (2 * root_side_log2)), root_side_log2};
+
+  std::vector<z_range> res;
+  std::vector<quadrant> partial;
+  if (classify(decode, root, rect_min, rect_max) == overlap::full)
+    res.push_back({root.first_code, root.last_code(), true});
+  else
+    partial.push_back(root);
+
+  // Split partially covered quadrants level by level so that the rect border is refined evenly.
+  std::vector<z_range> full_children;
+  std::vector<quadrant> partial_children;
+  while (!partial.empty() && partial.front().side_log2 > 0) {
+    full_children.clear();
+    partial_children.clear();
+    for (const quadrant& quad : partial) {
+      const unsigned child_side_log2 = quad.side_log2 - 1;
+      for (uint64_t child = 0; child < 4; ++child) {
+        const quadrant child_quad{quad.first_code | (child << (2 * child_side_log2)), child_side_log2};
+        switch (classify(decode, child_quad, rect_min, rect_max)) {
+        case overlap::none:
+          break;
+        case overlap::partial:
+          partial_children.push_back(child_quad);
+          break;
+        case overlap::full:
+          full_children.push_back({child_quad.first_code, child_quad.last_code(), true});
+          break;
+        }
+      }
+    }
+    if (res.size() + full_children.size() + partial_children.size() > max_ranges)
+      break;
+    res.insert(res.end(), full_children.begin(), full_children.end());
+    partial.swap(partial_children);
+  }
+  for (const quadrant& quad : partial)
+    res.push_back({quad.first_code, quad.last_code(), quad.side_log2 == 0});
+
+  std::sort(res.begin(), res.end(), [](const z_range& lhs, const z_range& rhs) { return lhs.min < rhs.min; });
+  auto merged_end = res.begin();
+  for (auto it = res.begin(); it != res.end(); ++it) {
+    if (merged_end != res.begin() && std::prev(merged_end)->max + 1 == it->min &&
+        std::prev(merged_end)->exact == it->exact) {
+      std::prev(merged_end)->max = it->max;
+      continue;
+    }
+    *merged_end++ = *it;
+  }
+  res.erase(merged_end, res.end());
+  // Codes outside of [first, last] interval can't belong to the rect. Only not exact quadrants may stick out of it.
+  res.front().min = std::max(res.front().min, first);
+  res.back().max = std::min(res.back().max, last);
+  return res;
+}
+
+} // namespace morton
@@ -1,8 +1,16 @@
 #pragma once
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MAPEX_MORTON_X86 1
+#endif
+
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 struct point {
   uint32_t x = 0;
@@ -54,6 +62,62 @@ constexpr uint32_t deinterleave(uint64_t val) noexcept {
 constexpr uint64_t code(point pt) noexcept { return interleave(pt.x) | (interleave(pt.y) << 1); }
 constexpr point decode(uint64_t code) noexcept { return {deinterleave(code), deinterleave(code >> 1)}; }
 
+/// Codec built on top of constexpr `code`/`decode` functions. Works on any CPU.
+struct portable_codec {
+  static constexpr uint64_t code(point pt) noexcept { return morton::code(pt); }
+  static constexpr point decode(uint64_t code) noexcept { return morton::decode(code); }
+};
+
+#if defined(MAPEX_MORTON_X86)
+// Functions using BMI2 are only inlined into the functions compiled for BMI2 as well
+#define MAPEX_TARGET_BMI2 __attribute__((target("bmi2")))
+
+/// Codec built on top of BMI2 `pdep`/`pext` instructions. Must only be used if `has_fast_bmi2()` returns true.
+struct bmi2_codec {
+  static constexpr uint64_t x_bits = interleave(~uint32_t{0});
+  static constexpr uint64_t y_bits = x_bits << 1;
+
+  MAPEX_TARGET_BMI2 static uint64_t code(point pt) noexcept {
+    return _pdep_u64(pt.x, x_bits) | _pdep_u64(pt.y, y_bits);
+  }
+  MAPEX_TARGET_BMI2 static point decode(uint64_t code) noexcept {
+    return {static_cast<uint32_t>(_pext_u64(code, x_bits)), static_cast<uint32_t>(_pext_u64(code, y_bits))};
+  }
+};
+#else
+#define MAPEX_TARGET_BMI2
+
+struct bmi2_codec : portable_codec {};
+#endif
+
+/// Checks if BMI2 instructions are available and not microcoded on the current CPU.
+bool has_fast_bmi2() noexcept;
+
+namespace detail {
+
+// Everything `func` calls is inlined into a function compiled for BMI2. Otherwise the loops calling the codec are
+// compiled for the baseline CPU and `pdep`/`pext` can't be inlined into them.
+template <typename Func>
+MAPEX_TARGET_BMI2 __attribute__((flatten)) decltype(auto) call_with_bmi2(Func&& func) {
+  return std::forward<Func>(func)(bmi2_codec{});
+}
+
+} // namespace detail
+
+/// Decodes `count` codes into `points` array. Uses the widest SIMD instruction set available on the current CPU.
+void decode_n(const uint64_t* codes, size_t count, point* points) noexcept;
+/// Encodes `count` points into `codes` array. Uses the widest SIMD instruction set available on the current CPU.
+void encode_n(const point* points, size_t count, uint64_t* codes) noexcept;
+
+/// Calls `func` with the fastest codec available on the current CPU. Allows to select codec once for a whole loop
+/// instead of dispatching every single point.
+template <typename Func>
+decltype(auto) with_fast_codec(Func&& func) {
+  if (has_fast_bmi2())
+    return detail::call_with_bmi2(std::forward<Func>(func));
+  return std::forward<Func>(func)(portable_codec{});
+}
+
 namespace detail {
 
 constexpr uint64_t load_masks[] = {interleave(uint32_t{1} << 31) << 1, interleave(~(uint32_t{1} << 31)) << 1};
@@ -101,4 +165,147 @@ constexpr uint64_t bigmin(uint64_t division_point, uint64_t min, uint64_t max) n
   return res;
 }
 
+constexpr uint64_t litmax(uint64_t division_point, uint64_t min, uint64_t max) noexcept {
+  assert(division_point > min);
+  assert(min <= max);
+  // min and max must be codes of rect corners with minimal coordinate values and maximal coordinate values.
+  assert(decode(min).x <= decode(max).x);
+  assert(decode(min).y <= decode(max).y);
+  uint64_t res = min;
+  for (int bit_pos = detail::u64_bits_count - 1; bit_pos >= 0; --bit_pos) {
+    const uint64_t examined_bits =
+        (((division_point >> bit_pos) & 1) << 2) | (((min >> bit_pos) & 1) << 1) | ((max >> bit_pos) & 1);
+    switch (examined_bits) {
+    case 0b000:
+    case 0b111:
+      break;
+    case 0b001:
+      max = detail::load(detail::load_masks[1], bit_pos, max);
+      break;
+    case 0b101:
+      res = detail::load(detail::load_masks[1], bit_pos, max);
+      min = detail::load(detail::load_masks[0], bit_pos, min);
+      break;
+    case 0b011:
+      return res;
+    case 0b100:
+      return max;
+    }
+  }
+  return res;
+}
+
+/// Contiguous interval of codes [min, max]. `exact` is true if all of the codes in the interval belong to the rect the
+/// interval was produced for.
+struct z_range {
+  uint64_t min;
+  uint64_t max;
+  bool exact;
+};
+
+/// Splits the rect with corners `min` and `max` into at most `max_ranges` sorted non overlapping intervals of codes
+/// lying in [min, max]. Intervals cover all of the rect codes. Quadrants which can't be split further without exceeding
+/// `max_ranges` are covered entirely and marked as not exact.
+std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges);
+
+namespace detail {
+
+// Decomposition of the rect into key intervals shared by all curves with quadtree prefix property. `first` and `last`
+// are the smallest and the largest keys of the rect points.
+std::vector<z_range> decompose(point (*decode)(uint64_t), uint64_t first, uint64_t last, point rect_min,
+    point rect_max, size_t max_ranges);
+
+} // namespace detail
+
+/// Morton curve policy for the algorithms generic over the space filling curve. Rect corners passed to the policy
+/// functions are the keys of the top left and the bottom right corners.
+struct curve {
+  using key_type = uint64_t;
+
+  static constexpr uint64_t code(point pt) noexcept { return morton::code(pt); }
+  static constexpr point decode(uint64_t code) noexcept { return morton::decode(code); }
+  static void decode_n(const uint64_t* codes, size_t count, point* points) noexcept {
+    morton::decode_n(codes, count, points);
+  }
+  static void encode_n(const point* points, size_t count, uint64_t* codes) noexcept {
+    morton::encode_n(points, count, codes);
+  }
+  template <typename Func>
+  static decltype(auto) with_fast_codec(Func&& func) {
+    return morton::with_fast_codec(std::forward<Func>(func));
+  }
+  /// Smallest key of the rect points.
+  static constexpr uint64_t rect_first(uint64_t min, uint64_t) noexcept { return min; }
+  /// Largest key of the rect points.
+  static constexpr uint64_t rect_last(uint64_t, uint64_t max) noexcept { return max; }
+  static constexpr uint64_t bigmin(uint64_t division_point, uint64_t min, uint64_t max) noexcept {
+    return morton::bigmin(division_point, min, max);
+  }
+  static std::vector<z_range> decompose(uint64_t min, uint64_t max, size_t max_ranges) {
+    return morton::decompose(min, max, max_ranges);
+  }
+};
+
+/// Number of the low bits of each coordinate dropped by the quantized keys.
+constexpr unsigned quantized_axis_shift = 16;
+
+/// 32 bit Morton code of the top 16 bits of each coordinate. It is the high half of the full code so the quantized
+/// keys are sorted in the same order as the full ones.
+constexpr uint32_t quantize(uint64_t code) noexcept { return static_cast<uint32_t>(code >> 32); }
+/// Smallest full code of the points sharing the quantized `code`.
+constexpr uint64_t dequantize(uint32_t code) noexcept { return uint64_t{code} << 32; }
+
+/// Codec of the quantized keys built on top of a full code codec. Keys are decoded to the centers of the squares of
+/// points sharing them.
+template <typename Codec>
+struct quantized_codec {
+  static constexpr uint32_t code(point pt) noexcept { return quantize(Codec::code(pt)); }
+  static constexpr point decode(uint32_t code) noexcept {
+    constexpr uint32_t half_quantum = uint32_t{1} << (quantized_axis_shift - 1);
+    return Codec::decode(dequantize(code)) + point{half_quantum, half_quantum};
+  }
+};
+
+/// Decodes `count` quantized keys into `points` array.
+void decode_n(const uint32_t* codes, size_t count, point* points) noexcept;
+/// Encodes `count` points into quantized `codes` array.
+void encode_n(const point* points, size_t count, uint32_t* codes) noexcept;
+
+/// Splits the rect with corners `min` and `max` given as quantized keys into intervals of quantized keys. Has the same
+/// guaranties as the overload for the full codes.
+std::vector<z_range> decompose(uint32_t min, uint32_t max, size_t max_ranges);
+
+/// Morton curve policy over the quantized keys. Takes half of the memory of the full keys at the cost of precision:
+/// points are snapped to the centers of squares with the side of 2^16 world units which is a pixel at z-level 8 and a
+/// tile at z-level 16. Cells are exact up to z-level 13 and each key is a cell of its own at the higher ones.
+struct quantized_curve {
+  using key_type = uint32_t;
+
+  static constexpr uint32_t code(point pt) noexcept { return quantized_codec<portable_codec>::code(pt); }
+  static constexpr point decode(uint32_t code) noexcept { return quantized_codec<portable_codec>::decode(code); }
+  static void decode_n(const uint32_t* codes, size_t count, point* points) noexcept {
+    morton::decode_n(codes, count, points);
+  }
+  static void encode_n(const point* points, size_t count, uint32_t* codes) noexcept {
+    morton::encode_n(points, count, codes);
+  }
+  template <typename Func>
+  static decltype(auto) with_fast_codec(Func&& func) {
+    return morton::with_fast_codec(
+        [&](auto codec) { return std::forward<Func>(func)(quantized_codec<decltype(codec)>{}); });
+  }
+  static constexpr uint32_t rect_first(uint32_t min, uint32_t) noexcept { return min; }
+  static constexpr uint32_t rect_last(uint32_t, uint32_t max) noexcept { return max; }
+  /// Full code bigmin is taken after the whole square of the `division_point`. The rect covers whole squares of its
+  /// corner keys so the result is the first code of a square.
+  static constexpr uint32_t bigmin(uint32_t division_point, uint32_t min, uint32_t max) noexcept {
+    return quantize(morton::bigmin(
+        dequantize(division_point) | ~uint32_t{0}, dequantize(min), dequantize(max) | ~uint32_t{0}));
+  }
+  /// Intervals hold quantized keys.
+  static std::vector<z_range> decompose(uint32_t min, uint32_t max, size_t max_ranges) {
+    return morton::decompose(min, max, max_ranges);
+  }
+};
+
 } // namespace morton
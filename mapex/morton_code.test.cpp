@@ -31,6 +31,13 @@ static_assert(morton::bigmin(~uint64_t{0} - 5, ~uint64_t{0} - 12, ~uint64_t{0})
 static_assert(morton::bigmin(0, morton::code({1, 1}), morton::code({3, 5})) == morton::code({1, 1}),
     "bigmin should return top left of the rect for point with code below code of the rect top left");
 
+static_assert(morton::litmax(7, 0, 12) == 6, "litmax should work on a rect in the top left of coordinate space");
+static_assert(morton::litmax(11, 0, 12) == 9, "litmax should skip out of rect codes");
+static_assert(morton::litmax(~uint64_t{0} - 4, ~uint64_t{0} - 12, ~uint64_t{0}) == ~uint64_t{0} - 6,
+    "litmax should work on a rect in the bottom right of coordinate space");
+static_assert(morton::litmax(~uint64_t{0}, morton::code({1, 1}), morton::code({3, 5})) == morton::code({3, 5}),
+    "litmax should return bottom right of the rect for point with code above code of the rect bottom right");
+
 // clang-format off
 constexpr uint32_t values[] = {
     0b0000'0000, 0b0000'0001, 0b0000'0010, 0b0000'0011, 0b0000'0100, 0b0000'0101, 0b0000'0110, 0b0000'0111,
@@ -61,20 +68,39 @@ private:
     }
   }
 
+  std::pair<point, point> random_rect(unsigned coord_bits) {
+    std::uniform_int_distribution<uint32_t> coord_dist{0, ~uint32_t{0} >> (32 - coord_bits)};
+    point min{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
+    point max{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
+    if (min.x > max.x)
+      std::swap(min.x, max.x);
+    if (min.y > max.y)
+      std::swap(min.y, max.y);
+    return {min, max};
+  }
+
+  void random_rects(unsigned coord_bits, unsigned count) {
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+    QTest::addColumn<size_t>("max_ranges");
+
+    for (unsigned i = 0; i < count; ++i) {
+      const auto [min, max] = random_rect(coord_bits);
+      const size_t max_ranges = 1 + i % 64;
+      QTest::addRow("decompose(%llX, %llX, %d)", static_cast<unsigned long long>(morton::code(min)),
+          static_cast<unsigned long long>(morton::code(max)), static_cast<int>(max_ranges))
+          << morton::code(min) << morton::code(max) << max_ranges;
+    }
+  }
+
   void random_rects_with_div_points(unsigned coord_bits, unsigned count) {
     QTest::addColumn<uint64_t>("div_pt");
     QTest::addColumn<uint64_t>("min");
     QTest::addColumn<uint64_t>("max");
 
-    std::uniform_int_distribution<uint32_t> coord_dist{0, ~uint32_t{0} >> (32 - coord_bits)};
     std::uniform_int_distribution<uint64_t> code_dist;
     for (unsigned i = 0; i < count; ++i) {
-      point min{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
-      point max{coord_dist(rnd_engine_), coord_dist(rnd_engine_)};
-      if (min.x > max.x)
-        std::swap(min.x, max.x);
-      if (min.y > max.y)
-        std::swap(min.y, max.y);
+      auto [min, max] = random_rect(coord_bits);
       if (max.x == 0 && max.y == 0)
         max = {1, 1};
       code_dist.param(std::uniform_int_distribution<uint64_t>::param_type{morton::code(min), morton::code(max) - 1});
@@ -85,6 +111,30 @@ private:
     }
   }
 
+  // Rects of the squares sharing a quantized key with `coord_bits` significant bits per axis of the quantized keys
+  void random_quantized_rects_with_div_points(unsigned coord_bits, unsigned count) {
+    QTest::addColumn<uint32_t>("div_pt");
+    QTest::addColumn<uint32_t>("min");
+    QTest::addColumn<uint32_t>("max");
+    QTest::addColumn<size_t>("max_ranges");
+
+    using morton::quantized_axis_shift;
+    std::uniform_int_distribution<uint32_t> code_dist;
+    for (unsigned i = 0; i < count; ++i) {
+      auto [min_square, max_square] = random_rect(coord_bits);
+      if (max_square == min_square)
+        ++max_square.x;
+      const uint32_t min = morton::quantized_curve::code(
+          {min_square.x << quantized_axis_shift, min_square.y << quantized_axis_shift});
+      const uint32_t max = morton::quantized_curve::code(
+          {max_square.x << quantized_axis_shift, max_square.y << quantized_axis_shift});
+      code_dist.param(std::uniform_int_distribution<uint32_t>::param_type{min, max - 1});
+      const uint32_t div_pt = code_dist(rnd_engine_);
+      const size_t max_ranges = 1 + i % 64;
+      QTest::addRow("quantized(%X, %X, %X)", div_pt, min, max) << div_pt << min << max << max_ranges;
+    }
+  }
+
 private slots:
   void encode_and_decode_point_is_identity_data() {
     QTest::addColumn<uint32_t>("x");
@@ -104,6 +154,49 @@ private slots:
     QCOMPARE(morton::decode(morton::code({x, y})), (point{x, y}));
   }
 
+  void bmi2_codec_matches_portable_codec_data() { encode_and_decode_point_is_identity_data(); }
+  void bmi2_codec_matches_portable_codec() {
+    if (!morton::has_fast_bmi2())
+      QSKIP("BMI2 is not available on this CPU");
+    QFETCH(uint32_t, x);
+    QFETCH(uint32_t, y);
+    const uint64_t code = morton::code({x, y});
+    QCOMPARE(morton::bmi2_codec::code({x, y}), code);
+    QCOMPARE(morton::bmi2_codec::decode(code), (point{x, y}));
+  }
+
+  void decode_n_matches_scalar_decode_data() {
+    QTest::addColumn<size_t>("count");
+    for (size_t count : {0, 1, 2, 3, 4, 5, 7, 8, 9, 1023})
+      QTest::addRow("%d", static_cast<int>(count)) << count;
+  }
+  void decode_n_matches_scalar_decode() {
+    QFETCH(size_t, count);
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> codes(count);
+    std::generate(codes.begin(), codes.end(), [&] { return dist(rnd_engine_); });
+    std::vector<point> expected(count);
+    std::transform(codes.begin(), codes.end(), expected.begin(), morton::decode);
+
+    std::vector<point> decoded(count);
+    morton::decode_n(codes.data(), codes.size(), decoded.data());
+    QVERIFY(decoded == expected);
+  }
+
+  void encode_n_matches_scalar_code_data() { decode_n_matches_scalar_decode_data(); }
+  void encode_n_matches_scalar_code() {
+    QFETCH(size_t, count);
+    std::uniform_int_distribution<uint32_t> dist;
+    std::vector<point> points(count);
+    std::generate(points.begin(), points.end(), [&] { return point{dist(rnd_engine_), dist(rnd_engine_)}; });
+    std::vector<uint64_t> expected(count);
+    std::transform(points.begin(), points.end(), expected.begin(), morton::code);
+
+    std::vector<uint64_t> encoded(count);
+    morton::encode_n(points.data(), points.size(), encoded.data());
+    QCOMPARE(encoded, expected);
+  }
+
   void groups_of_4_bits_interleaved_correctly_data() { all_4bit_groups(); }
   void groups_of_4_bits_interleaved_correctly() {
     QFETCH(uint32_t, group_pos);
@@ -147,6 +240,135 @@ private slots:
       QVERIFY(!is_in_rect(morton::decode(pt), morton::decode(min), morton::decode(max)));
   }
 
+  void litmax_result_is_inside_the_rect_data() { random_rects_with_div_points(32, 100); }
+  void litmax_result_is_inside_the_rect() {
+    QFETCH(uint64_t, div_pt);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    if (div_pt == min)
+      QSKIP("litmax requires division point greater then the rect min");
+    const point litmax = morton::decode(morton::litmax(div_pt, min, max));
+    QVERIFY(is_in_rect(litmax, morton::decode(min), morton::decode(max)));
+  }
+
+  void litmax_returns_value_less_then_div_pt_data() { random_rects_with_div_points(32, 100); }
+  void litmax_returns_value_less_then_div_pt() {
+    QFETCH(uint64_t, div_pt);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    if (div_pt == min)
+      QSKIP("litmax requires division point greater then the rect min");
+    QVERIFY(morton::litmax(div_pt, min, max) < div_pt);
+  }
+
+  void no_rect_points_between_litmax_and_div_pt_data() { random_rects_with_div_points(10, 100); }
+  void no_rect_points_between_litmax_and_div_pt() {
+    QFETCH(uint64_t, div_pt);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    if (div_pt == min)
+      QSKIP("litmax requires division point greater then the rect min");
+    const uint64_t litmax = morton::litmax(div_pt, min, max);
+    for (uint64_t pt = litmax + 1; pt < div_pt; ++pt)
+      QVERIFY(!is_in_rect(morton::decode(pt), morton::decode(min), morton::decode(max)));
+  }
+
+  void decompose_returns_no_more_then_max_ranges_data() { random_rects(32, 100); }
+  void decompose_returns_no_more_then_max_ranges() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, max_ranges);
+    QVERIFY(morton::decompose(min, max, max_ranges).size() <= max_ranges);
+  }
+
+  void decompose_returns_sorted_disjoint_ranges_data() { random_rects(32, 100); }
+  void decompose_returns_sorted_disjoint_ranges() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, max_ranges);
+    const auto ranges = morton::decompose(min, max, max_ranges);
+    QCOMPARE(ranges.front().min, min);
+    QCOMPARE(ranges.back().max, max);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      QVERIFY(ranges[i].min <= ranges[i].max);
+      if (i > 0)
+        QVERIFY(ranges[i - 1].max < ranges[i].min);
+    }
+  }
+
+  void decompose_ranges_cover_all_rect_points_data() { random_rects(8, 100); }
+  void decompose_ranges_cover_all_rect_points() {
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, max_ranges);
+    const auto ranges = morton::decompose(min, max, max_ranges);
+    const point rect_min = morton::decode(min);
+    const point rect_max = morton::decode(max);
+    auto range_it = ranges.begin();
+    for (uint64_t code = min; code <= max; ++code) {
+      while (range_it != ranges.end() && range_it->max < code)
+        ++range_it;
+      const bool in_range = range_it != ranges.end() && range_it->min <= code;
+      const bool in_rect = is_in_rect(morton::decode(code), rect_min, rect_max);
+      if (in_rect)
+        QVERIFY(in_range);
+      if (in_range && range_it->exact)
+        QVERIFY(in_rect);
+    }
+  }
+
+  void quantized_decode_n_matches_scalar_decode() {
+    std::uniform_int_distribution<uint32_t> code_dist;
+    std::vector<uint32_t> codes(1000);
+    std::generate(codes.begin(), codes.end(), [&] { return code_dist(rnd_engine_); });
+    std::vector<point> points(codes.size());
+    morton::quantized_curve::decode_n(codes.data(), codes.size(), points.data());
+    for (size_t i = 0; i < codes.size(); ++i) {
+      QVERIFY(points[i] == morton::quantized_curve::decode(codes[i]));
+      QCOMPARE(morton::quantized_curve::code(points[i]), codes[i]);
+    }
+  }
+
+  void quantized_bigmin_skips_only_out_of_rect_keys_data() { random_quantized_rects_with_div_points(5, 100); }
+  void quantized_bigmin_skips_only_out_of_rect_keys() {
+    QFETCH(uint32_t, div_pt);
+    QFETCH(uint32_t, min);
+    QFETCH(uint32_t, max);
+    using curve = morton::quantized_curve;
+    const point rect_min = curve::decode(min);
+    const point rect_max = curve::decode(max);
+    const uint32_t bigmin = curve::bigmin(div_pt, min, max);
+    QVERIFY(bigmin > div_pt);
+    QVERIFY(is_in_rect(curve::decode(bigmin), rect_min, rect_max));
+    for (uint32_t code = div_pt + 1; code < bigmin; ++code)
+      QVERIFY(!is_in_rect(curve::decode(code), rect_min, rect_max));
+  }
+
+  void quantized_decompose_ranges_cover_all_rect_keys_data() { random_quantized_rects_with_div_points(5, 100); }
+  void quantized_decompose_ranges_cover_all_rect_keys() {
+    QFETCH(uint32_t, min);
+    QFETCH(uint32_t, max);
+    QFETCH(size_t, max_ranges);
+    using curve = morton::quantized_curve;
+    const auto ranges = curve::decompose(min, max, max_ranges);
+    QVERIFY(ranges.size() <= max_ranges);
+    QCOMPARE(ranges.front().min, uint64_t{min});
+    QCOMPARE(ranges.back().max, uint64_t{max});
+    const point rect_min = curve::decode(min);
+    const point rect_max = curve::decode(max);
+    auto range_it = ranges.begin();
+    for (uint32_t code = min; code <= max; ++code) {
+      while (range_it != ranges.end() && range_it->max < code)
+        ++range_it;
+      const bool in_range = range_it != ranges.end() && range_it->min <= code;
+      const bool in_rect = is_in_rect(curve::decode(code), rect_min, rect_max);
+      if (in_rect)
+        QVERIFY(in_range);
+      if (in_range && range_it->exact)
+        QVERIFY(in_rect);
+    }
+  }
+
 private:
   std::default_random_engine rnd_engine_;
   const point rect_min_ = {100, 500};
@@ -11,17 +11,25 @@
 
 namespace {
 
+// Body of HTTP error reply is an error page and not the requested content
+bool has_error_status(const QNetworkReply& reply) {
+  const QVariant status = reply.attribute(QNetworkRequest::HttpStatusCodeAttribute);
+  return status.isValid() && status.toInt() >= 400;
+}
+
 // Self-deletes on reply finished. Deletes reply on error.
 class promised_reply final : public QObject {
   Q_OBJECT
 public:
-  promised_reply(QNetworkReply* reply, QObject* parent = nullptr)
-      : QObject{parent}, promise_{pc::canceler_arg, [reply = QPointer<QNetworkReply>{reply}, nm = reply->manager()] {
-                                    post(nm, [reply] {
-                                      if (!reply.isNull())
-                                        reply->abort();
-                                    });
-                                  }} {
+  promised_reply(QNetworkReply* reply,
+      pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data = nullptr, QObject* parent = nullptr)
+      : QObject{parent}, on_data_{std::move(on_data)},
+        promise_{pc::canceler_arg, [reply = QPointer<QNetworkReply>{reply}, nm = reply->manager()] {
+                   post(nm, [reply] {
+                     if (!reply.isNull())
+                       reply->abort();
+                   });
+                 }} {
     reply->setParent(this);
     reply->setObjectName("reply");
     QMetaObject::connectSlotsByName(this);
@@ -30,11 +38,19 @@ public:
   [[nodiscard]] pc::future<std::unique_ptr<QNetworkReply>> get_future() { return promise_.get_future(); }
 
 private slots:
+  void on_reply_readyRead() {
+    auto* reply = qobject_cast<QNetworkReply*>(sender());
+    if (on_data_ && !has_error_status(*reply))
+      on_data_(*reply, reply->readAll());
+  }
+
   void on_reply_finished() {
     deleteLater();
     if (std::exchange(promise_satisfied_, true))
       return;
     auto* reply = qobject_cast<QNetworkReply*>(sender());
+    if (on_data_ && !has_error_status(*reply) && reply->bytesAvailable() > 0)
+      on_data_(*reply, reply->readAll());
     reply->setParent(nullptr);
     promise_.set_value(std::unique_ptr<QNetworkReply>{reply});
   }
@@ -57,6 +73,7 @@ private slots:
   }
 
 private:
+  pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data_;
   pc::promise<std::unique_ptr<QNetworkReply>> promise_;
   bool promise_satisfied_ = false;
 };
@@ -64,8 +81,18 @@ private:
 } // namespace
 
 pc::future<std::unique_ptr<QNetworkReply>> network_thread::send_request(const QUrl& url) {
-  return pc::async(static_cast<QObject*>(&nm_), [nm = &nm_, url] {
-    auto* reply = new promised_reply{nm->get(QNetworkRequest{url}), nm};
+  return send_request(url, nullptr);
+}
+
+pc::future<std::unique_ptr<QNetworkReply>> network_thread::send_request(
+    const QUrl& url, pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data) {
+  return send_request(QNetworkRequest{url}, std::move(on_data));
+}
+
+pc::future<std::unique_ptr<QNetworkReply>> network_thread::send_request(
+    const QNetworkRequest& request, pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data) {
+  return pc::async(static_cast<QObject*>(&nm_), [nm = &nm_, request, on_data = std::move(on_data)]() mutable {
+    auto* reply = new promised_reply{nm->get(request), std::move(on_data), nm};
     return reply->get_future();
   });
 }
@@ -9,7 +9,9 @@
 
 #include <mapex/executors.hpp>
 
+class QByteArray;
 class QNetworkReply;
+class QNetworkRequest;
 class QUrl;
 
 class network_error : public std::system_error {
@@ -29,6 +31,16 @@ public:
 
   /// @threadsafe
   [[nodiscard]] pc::future<std::unique_ptr<QNetworkReply>> send_request(const QUrl& url);
+  /// Passes every chunk of the reply body to `on_data` as soon as it arrives together with the reply which allows to
+  /// check its status and headers. `on_data` is called on the network thread and the returned reply has no data left
+  /// to read.
+  /// @threadsafe
+  [[nodiscard]] pc::future<std::unique_ptr<QNetworkReply>> send_request(
+      const QUrl& url, pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data);
+  /// Same as above for the request with custom headers, e.g. conditional one.
+  /// @threadsafe
+  [[nodiscard]] pc::future<std::unique_ptr<QNetworkReply>> send_request(
+      const QNetworkRequest& request, pc::unique_function<void(const QNetworkReply&, const QByteArray&)> on_data);
 
 private:
   QThread thread_;
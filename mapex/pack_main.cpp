@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QThreadPool>
+
+#include <mapex/poi_pack.hpp>
+
+namespace {
+
+// Peak resident set size of the process in KiB or 0 if unknown
+long peak_rss_kib() {
+#if defined(__linux__)
+  rusage usage{};
+  if (::getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app{argc, argv};
+  QCoreApplication::setApplicationName(QStringLiteral("mapex-pack"));
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(QStringLiteral("Packs lat,lon[,advertized] CSV rows into poi.bin"));
+  parser.addHelpOption();
+  parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("CSV file with POI coordinates"));
+  parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("poi.bin file to write"));
+  const QCommandLineOption memory_opt{QStringLiteral("memory"), QStringLiteral("Memory budget in MiB"),
+      QStringLiteral("MiB"), QStringLiteral("256")};
+  const QCommandLineOption curve_opt{QStringLiteral("curve"), QStringLiteral("Key curve: morton or hilbert"),
+      QStringLiteral("curve"), QStringLiteral("morton")};
+  const QCommandLineOption temp_opt{
+      QStringLiteral("temp-dir"), QStringLiteral("Directory for the sorted runs"), QStringLiteral("dir")};
+  const QCommandLineOption threads_opt{
+      QStringLiteral("threads"), QStringLiteral("Number of worker threads"), QStringLiteral("count")};
+  parser.addOptions({memory_opt, curve_opt, temp_opt, threads_opt});
+  parser.process(app);
+
+  const QStringList args = parser.positionalArguments();
+  if (args.size() != 2)
+    parser.showHelp(1);
+
+  pack_options options;
+  bool valid = true;
+  options.memory_budget = static_cast<size_t>(parser.value(memory_opt).toULongLong(&valid)) << 20;
+  if (!valid || options.memory_budget == 0) {
+    std::fprintf(stderr, "invalid memory budget\n");
+    return 1;
+  }
+  const QString curve = parser.value(curve_opt);
+  if (curve != QLatin1String("morton") && curve != QLatin1String("hilbert")) {
+    std::fprintf(stderr, "unknown curve: %s\n", qUtf8Printable(curve));
+    return 1;
+  }
+  options.curve = curve == QLatin1String("hilbert") ? key_curve::hilbert : key_curve::morton;
+  options.temp_dir = parser.value(temp_opt);
+  if (parser.isSet(threads_opt))
+    QThreadPool::globalInstance()->setMaxThreadCount(parser.value(threads_opt).toInt());
+
+  std::filebuf in;
+  if (!in.open(QFile::encodeName(args[0]).constData(), std::ios::in | std::ios::binary)) {
+    std::fprintf(stderr, "can't open %s\n", qUtf8Printable(args[0]));
+    return 1;
+  }
+  std::filebuf out;
+  if (!out.open(QFile::encodeName(args[1]).constData(), std::ios::out | std::ios::trunc | std::ios::binary)) {
+    std::fprintf(stderr, "can't create %s\n", qUtf8Printable(args[1]));
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  pack_stats stats;
+  try {
+    stats = pack_poi(in, out, options);
+    if (!out.close())
+      throw std::system_error{std::make_error_code(std::errc::io_error), "write poi.bin"};
+  } catch (const std::exception& err) {
+    std::fprintf(stderr, "%s\n", err.what());
+    return 1;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::printf("rows: %llu (%llu skipped)\n", static_cast<unsigned long long>(stats.rows),
+      static_cast<unsigned long long>(stats.skipped));
+  std::printf("keys: %llu advertized, %llu regular\n", static_cast<unsigned long long>(stats.advertized),
+      static_cast<unsigned long long>(stats.regular));
+  std::printf("runs: %zu, merge passes: %zu\n", stats.runs, stats.merge_passes);
+  std::printf("time: %.3f s, %.0f rows/s\n", elapsed.count(), (stats.rows + stats.skipped) / elapsed.count());
+  std::printf("peak RSS: %ld KiB\n", peak_rss_kib());
+  return 0;
+}
@@ -0,0 +1,38 @@
+#include <algorithm>
+
+#include <QtCore/QThreadPool>
+
+#include <portable_concurrency/future>
+
+#include <mapex/executors.hpp>
+#include <mapex/parallel_decode.hpp>
+
+pc::future<std::vector<uint64_t>> decode_all(
+    QThreadPool* pool, std::shared_ptr<const key_blocks> blocks, size_t task_count) {
+  const std::vector<key_blocks::header>& headers = blocks->headers();
+  if (task_count == 0)
+    task_count = static_cast<size_t>(std::max(pool->maxThreadCount(), 1));
+  task_count = std::min(task_count, headers.size());
+  if (task_count == 0)
+    return pc::make_ready_future(std::vector<uint64_t>{});
+
+  auto res = std::make_shared<std::vector<uint64_t>>(blocks->size());
+
+  std::vector<pc::future<void>> tasks;
+  tasks.reserve(task_count);
+  size_t first = 0;
+  uint64_t* out = res->data();
+  for (size_t task = 1; task <= task_count; ++task) {
+    const size_t last = headers.size() * task / task_count;
+    tasks.push_back(pc::async(pool, [blocks, first, last, out] {
+      uint64_t* pos = out;
+      for (size_t idx = first; idx < last; pos += blocks->headers()[idx].count, ++idx)
+        blocks->decode_block(idx, pos);
+    }));
+    for (; first < last; ++first)
+      out += headers[first].count;
+  }
+  return pc::when_all(tasks.begin(), tasks.end()).next([res](std::vector<pc::future<void>>) {
+    return std::move(*res);
+  });
+}
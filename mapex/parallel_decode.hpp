@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <portable_concurrency/future_fwd>
+
+#include <mapex/key_blocks.hpp>
+
+class QThreadPool;
+
+/// Decodes all keys of the `blocks` on the `pool`. Consequent blocks are split into `task_count` groups, by default one
+/// per pool thread, and each group is decoded by a separate task straight into its own slice of the preallocated
+/// result.
+[[nodiscard]] pc::future<std::vector<uint64_t>> decode_all(
+    QThreadPool* pool, std::shared_ptr<const key_blocks> blocks, size_t task_count = 0);
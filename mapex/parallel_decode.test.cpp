@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <QtCore/QThreadPool>
+#include <QtTest/QtTest>
+
+#include <portable_concurrency/future>
+
+#include <mapex/parallel_decode.hpp>
+
+class parallel_decode_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count) {
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+private slots:
+  void decoded_keys_match_sequential_decode_data() {
+    QTest::addColumn<size_t>("count");
+    QTest::addColumn<size_t>("task_count");
+
+    for (size_t count : {0, 1, 128, 129, 1000, 100000}) {
+      // Zero task count means one task per pool thread. More tasks than blocks are clamped to the block count.
+      for (size_t task_count : {0, 1, 3, 8, 1000}) {
+        QTest::addRow("%d/%d", static_cast<int>(count), static_cast<int>(task_count)) << count << task_count;
+      }
+    }
+  }
+  void decoded_keys_match_sequential_decode() {
+    QFETCH(size_t, count);
+    QFETCH(size_t, task_count);
+    const auto keys = gen_keys(count);
+    auto blocks = std::make_shared<const key_blocks>(keys);
+    QVERIFY(decode_all(QThreadPool::globalInstance(), blocks, task_count).get() == keys);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(parallel_decode_tests)
+#include "parallel_decode.test.moc"
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <system_error>
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QThreadPool>
+
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+#include <portable_concurrency/future>
+
+#include <mapex/executors.hpp>
+#include <mapex/mapped_file.hpp>
+#include <mapex/network_thread.hpp>
+#include <mapex/poi_download.hpp>
+#include <mapex/poi_patch.hpp>
+#include <mapex/qfile_category.hpp>
+
+namespace {
+
+// Progress is reported when this number of regular keys is decoded and then each time the number doubles
+constexpr size_t min_progress_keys = 0x1'0000;
+
+constexpr int http_im_used = 226;
+constexpr int http_not_modified = 304;
+// Instance manipulation of RFC 3229 delta encoding: the server may answer to the conditional request with
+// `226 IM Used` and a patch against the cached version of the file
+constexpr char poi_patch_im[] = "mapex-poi-patch";
+
+int http_status(const QNetworkReply& reply) {
+  return reply.attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+// HTTP validators of the cached file stored next to it
+struct cache_validators {
+  QByteArray etag;
+  QByteArray last_modified;
+};
+
+QString validators_path(const QString& cache_path) { return cache_path + QStringLiteral(".validators"); }
+
+cache_validators read_validators(const QString& cache_path) {
+  cache_validators res;
+  QFile file{validators_path(cache_path)};
+  if (!QFileInfo::exists(cache_path) || !file.open(QIODevice::ReadOnly))
+    return res;
+  const QList<QByteArray> lines = file.readAll().split('\n');
+  if (lines.size() >= 2) {
+    res.etag = lines[0];
+    res.last_modified = lines[1];
+  }
+  return res;
+}
+
+cache_validators reply_validators(const QNetworkReply& reply) {
+  return {reply.rawHeader("ETag"), reply.rawHeader("Last-Modified")};
+}
+
+// Validators are optional, failure to save them only causes the full download next time
+void write_validators(const QString& cache_path, const cache_validators& validators) {
+  if (validators.etag.isEmpty() && validators.last_modified.isEmpty()) {
+    QFile::remove(validators_path(cache_path));
+    return;
+  }
+  QSaveFile file{validators_path(cache_path)};
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write(validators.etag + '\n' + validators.last_modified + '\n');
+    file.commit();
+  }
+}
+
+QNetworkRequest make_request(const QUrl& url, const cache_validators& validators) {
+  QNetworkRequest request{url};
+  if (!validators.etag.isEmpty()) {
+    request.setRawHeader("If-None-Match", validators.etag);
+    request.setRawHeader("A-IM", poi_patch_im);
+  }
+  if (!validators.last_modified.isEmpty())
+    request.setRawHeader("If-Modified-Since", validators.last_modified);
+  return request;
+}
+
+poi_keys read_cache(const QString& cache_path) {
+  const mapped_file file{cache_path};
+  return read_poi(file.data(), file.data() + file.size());
+}
+
+// Part of the finished reply required to complete the download away from the network thread
+struct download_reply {
+  int status;
+  cache_validators validators;
+};
+
+struct poi_download {
+  poi_download(const QString& cache_path, pc::unique_function<void(const poi_keys&)> on_progress)
+      : cache{cache_path}, on_progress{std::move(on_progress)} {}
+
+  void on_data(const QNetworkReply& reply, const QByteArray& chunk) {
+    if (error)
+      return;
+    // Patch is small and is applied to the cached keys when it is downloaded completely
+    if (http_status(reply) == http_im_used) {
+      patch += chunk;
+      return;
+    }
+    try {
+      if (cache.write(chunk) != chunk.size())
+        throw file_error(cache, "write cache file");
+      reader.feed(chunk.constData(), chunk.constData() + chunk.size());
+    } catch (...) {
+      // Reported when the download is finished
+      error = std::current_exception();
+      return;
+    }
+    const size_t count = reader.keys().regular.size();
+    if (on_progress && count >= std::max(2 * reported, min_progress_keys)) {
+      reported = count;
+      on_progress(reader.keys());
+    }
+  }
+
+  // Merges the downloaded patch into the cached keys and writes them to the new cache file in the same format. Cache
+  // of the first format version without header is written in the varint format which is the same encoding.
+  poi_keys apply_patch(const QString& cache_path) {
+    const mapped_file file{cache_path};
+    poi_keys keys = read_poi(file.data(), file.data() + file.size());
+    apply_poi_patch(keys, read_poi_patch(patch.constData(), patch.constData() + patch.size()));
+
+    std::stringbuf buf;
+    write_poi(buf, keys, poi_file_format(file.data(), file.data() + file.size()));
+    const std::string content = buf.str();
+    if (cache.write(content.data(), static_cast<qint64>(content.size())) != static_cast<qint64>(content.size()))
+      throw file_error(cache, "write cache file");
+    return keys;
+  }
+
+  QSaveFile cache;
+  poi_stream_reader reader;
+  QByteArray patch;
+  pc::unique_function<void(const poi_keys&)> on_progress;
+  size_t reported = 0;
+  std::exception_ptr error;
+};
+
+} // namespace
+
+pc::future<poi_keys> download_poi(network_thread& net, const QUrl& url, const QString& cache_path,
+    pc::unique_function<void(const poi_keys&)> on_progress) {
+  auto download = std::make_shared<poi_download>(cache_path, std::move(on_progress));
+  if (!download->cache.open(QIODevice::WriteOnly)) {
+    return pc::make_exceptional_future<poi_keys>(
+        std::make_exception_ptr(file_error(download->cache, "create cache file")));
+  }
+  return net
+      .send_request(make_request(url, read_validators(cache_path)),
+          [download](const QNetworkReply& reply, const QByteArray& chunk) { download->on_data(reply, chunk); })
+      // Only the reply is handled on the network thread where it lives and is destroyed
+      .next([download](std::unique_ptr<QNetworkReply> reply) {
+        if (download->error)
+          std::rethrow_exception(download->error);
+        return download_reply{http_status(*reply), reply_validators(*reply)};
+      })
+      // Reading the cache, applying the patch or decoding the blocks format may take a while
+      .next(QThreadPool::globalInstance(), [download, cache_path](download_reply reply) {
+        // Uncommitted new cache file is discarded
+        if (reply.status == http_not_modified)
+          return read_cache(cache_path);
+
+        poi_keys keys;
+        if (reply.status == http_im_used) {
+          try {
+            keys = download->apply_patch(cache_path);
+          } catch (...) {
+            // The cache doesn't match the validators, next request downloads the whole file
+            QFile::remove(validators_path(cache_path));
+            throw;
+          }
+        } else {
+          keys = download->reader.finish();
+        }
+        if (!download->cache.commit())
+          throw file_error(download->cache, "save cache file");
+        write_validators(cache_path, reply.validators);
+        return keys;
+      });
+}
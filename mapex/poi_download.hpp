@@ -0,0 +1,22 @@
+#pragma once
+
+#include <portable_concurrency/functional>
+#include <portable_concurrency/future_fwd>
+
+#include <mapex/poi_file.hpp>
+
+class QString;
+class QUrl;
+class network_thread;
+
+/// Downloads poi.bin from the `url` decoding the keys as the data arrives and writing it to the `cache_path` file at
+/// the same time. The cache file is replaced only after the whole file is downloaded and read successfully.
+/// `on_progress` is called on the network thread with the keys decoded so far each time their number doubles. The
+/// download is completed on the global thread pool once the reply is finished.
+///
+/// ETag and Last-Modified of the downloaded file are stored next to the cache and sent back with the next request as
+/// `If-None-Match` and `If-Modified-Since`. The cached keys are returned if the server answers `304 Not Modified`.
+/// The request also accepts RFC 3229 delta encoding: on `226 IM Used` the body is a patch (see `poi_patch.hpp`) which
+/// is merged into the cached keys.
+[[nodiscard]] pc::future<poi_keys> download_poi(network_thread& net, const QUrl& url, const QString& cache_path,
+    pc::unique_function<void(const poi_keys&)> on_progress = nullptr);
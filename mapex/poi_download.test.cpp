@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QtTest>
+
+#include <portable_concurrency/future>
+
+#include <mapex/network_thread.hpp>
+#include <mapex/poi_download.hpp>
+#include <mapex/poi_patch.hpp>
+
+Q_DECLARE_METATYPE(poi_format);
+
+namespace {
+
+struct http_response {
+  QByteArray status;
+  // Additional header lines each terminated with CRLF
+  QByteArray headers;
+  QByteArray body;
+};
+
+// Local HTTP server which answers requests with the responses built by the `responder` from the request head. The
+// body is sent in small pieces with pauses so that the client receives it in many chunks.
+class http_stand_in : public QObject {
+public:
+  static constexpr int chunk_size = 0x4000;
+  using responder = std::function<http_response(const QByteArray& request)>;
+
+  explicit http_stand_in(responder respond) : respond_{std::move(respond)} {
+    connect(&server_, &QTcpServer::newConnection, this, &http_stand_in::on_new_connection);
+    server_.listen(QHostAddress::LocalHost);
+  }
+  http_stand_in(QByteArray status, QByteArray body)
+      : http_stand_in{[response = http_response{std::move(status), {}, std::move(body)}](const QByteArray&) {
+          return response;
+        }} {}
+
+  QUrl url() const { return QUrl{QString{"http://127.0.0.1:%1/poi.bin"}.arg(server_.serverPort())}; }
+
+private:
+  void on_new_connection() {
+    QTcpSocket* socket = server_.nextPendingConnection();
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    auto request = std::make_shared<QByteArray>();
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket, request] {
+      const bool received = request->contains("\r\n\r\n");
+      *request += socket->readAll();
+      if (received || !request->contains("\r\n\r\n"))
+        return;
+      const auto response = std::make_shared<const http_response>(respond_(*request));
+      socket->write("HTTP/1.1 " + response->status + "\r\n" + response->headers +
+                    "Content-Length: " + QByteArray::number(response->body.size()) + "\r\nConnection: close\r\n\r\n");
+      auto* timer = new QTimer{socket};
+      connect(timer, &QTimer::timeout, socket, [socket, timer, response, pos = 0]() mutable {
+        socket->write(response->body.mid(pos, chunk_size));
+        pos += chunk_size;
+        if (pos < response->body.size())
+          return;
+        timer->stop();
+        socket->disconnectFromHost();
+      });
+      timer->start(1);
+    });
+  }
+
+  QTcpServer server_;
+  responder respond_;
+};
+
+} // namespace
+
+class poi_download_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count) {
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  QByteArray poi_file(const poi_keys& keys, poi_format format) {
+    std::stringbuf buf;
+    write_poi(buf, keys, format);
+    const std::string content = buf.str();
+    return QByteArray{content.data(), static_cast<int>(content.size())};
+  }
+
+  void write_cache(const QByteArray& content) {
+    QFile file{cache_path()};
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(content), static_cast<qint64>(content.size()));
+  }
+
+  QByteArray read_cache() {
+    QFile file{cache_path()};
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray{};
+  }
+
+  QString cache_path() const { return dir_.filePath("poi.bin"); }
+
+  poi_keys download(const QUrl& url) {
+    auto future = download_poi(net_, url, cache_path());
+    if (!QTest::qWaitFor([&] { return future.is_ready(); }, 10000))
+      throw std::runtime_error{"download timeout"};
+    return future.get();
+  }
+
+  QByteArray patch_file(const poi_keys& from, const poi_keys& to) {
+    std::stringbuf buf;
+    write_poi_patch(buf, make_poi_patch(from, to));
+    const std::string content = buf.str();
+    return QByteArray{content.data(), static_cast<int>(content.size())};
+  }
+
+  // Keys with a few regular keys removed and added
+  poi_keys modified(const poi_keys& keys) {
+    poi_keys res = keys;
+    res.regular.erase(res.regular.begin() + 10, res.regular.begin() + 20);
+    const std::vector<uint64_t> added = gen_keys(5);
+    res.regular.insert(res.regular.end(), added.begin(), added.end());
+    std::inplace_merge(res.regular.begin(), res.regular.end() - added.size(), res.regular.end());
+    return res;
+  }
+
+private slots:
+  void init() {
+    QFile::remove(cache_path());
+    QFile::remove(cache_path() + ".validators");
+  }
+
+  void downloaded_keys_are_decoded_and_cached_data() {
+    QTest::addColumn<poi_format>("format");
+    QTest::addRow("varint") << poi_format::varint;
+    QTest::addRow("stream_vbyte") << poi_format::stream_vbyte;
+    QTest::addRow("blocks") << poi_format::blocks;
+  }
+  void downloaded_keys_are_decoded_and_cached() {
+    QFETCH(poi_format, format);
+    const poi_keys keys{key_curve::morton, gen_keys(1000), gen_keys(300000)};
+    const QByteArray content = poi_file(keys, format);
+    http_stand_in server{"200 OK", content};
+
+    std::mutex progress_mtx;
+    std::vector<size_t> progress;
+    bool progress_is_prefix = true;
+    auto future = download_poi(net_, server.url(), cache_path(), [&](const poi_keys& partial) {
+      std::lock_guard<std::mutex> lock{progress_mtx};
+      progress.push_back(partial.regular.size());
+      progress_is_prefix = progress_is_prefix && partial.advertized == keys.advertized &&
+                           std::equal(partial.regular.begin(), partial.regular.end(), keys.regular.begin());
+    });
+    QVERIFY(QTest::qWaitFor([&] { return future.is_ready(); }, 10000));
+    const poi_keys downloaded = future.get();
+    QVERIFY(downloaded.advertized == keys.advertized);
+    QVERIFY(downloaded.regular == keys.regular);
+    QCOMPARE(read_cache(), content);
+
+    std::lock_guard<std::mutex> lock{progress_mtx};
+    QVERIFY(progress_is_prefix);
+    // Varint files are decoded before the download ends, other formats are read at once
+    if (format == poi_format::varint) {
+      QVERIFY(progress.size() > 1);
+      QVERIFY(progress.front() < keys.regular.size());
+    }
+  }
+
+  void failed_download_keeps_cache_data() {
+    QTest::addColumn<QByteArray>("status");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addRow("not_found") << QByteArray{"404 Not Found"} << QByteArray{"Not Found"};
+    QTest::addRow("truncated") << QByteArray{"200 OK"}
+                               << poi_file({key_curve::morton, gen_keys(1000), {}}, poi_format::varint).left(1000);
+  }
+  void failed_download_keeps_cache() {
+    QFETCH(QByteArray, status);
+    QFETCH(QByteArray, body);
+    const QByteArray cached = poi_file({key_curve::morton, gen_keys(10), gen_keys(100)}, poi_format::varint);
+    write_cache(cached);
+    http_stand_in server{status, body};
+
+    auto future = download_poi(net_, server.url(), cache_path());
+    QVERIFY(QTest::qWaitFor([&] { return future.is_ready(); }, 10000));
+    QVERIFY_EXCEPTION_THROWN(future.get(), std::system_error);
+    QCOMPARE(read_cache(), cached);
+  }
+
+  void unchanged_poi_is_not_downloaded_again() {
+    const poi_keys keys{key_curve::morton, gen_keys(100), gen_keys(10000)};
+    const QByteArray content = poi_file(keys, poi_format::varint);
+    std::vector<QByteArray> requests;
+    http_stand_in server{[&](const QByteArray& request) {
+      requests.push_back(request);
+      if (request.contains("If-None-Match: \"v1\"\r\n"))
+        return http_response{"304 Not Modified", "ETag: \"v1\"\r\n", {}};
+      return http_response{"200 OK", "ETag: \"v1\"\r\nLast-Modified: Sun, 18 Oct 2026 07:28:00 GMT\r\n", content};
+    }};
+
+    QVERIFY(download(server.url()).regular == keys.regular);
+    const poi_keys cached = download(server.url());
+    QVERIFY(cached.advertized == keys.advertized);
+    QVERIFY(cached.regular == keys.regular);
+    QCOMPARE(read_cache(), content);
+    QCOMPARE(requests.size(), size_t{2});
+    QVERIFY(!requests[0].contains("If-None-Match"));
+    QVERIFY(requests[1].contains("If-Modified-Since: Sun, 18 Oct 2026 07:28:00 GMT\r\n"));
+  }
+
+  void patch_is_merged_into_cache_data() {
+    QTest::addColumn<poi_format>("format");
+    QTest::addColumn<bool>("headerless");
+    QTest::addRow("headerless") << poi_format::varint << true;
+    QTest::addRow("varint") << poi_format::varint << false;
+    QTest::addRow("stream_vbyte") << poi_format::stream_vbyte << false;
+    QTest::addRow("blocks") << poi_format::blocks << false;
+  }
+  void patch_is_merged_into_cache() {
+    QFETCH(poi_format, format);
+    QFETCH(bool, headerless);
+    const poi_keys old_keys{key_curve::morton, gen_keys(100), gen_keys(100000)};
+    const poi_keys new_keys = modified(old_keys);
+    // First format version is the varint one without the magic, version and curve bytes
+    const QByteArray content = headerless ? poi_file(old_keys, format).mid(4) : poi_file(old_keys, format);
+    const QByteArray patch = patch_file(old_keys, new_keys);
+    QVERIFY(patch.size() < content.size() / 1000);
+    http_stand_in server{[&](const QByteArray& request) {
+      if (request.contains("If-None-Match: \"v1\"\r\n") && request.contains("A-IM: mapex-poi-patch\r\n"))
+        return http_response{"226 IM Used", "ETag: \"v2\"\r\nIM: mapex-poi-patch\r\n", patch};
+      return http_response{"200 OK", "ETag: \"v1\"\r\n", content};
+    }};
+
+    QVERIFY(download(server.url()).regular == old_keys.regular);
+    const poi_keys patched = download(server.url());
+    QVERIFY(patched.advertized == new_keys.advertized);
+    QVERIFY(patched.regular == new_keys.regular);
+    const QByteArray cache = read_cache();
+    QCOMPARE(poi_file_format(cache.constData(), cache.constData() + cache.size()), format);
+    QVERIFY(read_poi(cache.constData(), cache.constData() + cache.size()).regular == new_keys.regular);
+  }
+
+  void mismatched_patch_keeps_cache() {
+    const poi_keys keys{key_curve::morton, gen_keys(10), gen_keys(1000)};
+    const poi_keys other_keys{key_curve::morton, gen_keys(10), gen_keys(1000)};
+    const QByteArray content = poi_file(keys, poi_format::varint);
+    const QByteArray patch = patch_file(other_keys, modified(other_keys));
+    std::vector<QByteArray> requests;
+    http_stand_in server{[&](const QByteArray& request) {
+      requests.push_back(request);
+      if (request.contains("If-None-Match: \"v1\"\r\n"))
+        return http_response{"226 IM Used", "ETag: \"v2\"\r\nIM: mapex-poi-patch\r\n", patch};
+      return http_response{"200 OK", "ETag: \"v1\"\r\n", content};
+    }};
+
+    download(server.url());
+    QVERIFY_EXCEPTION_THROWN(download(server.url()), std::system_error);
+    QCOMPARE(read_cache(), content);
+    // Cache validators are dropped so the whole file is downloaded again
+    QVERIFY(download(server.url()).regular == keys.regular);
+    QCOMPARE(requests.size(), size_t{3});
+    QVERIFY(!requests[2].contains("If-None-Match"));
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  QTemporaryDir dir_;
+  network_thread net_;
+};
+
+QTEST_MAIN(poi_download_tests)
+#include "poi_download.test.moc"
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThreadPool>
+#include <QtTest/QtTest>
+
+#include <portable_concurrency/future>
+
+#include <mapex/mapped_file.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/parallel_decode.hpp>
+#include <mapex/poi_file.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 0x40'0000;
+constexpr size_t advertized_size = 0x1000;
+constexpr uint32_t area_side_log2 = 24;
+constexpr uint32_t area_min = (uint32_t{1} << 31) - (uint32_t{1} << (area_side_log2 - 1));
+constexpr int iterations = 5;
+
+enum class loader { stream, mapped, mapped_blocks };
+
+// Evicts the file from the page cache so the next read has to hit the disk
+bool drop_page_cache(const QString& path) {
+#if defined(__linux__)
+  const int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const bool res = ::fdatasync(fd) == 0 && ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  ::close(fd);
+  return res;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+} // namespace
+
+Q_DECLARE_METATYPE(poi_format);
+Q_DECLARE_METATYPE(loader);
+
+class poi_file_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count) {
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + ((uint32_t{1} << area_side_log2) - 1)};
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return morton::code({dist(rnd_engine_), dist(rnd_engine_)}); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  QString file_path(poi_format format) const {
+    return dir_.filePath(QString::number(static_cast<int>(format)) + ".bin");
+  }
+
+  size_t load(loader how, const QString& path) {
+    switch (how) {
+    case loader::stream: {
+      std::filebuf in;
+      in.open(path.toLocal8Bit().constData(), std::ios_base::in | std::ios_base::binary);
+      return read_poi(in).regular.size();
+    }
+    case loader::mapped: {
+      const mapped_file file{path};
+      return read_poi(file.data(), file.data() + file.size()).regular.size();
+    }
+    case loader::mapped_blocks: {
+      const auto file = std::make_shared<const mapped_file>(path);
+      return read_poi_blocks(file->data(), file->data() + file->size(), file).regular.size();
+    }
+    }
+    return 0;
+  }
+
+private slots:
+  void initTestCase() {
+    QVERIFY(dir_.isValid());
+    const poi_keys keys{key_curve::morton, gen_keys(advertized_size), gen_keys(sample_size)};
+    for (poi_format format : {poi_format::varint, poi_format::stream_vbyte, poi_format::blocks}) {
+      std::filebuf out;
+      QVERIFY(out.open(file_path(format).toLocal8Bit().constData(), std::ios_base::out | std::ios_base::binary));
+      write_poi(out, keys, format);
+    }
+  }
+
+  void load_time_data() {
+    QTest::addColumn<poi_format>("format");
+    QTest::addColumn<loader>("how");
+    QTest::addColumn<bool>("cold");
+
+    const std::pair<const char*, poi_format> formats[] = {{"varint", poi_format::varint},
+        {"stream_vbyte", poi_format::stream_vbyte}, {"blocks", poi_format::blocks}};
+    const std::pair<const char*, loader> loaders[] = {
+        {"stream", loader::stream}, {"mapped", loader::mapped}, {"mapped_blocks", loader::mapped_blocks}};
+    for (auto [format_name, format] : formats) {
+      for (auto [loader_name, how] : loaders) {
+        QTest::addRow("%s/%s/cold", format_name, loader_name) << format << how << true;
+        QTest::addRow("%s/%s/warm", format_name, loader_name) << format << how << false;
+      }
+    }
+  }
+  // Average time of a single load. Cold loads evict the file from the page cache before every iteration.
+  void load_time() {
+    QFETCH(poi_format, format);
+    QFETCH(loader, how);
+    QFETCH(bool, cold);
+    const QString path = file_path(format);
+    if (!cold)
+      QCOMPARE(load(how, path), sample_size);
+
+    std::chrono::steady_clock::duration total{};
+    for (int i = 0; i < iterations; ++i) {
+      if (cold && !drop_page_cache(path))
+        QSKIP("Page cache can't be dropped on this system");
+      const auto start = std::chrono::steady_clock::now();
+      sink_ = load(how, path);
+      total += std::chrono::steady_clock::now() - start;
+    }
+    QTest::setBenchmarkResult(
+        std::chrono::duration<double, std::milli>(total).count() / iterations, QTest::WalltimeMilliseconds);
+  }
+
+  void parallel_load_time_data() {
+    QTest::addColumn<int>("threads");
+    for (int threads : {1, 2, 4, 8, 16, 32})
+      QTest::addRow("%d", threads) << threads;
+  }
+  // Warm load of the blocks format file decoded by the given number of threads
+  void parallel_load_time() {
+    QFETCH(int, threads);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    const QString path = file_path(poi_format::blocks);
+    QBENCHMARK {
+      const auto file = std::make_shared<const mapped_file>(path);
+      poi_blocks blocks = read_poi_blocks(file->data(), file->data() + file->size(), file);
+      sink_ = decode_all(&pool, std::make_shared<const key_blocks>(std::move(blocks.regular))).get().size();
+    }
+    QCOMPARE(sink_, sample_size);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  QTemporaryDir dir_;
+  volatile size_t sink_ = 0;
+};
+
+QTEST_MAIN(poi_file_benchmarks)
+#include "poi_file.bench.moc"
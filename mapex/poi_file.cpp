@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <system_error>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/poi_file.hpp>
+#include <mapex/poi_file_layout.hpp>
+
+namespace {
+
+// First format version has no header
+constexpr int headerless_version = 1;
+
+// Block header is stored as little endian first key, offset and count
+constexpr size_t block_header_size = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+std::system_error bad_file(const char* reason) {
+  return std::system_error{
+      std::make_error_code(std::errc::illegal_byte_sequence), std::string{"read poi.bin: "} + reason};
+}
+
+bool is_known_format(int version) {
+  return version == static_cast<int>(poi_format::varint) || version == static_cast<int>(poi_format::stream_vbyte) ||
+         version == static_cast<int>(poi_format::blocks);
+}
+
+bool is_known_curve(int curve) {
+  return curve == static_cast<int>(key_curve::morton) || curve == static_cast<int>(key_curve::hilbert);
+}
+
+const char* read_varint(const char* first, const char* last, uint64_t& val) {
+  return poi_file_layout::read_varint(first, last, val, [] { return bad_file("truncated varint"); });
+}
+
+struct file_header {
+  int version = headerless_version;
+  key_curve curve = key_curve::morton;
+  uint64_t adv_count = 0;
+};
+
+// Reads the format version and the curve. Returns `first` unchanged for the headerless first version.
+const char* read_version(const char* first, const char* last, file_header& hdr) {
+  if (!poi_file_layout::has_magic(first, last))
+    return first;
+
+  hdr.version = static_cast<uint8_t>(first[2]);
+  const int curve = static_cast<uint8_t>(first[3]);
+  if (!is_known_format(hdr.version)) {
+    throw std::system_error{std::make_error_code(std::errc::not_supported),
+        "read poi.bin: unsupported format version " + std::to_string(hdr.version)};
+  }
+  if (!is_known_curve(curve)) {
+    throw std::system_error{
+        std::make_error_code(std::errc::not_supported), "read poi.bin: unsupported key curve " + std::to_string(curve)};
+  }
+  hdr.curve = static_cast<key_curve>(curve);
+  return first + poi_file_layout::header_size;
+}
+
+// Reads the header and the advertized POI count which follows it in every format version
+const char* read_header(const char* first, const char* last, file_header& hdr) {
+  return read_varint(read_version(first, last, hdr), last, hdr.adv_count);
+}
+
+// Checks that the stream VByte stream of `count` values fits into [first, last)
+void check_stream_vbyte(const char* first, const char* last, uint64_t count) {
+  // Every value takes at least one data byte so the count check guards control section size calculation as well
+  if (count > static_cast<uint64_t>(last - first) ||
+      stream_vbyte::encoded_size(first, count) > static_cast<size_t>(last - first))
+    throw bad_file("truncated stream VByte keys");
+}
+
+const char* read_stream_vbyte(const char* first, const char* last, uint64_t count, std::vector<uint64_t>& keys) {
+  check_stream_vbyte(first, last, count);
+  keys.resize(count);
+  return stream_vbyte::unpack_delta(first, last, count, keys.data());
+}
+
+uint64_t get_le(const char* data, size_t size) noexcept {
+  uint64_t res = 0;
+  for (size_t i = 0; i < size; ++i)
+    res |= uint64_t{static_cast<uint8_t>(data[i])} << (8 * i);
+  return res;
+}
+
+void put_le(std::vector<char>& out, uint64_t val, size_t size) {
+  for (size_t i = 0; i < size; ++i, val >>= 8)
+    out.push_back(static_cast<char>(val & 0xff));
+}
+
+// Layer of the blocks format: varint block count, block headers, varint data size and encoded blocks. Blocks refer to
+// the input region if `storage` owning it is provided and copy the data otherwise.
+const char* read_blocks(const char* first, const char* last, uint64_t count,
+    const std::shared_ptr<const void>& storage, key_blocks& blocks) {
+  uint64_t block_count = 0;
+  first = read_varint(first, last, block_count);
+  if (block_count > static_cast<uint64_t>(last - first) / block_header_size)
+    throw bad_file("truncated block table");
+  std::vector<key_blocks::header> headers(block_count);
+  for (key_blocks::header& hdr : headers) {
+    hdr.first_key = get_le(first, sizeof(uint64_t));
+    hdr.offset = get_le(first + sizeof(uint64_t), sizeof(uint64_t));
+    hdr.count = static_cast<uint32_t>(get_le(first + 2 * sizeof(uint64_t), sizeof(uint32_t)));
+    first += block_header_size;
+  }
+  uint64_t data_size = 0;
+  first = read_varint(first, last, data_size);
+  if (data_size > static_cast<uint64_t>(last - first))
+    throw bad_file("truncated block data");
+
+  // Blocks must be consequent and cover the whole data so that any block can be decoded without further checks
+  uint64_t offset = 0;
+  uint64_t total = 0;
+  for (const key_blocks::header& hdr : headers) {
+    if (hdr.offset != offset || hdr.count == 0 || hdr.count > key_blocks::block_size)
+      throw bad_file("invalid block header");
+    check_stream_vbyte(first + offset, first + data_size, hdr.count - 1);
+    offset += stream_vbyte::encoded_size(first + offset, hdr.count - 1);
+    total += hdr.count;
+  }
+  if (offset != data_size || total != count)
+    throw bad_file("blocks don't match the key count");
+  blocks = storage ? key_blocks{std::move(headers), storage, first, data_size}
+                   : key_blocks{std::move(headers), std::vector<char>(first, first + data_size)};
+  return first + data_size;
+}
+
+void write_blocks(std::vector<char>& out, const key_blocks& blocks) {
+  const uint64_t block_count = blocks.headers().size();
+  varint::pack(&block_count, &block_count + 1, std::back_inserter(out));
+  for (const key_blocks::header& hdr : blocks.headers()) {
+    put_le(out, hdr.first_key, sizeof(uint64_t));
+    put_le(out, hdr.offset, sizeof(uint64_t));
+    put_le(out, hdr.count, sizeof(uint32_t));
+  }
+  const uint64_t data_size = blocks.data_size();
+  varint::pack(&data_size, &data_size + 1, std::back_inserter(out));
+  out.insert(out.end(), blocks.data(), blocks.data() + blocks.data_size());
+}
+
+// Writes magic, version, curve and the number of advertized keys common to all versions with header
+void write_header(std::streambuf& out, poi_format format, key_curve curve, uint64_t adv_count) {
+  std::ostreambuf_iterator<char> it{&out};
+  for (unsigned char bt : poi_file_layout::magic)
+    *it++ = static_cast<char>(bt);
+  *it++ = static_cast<char>(format);
+  *it++ = static_cast<char>(curve);
+  varint::pack(&adv_count, &adv_count + 1, it);
+}
+
+poi_blocks read_blocks(
+    const char* first, const char* last, const file_header& hdr, const std::shared_ptr<const void>& storage) {
+  poi_blocks res;
+  res.curve = hdr.curve;
+  uint64_t count = 0;
+  first = read_varint(first, last, count);
+  first = read_blocks(first, last, hdr.adv_count, storage, res.advertized);
+  read_blocks(first, last, count, storage, res.regular);
+  return res;
+}
+
+// Reads keys of any format version except blocks
+poi_keys read_keys(const char* first, const char* last, const file_header& hdr) {
+  poi_keys res;
+  res.curve = hdr.curve;
+  if (hdr.version == static_cast<int>(poi_format::stream_vbyte)) {
+    uint64_t count = 0;
+    first = read_varint(first, last, count);
+    first = read_stream_vbyte(first, last, hdr.adv_count, res.advertized);
+    read_stream_vbyte(first, last, count, res.regular);
+    return res;
+  }
+
+  // Regular POI count is not stored in varint formats but every varint has exactly one byte without continuation bit
+  const auto count = static_cast<uint64_t>(
+      std::count_if(first, last, [](char bt) { return !(static_cast<uint8_t>(bt) & 0x80); }));
+  if (hdr.adv_count > count)
+    throw bad_file("advertized POI count exceeds the number of keys");
+  res.advertized.resize(hdr.adv_count);
+  res.regular.resize(count - hdr.adv_count);
+  first = delta::unpack_n(first, last, res.advertized.size(), res.advertized.data());
+  delta::unpack_n(first, last, res.regular.size(), res.regular.data());
+  return res;
+}
+
+std::vector<char> read_all(std::streambuf& in) {
+  constexpr std::streamsize chunk_size = 0x10000;
+  std::vector<char> res;
+  for (std::streamsize read = chunk_size; read == chunk_size;) {
+    const size_t size = res.size();
+    res.resize(size + chunk_size);
+    read = in.sgetn(res.data() + size, chunk_size);
+    res.resize(size + read);
+  }
+  return res;
+}
+
+} // namespace
+
+bool has_poi_blocks(const char* first, const char* last) noexcept {
+  return poi_file_layout::has_magic(first, last) &&
+         static_cast<uint8_t>(first[2]) == static_cast<uint8_t>(poi_format::blocks);
+}
+
+poi_format poi_file_format(const char* first, const char* last) {
+  file_header hdr;
+  read_version(first, last, hdr);
+  return hdr.version == headerless_version ? poi_format::varint : static_cast<poi_format>(hdr.version);
+}
+
+poi_keys read_poi(const char* first, const char* last) {
+  if (first == last)
+    return {};
+
+  file_header hdr;
+  first = read_header(first, last, hdr);
+  if (hdr.version != static_cast<int>(poi_format::blocks))
+    return read_keys(first, last, hdr);
+
+  const poi_blocks blocks = read_blocks(first, last, hdr, nullptr);
+  return {blocks.curve, blocks.advertized.decode_all(), blocks.regular.decode_all()};
+}
+
+poi_blocks read_poi_blocks(const char* first, const char* last, std::shared_ptr<const void> storage) {
+  if (first == last)
+    return {};
+
+  file_header hdr;
+  first = read_header(first, last, hdr);
+  if (hdr.version == static_cast<int>(poi_format::blocks))
+    return read_blocks(first, last, hdr, storage);
+
+  const poi_keys keys = read_keys(first, last, hdr);
+  return {keys.curve, key_blocks{keys.advertized}, key_blocks{keys.regular}};
+}
+
+void poi_stream_reader::feed(const char* first, const char* last) {
+  if (stage_ != stage::header && stage_ != stage::buffered)
+    return feed_keys(first, last);
+
+  buffer_.insert(buffer_.end(), first, last);
+  if (stage_ == stage::buffered || buffer_.size() < poi_file_layout::header_size)
+    return;
+
+  file_header hdr;
+  const char* data = read_version(buffer_.data(), buffer_.data() + buffer_.size(), hdr);
+  // Blocks are parsed at once since the whole block table precedes the keys anyway
+  if (hdr.version == static_cast<int>(poi_format::blocks)) {
+    stage_ = stage::buffered;
+    return;
+  }
+  keys_.curve = hdr.curve;
+  stream_vbyte_ = hdr.version == static_cast<int>(poi_format::stream_vbyte);
+  stage_ = stage::adv_count;
+  const std::vector<char> head = std::move(buffer_);
+  buffer_ = {};
+  feed_keys(head.data() + (data - head.data()), head.data() + head.size());
+}
+
+void poi_stream_reader::feed_keys(const char* first, const char* last) {
+  if (stage_ == stage::adv_count) {
+    first = count_unpacker_.unpack_n(first, last, 1, &adv_count_);
+    if (count_unpacker_.decoded() == 0)
+      return;
+    stage_ = stream_vbyte_ ? stage::regular_count : stage::advertized;
+  }
+  if (stage_ == stage::regular_count) {
+    uint64_t count = 0;
+    first = regular_count_unpacker_.unpack_n(first, last, 1, &count);
+    if (regular_count_unpacker_.decoded() == 0)
+      return;
+    adv_stream_ = stream_vbyte::resumable_unpacker{adv_count_};
+    regular_stream_ = stream_vbyte::resumable_unpacker{count};
+    stage_ = stage::advertized;
+  }
+  if (stage_ == stage::advertized) {
+    if (stream_vbyte_) {
+      first = adv_stream_.unpack(first, last, keys_.advertized);
+      if (!adv_stream_.done())
+        return;
+    } else {
+      first = adv_unpacker_.unpack_n(
+          first, last, adv_count_ - adv_unpacker_.decoded(), std::back_inserter(keys_.advertized));
+      if (adv_unpacker_.decoded() < adv_count_)
+        return;
+    }
+    stage_ = stage::regular;
+  }
+  if (stream_vbyte_)
+    regular_stream_.unpack(first, last, keys_.regular);
+  else
+    regular_unpacker_.unpack_n(first, last, std::numeric_limits<size_t>::max(), std::back_inserter(keys_.regular));
+}
+
+poi_keys poi_stream_reader::finish() {
+  switch (stage_) {
+  // Files shorter than the header are headerless
+  case stage::header:
+  case stage::buffered:
+    return read_poi(buffer_.data(), buffer_.data() + buffer_.size());
+  case stage::adv_count:
+  case stage::regular_count:
+  case stage::advertized:
+    throw bad_file("truncated advertized keys");
+  case stage::regular:
+    if (stream_vbyte_ && !regular_stream_.done())
+      throw bad_file("truncated stream VByte keys");
+    // Varint formats have no regular keys count, only a key cut in the middle reveals the truncation
+    if (!stream_vbyte_ && regular_unpacker_.has_partial_value())
+      throw bad_file("truncated varint");
+    break;
+  }
+  return std::move(keys_);
+}
+
+poi_keys read_poi(std::streambuf& in) {
+  const std::vector<char> content = read_all(in);
+  return read_poi(content.data(), content.data() + content.size());
+}
+
+poi_blocks read_poi_blocks(std::streambuf& in) {
+  auto content = std::make_shared<const std::vector<char>>(read_all(in));
+  return read_poi_blocks(content->data(), content->data() + content->size(), content);
+}
+
+void write_poi(std::streambuf& out, const poi_keys& keys, poi_format format) {
+  std::ostreambuf_iterator<char> it{&out};
+  write_header(out, format, keys.curve, keys.advertized.size());
+  if (format == poi_format::varint) {
+    delta::pack(keys.advertized.begin(), keys.advertized.end(), it);
+    delta::pack(keys.regular.begin(), keys.regular.end(), it);
+    return;
+  }
+
+  const uint64_t count = keys.regular.size();
+  varint::pack(&count, &count + 1, it);
+  std::vector<char> data;
+  if (format == poi_format::blocks) {
+    write_blocks(data, key_blocks{keys.advertized});
+    write_blocks(data, key_blocks{keys.regular});
+  } else {
+    data.resize(stream_vbyte::max_encoded_size(keys.advertized.size()) +
+                stream_vbyte::max_encoded_size(keys.regular.size()));
+    size_t size = stream_vbyte::pack_delta(keys.advertized.data(), keys.advertized.size(), data.data());
+    size += stream_vbyte::pack_delta(keys.regular.data(), keys.regular.size(), data.data() + size);
+    data.resize(size);
+  }
+  out.sputn(data.data(), data.size());
+}
+
+void write_poi_header(std::streambuf& out, key_curve curve, uint64_t adv_count) {
+  write_header(out, poi_format::varint, curve, adv_count);
+}
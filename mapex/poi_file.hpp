@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <utility>
+#include <vector>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+
+/// Space filling curve used to build POI keys.
+enum class key_curve : uint8_t { morton = 0, hilbert = 1 };
+
+/// poi.bin format versions which can be written. The first version without header is only read.
+enum class poi_format : uint8_t {
+  /// Varint encoded differences between sorted keys.
+  varint = 2,
+  /// Stream VByte encoded differences between sorted keys which can be decoded with SIMD instructions.
+  stream_vbyte = 3,
+  /// Fixed size blocks of stream VByte encoded keys with a table of block headers. Allows to load the keys without
+  /// decoding them and decode only the blocks required by a query later.
+  blocks = 4,
+};
+
+/// Content of poi.bin file: sorted keys of advertized and regular POI.
+struct poi_keys {
+  key_curve curve = key_curve::morton;
+  std::vector<uint64_t> advertized;
+  std::vector<uint64_t> regular;
+};
+
+/// Content of poi.bin file kept in compressed blocks.
+struct poi_blocks {
+  key_curve curve = key_curve::morton;
+  key_blocks advertized;
+  key_blocks regular;
+};
+
+/// Checks if the `[first, last)` memory region contains poi.bin written in the blocks format which can be loaded
+/// without decoding and then decoded block by block.
+bool has_poi_blocks(const char* first, const char* last) noexcept;
+/// Format of poi.bin content in the `[first, last)` memory region. Files without header are reported as
+/// `poi_format::varint` which is the same encoding with a header. Throws `std::system_error` if the version is unknown.
+poi_format poi_file_format(const char* first, const char* last);
+/// Reads poi.bin content from the `[first, last)` memory region, e.g. a memory mapped file. Keys are decoded straight
+/// into presized vectors. Files without header are read as the first format version with Morton codes.
+poi_keys read_poi(const char* first, const char* last);
+/// Reads poi.bin content without decoding the keys if the file is written in the blocks format. Keys of the other
+/// formats are decoded and packed into blocks. If `storage` owning the `[first, last)` region is provided the blocks
+/// are queried in place of the region instead of being copied.
+poi_blocks read_poi_blocks(const char* first, const char* last, std::shared_ptr<const void> storage = nullptr);
+
+/// Reads the whole stream and parses it with the overload above.
+poi_keys read_poi(std::streambuf& in);
+/// Reads the whole stream and parses it with the overload above keeping the read data as blocks storage.
+poi_blocks read_poi_blocks(std::streambuf& in);
+/// Incremental poi.bin reader fed with consequent chunks of the file, e.g. while it is being downloaded. Keys of the
+/// varint and stream VByte formats are decoded as soon as their bytes arrive so the keys read so far are available
+/// before the end of the file. The blocks format is accumulated and parsed at once when the file is finished.
+class poi_stream_reader {
+public:
+  /// Consumes the next chunk of the file. Throws `std::system_error` if the file is malformed.
+  void feed(const char* first, const char* last);
+  /// Keys decoded so far. Regular keys read so far are always a prefix of the whole sorted sequence.
+  const poi_keys& keys() const noexcept { return keys_; }
+  /// Completes reading after the whole file is fed and returns all its keys. Throws `std::system_error` if the file
+  /// is malformed or truncated.
+  poi_keys finish();
+
+private:
+  enum class stage { header, adv_count, regular_count, advertized, regular, buffered };
+
+  void feed_keys(const char* first, const char* last);
+
+  stage stage_ = stage::header;
+  bool stream_vbyte_ = false;
+  std::vector<char> buffer_;
+  poi_keys keys_;
+  uint64_t adv_count_ = 0;
+  delta::resumable_unpacker count_unpacker_;
+  delta::resumable_unpacker regular_count_unpacker_;
+  // Varint formats
+  delta::resumable_unpacker adv_unpacker_;
+  delta::resumable_unpacker regular_unpacker_;
+  // Stream VByte format
+  stream_vbyte::resumable_unpacker adv_stream_;
+  stream_vbyte::resumable_unpacker regular_stream_;
+};
+
+/// Writes poi.bin content in the specified format.
+void write_poi(std::streambuf& out, const poi_keys& keys, poi_format format = poi_format::stream_vbyte);
+
+/// Writes the header of poi.bin in the varint format. Advertized and then regular keys should be written after it with
+/// `delta::pack` which allows to write the file without holding all of its keys in memory.
+void write_poi_header(std::streambuf& out, key_curve curve, uint64_t adv_count);
+
+/// Calls `func` with the policy of the `curve` so that the code generic over the curve is instantiated for each of
+/// them.
+template <typename Func>
+decltype(auto) with_curve(key_curve curve, Func&& func) {
+  if (curve == key_curve::hilbert)
+    return std::forward<Func>(func)(hilbert::curve{});
+  return std::forward<Func>(func)(morton::curve{});
+}
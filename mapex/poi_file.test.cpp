@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/poi_file.hpp>
+
+Q_DECLARE_METATYPE(key_curve);
+Q_DECLARE_METATYPE(poi_format);
+
+class poi_file_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count) {
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  // First format version: varint advertized count followed by delta packed advertized and regular keys.
+  std::string legacy_file(const std::vector<uint64_t>& advertized, const std::vector<uint64_t>& regular) {
+    std::string res;
+    const uint64_t adv_count = advertized.size();
+    varint::pack(&adv_count, &adv_count + 1, std::back_inserter(res));
+    delta::pack(advertized.begin(), advertized.end(), std::back_inserter(res));
+    delta::pack(regular.begin(), regular.end(), std::back_inserter(res));
+    return res;
+  }
+
+private slots:
+  void written_keys_are_read_back_data() {
+    QTest::addColumn<poi_format>("format");
+    QTest::addColumn<key_curve>("curve");
+    QTest::addColumn<size_t>("adv_count");
+    QTest::addColumn<size_t>("count");
+
+    for (auto [fmt_name, format] : {std::pair{"varint", poi_format::varint},
+             std::pair{"stream_vbyte", poi_format::stream_vbyte}, std::pair{"blocks", poi_format::blocks}}) {
+      for (auto [name, curve] : {std::pair{"morton", key_curve::morton}, std::pair{"hilbert", key_curve::hilbert}}) {
+        QTest::addRow("%s/%s/empty", fmt_name, name) << format << curve << size_t{0} << size_t{0};
+        QTest::addRow("%s/%s/no_advertized", fmt_name, name) << format << curve << size_t{0} << size_t{1000};
+        QTest::addRow("%s/%s/128_advertized", fmt_name, name) << format << curve << size_t{128} << size_t{1000};
+        QTest::addRow("%s/%s/big", fmt_name, name) << format << curve << size_t{333} << size_t{100000};
+      }
+    }
+  }
+  void written_keys_are_read_back() {
+    QFETCH(poi_format, format);
+    QFETCH(key_curve, curve);
+    QFETCH(size_t, adv_count);
+    QFETCH(size_t, count);
+    const poi_keys keys{curve, gen_keys(adv_count), gen_keys(count)};
+    std::stringbuf buf;
+    write_poi(buf, keys, format);
+    const poi_keys read = read_poi(buf);
+    QCOMPARE(read.curve, curve);
+    QVERIFY(read.advertized == keys.advertized);
+    QVERIFY(read.regular == keys.regular);
+  }
+
+  void written_keys_are_read_back_as_blocks_data() { written_keys_are_read_back_data(); }
+  void written_keys_are_read_back_as_blocks() {
+    QFETCH(poi_format, format);
+    QFETCH(key_curve, curve);
+    QFETCH(size_t, adv_count);
+    QFETCH(size_t, count);
+    const poi_keys keys{curve, gen_keys(adv_count), gen_keys(count)};
+    std::stringbuf buf;
+    write_poi(buf, keys, format);
+    const poi_blocks read = read_poi_blocks(buf);
+    QCOMPARE(read.curve, curve);
+    QVERIFY(read.advertized.decode_all() == keys.advertized);
+    QVERIFY(read.regular.decode_all() == keys.regular);
+  }
+
+  void blocks_are_queried_in_place_of_storage_data() { written_keys_are_read_back_data(); }
+  void blocks_are_queried_in_place_of_storage() {
+    QFETCH(poi_format, format);
+    QFETCH(key_curve, curve);
+    QFETCH(size_t, adv_count);
+    QFETCH(size_t, count);
+    const poi_keys keys{curve, gen_keys(adv_count), gen_keys(count)};
+    std::stringbuf buf;
+    write_poi(buf, keys, format);
+    const auto storage = std::make_shared<const std::string>(buf.str());
+    const char* first = storage->data();
+    const char* last = first + storage->size();
+    const poi_keys read = read_poi(first, last);
+    QVERIFY(read.advertized == keys.advertized);
+    QVERIFY(read.regular == keys.regular);
+
+    const poi_blocks blocks = read_poi_blocks(first, last, storage);
+    QCOMPARE(blocks.curve, curve);
+    if (format == poi_format::blocks)
+      QVERIFY(blocks.regular.data() >= first && blocks.regular.data() <= last);
+    QVERIFY(blocks.advertized.decode_all() == keys.advertized);
+    QVERIFY(blocks.regular.decode_all() == keys.regular);
+  }
+
+  void file_format_is_detected_data() { written_keys_are_read_back_data(); }
+  void file_format_is_detected() {
+    QFETCH(poi_format, format);
+    QFETCH(key_curve, curve);
+    QFETCH(size_t, adv_count);
+    QFETCH(size_t, count);
+    std::stringbuf buf;
+    write_poi(buf, poi_keys{curve, gen_keys(adv_count), gen_keys(count)}, format);
+    const std::string content = buf.str();
+    QCOMPARE(has_poi_blocks(content.data(), content.data() + content.size()), format == poi_format::blocks);
+    QCOMPARE(poi_file_format(content.data(), content.data() + content.size()), format);
+    const std::string legacy = legacy_file(gen_keys(adv_count), gen_keys(count));
+    QVERIFY(!has_poi_blocks(legacy.data(), legacy.data() + legacy.size()));
+    QCOMPARE(poi_file_format(legacy.data(), legacy.data() + legacy.size()), poi_format::varint);
+  }
+
+  void first_version_files_are_read_as_morton_codes_data() {
+    QTest::addColumn<size_t>("adv_count");
+
+    // 128 is encoded with varint starting with the same byte as the header
+    for (size_t adv_count : {size_t{0}, size_t{1}, size_t{127}, size_t{128}, size_t{300}})
+      QTest::addRow("%d", static_cast<int>(adv_count)) << adv_count;
+  }
+  void first_version_files_are_read_as_morton_codes() {
+    QFETCH(size_t, adv_count);
+    const auto advertized = gen_keys(adv_count);
+    const auto regular = gen_keys(1000);
+    std::stringbuf buf{legacy_file(advertized, regular)};
+    const poi_keys read = read_poi(buf);
+    QCOMPARE(read.curve, key_curve::morton);
+    QVERIFY(read.advertized == advertized);
+    QVERIFY(read.regular == regular);
+  }
+
+  void stream_reader_reads_file_fed_by_chunks_data() {
+    QTest::addColumn<int>("version");
+    QTest::addColumn<size_t>("chunk_size");
+
+    for (int version : {1, 2, 3, 4}) {
+      for (size_t chunk_size : {1, 3, 4096})
+        QTest::addRow("v%d/%d", version, static_cast<int>(chunk_size)) << version << chunk_size;
+    }
+  }
+  void stream_reader_reads_file_fed_by_chunks() {
+    QFETCH(int, version);
+    QFETCH(size_t, chunk_size);
+    const poi_keys keys{version == 1 ? key_curve::morton : key_curve::hilbert, gen_keys(300), gen_keys(10000)};
+    std::string content = legacy_file(keys.advertized, keys.regular);
+    if (version != 1) {
+      std::stringbuf buf;
+      write_poi(buf, keys, static_cast<poi_format>(version));
+      content = buf.str();
+    }
+
+    poi_stream_reader reader;
+    for (size_t pos = 0; pos < content.size(); pos += chunk_size) {
+      const char* chunk = content.data() + pos;
+      reader.feed(chunk, chunk + std::min(chunk_size, content.size() - pos));
+      const poi_keys& partial = reader.keys();
+      QVERIFY(partial.regular.size() <= keys.regular.size());
+      QVERIFY(std::equal(partial.regular.begin(), partial.regular.end(), keys.regular.begin()));
+    }
+    // Formats without blocks are decoded on the fly
+    if (version != static_cast<int>(poi_format::blocks))
+      QCOMPARE(reader.keys().regular.size(), keys.regular.size());
+    const poi_keys read = reader.finish();
+    QCOMPARE(read.curve, keys.curve);
+    QVERIFY(read.advertized == keys.advertized);
+    QVERIFY(read.regular == keys.regular);
+  }
+
+  void stream_reader_rejects_file_truncated_before_regular_keys() {
+    const std::string content = legacy_file(gen_keys(1000), gen_keys(100));
+    poi_stream_reader reader;
+    reader.feed(content.data(), content.data() + content.size() / 2);
+    QVERIFY_EXCEPTION_THROWN(reader.finish(), std::system_error);
+  }
+
+  void stream_reader_rejects_truncated_stream_vbyte_file() {
+    std::stringbuf buf;
+    write_poi(buf, poi_keys{key_curve::morton, gen_keys(10), gen_keys(1000)}, poi_format::stream_vbyte);
+    const std::string content = buf.str();
+    poi_stream_reader reader;
+    reader.feed(content.data(), content.data() + content.size() - 1);
+    QCOMPARE(reader.keys().advertized.size(), size_t{10});
+    QVERIFY_EXCEPTION_THROWN(reader.finish(), std::system_error);
+  }
+
+  void stream_reader_rejects_varint_file_truncated_in_the_middle_of_key() {
+    const poi_keys keys{key_curve::morton, gen_keys(10), gen_keys(1000)};
+    std::stringbuf buf;
+    write_poi(buf, keys, poi_format::varint);
+    const std::string content = buf.str();
+    // Last delta of random keys takes several bytes
+    poi_stream_reader reader;
+    reader.feed(content.data(), content.data() + content.size() - 1);
+    QCOMPARE(reader.keys().regular.size(), keys.regular.size() - 1);
+    QVERIFY_EXCEPTION_THROWN(reader.finish(), std::system_error);
+  }
+
+  void unknown_format_version_is_rejected() {
+    std::stringbuf buf{std::string{"\x80\x00\x7f\x00", 4}};
+    QVERIFY_EXCEPTION_THROWN(read_poi(buf), std::system_error);
+  }
+
+  void truncated_file_is_rejected_data() {
+    QTest::addColumn<poi_format>("format");
+    QTest::addRow("stream_vbyte") << poi_format::stream_vbyte;
+    QTest::addRow("blocks") << poi_format::blocks;
+  }
+  void truncated_file_is_rejected() {
+    QFETCH(poi_format, format);
+    std::stringbuf buf;
+    write_poi(buf, poi_keys{key_curve::morton, gen_keys(10), gen_keys(1000)}, format);
+    std::string content = buf.str();
+    content.resize(content.size() - 1);
+    std::stringbuf truncated{content};
+    QVERIFY_EXCEPTION_THROWN(read_poi(truncated), std::system_error);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(poi_file_tests)
+#include "poi_file.test.moc"
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <mapex/deltapack.hpp>
+
+/// Building blocks of poi.bin shared with the files which start with its header, e.g. POI patches. Readers of such
+/// files report malformed content with their own errors.
+namespace poi_file_layout {
+
+/// First format version has no header and starts with varint count of advertized POI. Header starts with the bytes
+/// which encode zero value with non canonical varint never produced by the packer.
+constexpr unsigned char magic[] = {0x80, 0x00};
+/// Magic, format version and curve.
+constexpr size_t header_size = 4;
+
+/// Checks if the `[first, last)` memory region is long enough for the header and starts with the magic.
+inline bool has_magic(const char* first, const char* last) noexcept {
+  return last - first >= static_cast<ptrdiff_t>(header_size) && static_cast<uint8_t>(first[0]) == magic[0] &&
+         static_cast<uint8_t>(first[1]) == magic[1];
+}
+
+/// Reads a single varint terminated by a byte without the continuation bit and returns the position after it. Throws
+/// the exception returned by `make_error()` if the region ends before the varint does.
+template <typename MakeError>
+const char* read_varint(const char* first, const char* last, uint64_t& val, MakeError&& make_error) {
+  const char* end = std::find_if(first, last, [](char bt) { return !(static_cast<uint8_t>(bt) & 0x80); });
+  if (end == last)
+    throw make_error();
+  return varint::unpack_n(first, end + 1, 1, &val);
+}
+
+} // namespace poi_file_layout
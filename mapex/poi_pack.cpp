@@ -0,0 +1,581 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThreadPool>
+
+#include <portable_concurrency/future>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/executors.hpp>
+#include <mapex/poi_pack.hpp>
+#include <mapex/projection.hpp>
+
+namespace {
+
+// Smallest read buffer of a run while merging. Merge fan-in is limited so that each run gets at least this much.
+constexpr size_t min_merge_buffer = 0x1'0000;
+
+std::system_error io_error(const char* what) {
+  return std::system_error{std::make_error_code(std::errc::io_error), what};
+}
+
+bool is_space(char ch) noexcept { return ch == ' ' || ch == '\t' || ch == '\r'; }
+
+const char* skip_spaces(const char* first, const char* last) noexcept {
+  return std::find_if_not(first, last, is_space);
+}
+
+// Returns position after the number and the following spaces or nullptr if there is no number
+const char* parse_coord(const char* first, const char* last, double& val) noexcept {
+  first = skip_spaces(first, last);
+  const auto res = std::from_chars(first, last, val);
+  return res.ec == std::errc{} ? skip_spaces(res.ptr, last) : nullptr;
+}
+
+// Parses `lat,lon[,advertized]` row. Returns false for rows which don't describe POI, e.g. the CSV header.
+bool parse_row(const char* first, const char* last, geo_point& pt, bool& advertized) noexcept {
+  double lat = 0;
+  double lon = 0;
+  first = parse_coord(first, last, lat);
+  if (!first || first == last || *first != ',')
+    return false;
+  first = parse_coord(first + 1, last, lon);
+  if (!first)
+    return false;
+  pt = {longitude{lon}, lattitude{lat}};
+  advertized = false;
+  if (first == last)
+    return true;
+  if (*first != ',')
+    return false;
+  first = skip_spaces(first + 1, last);
+  while (last != first && is_space(last[-1]))
+    --last;
+  const std::string_view flag{first, static_cast<size_t>(last - first)};
+  advertized = flag == "1" || flag == "true";
+  return advertized || flag.empty() || flag == "0" || flag == "false";
+}
+
+// Sorted keys of a part of the input parsed by a single task. Reused for consequent blocks to avoid reallocations.
+struct parsed_rows {
+  std::vector<uint64_t> advertized;
+  std::vector<uint64_t> regular;
+  uint64_t rows = 0;
+  uint64_t skipped = 0;
+};
+
+template <typename Curve>
+void parse_rows(const char* first, const char* last, parsed_rows& res) {
+  res.advertized.clear();
+  res.regular.clear();
+  res.rows = 0;
+  res.skipped = 0;
+  while (first != last) {
+    const char* eol = std::find(first, last, '\n');
+    if (skip_spaces(first, eol) != eol) {
+      geo_point pt;
+      bool advertized = false;
+      const QPointF projected = parse_row(first, eol, pt, advertized) ? project(pt) : QPointF{-1., -1.};
+      if (is_projectable(projected)) {
+        (advertized ? res.advertized : res.regular).push_back(Curve::code(pointf_to_point(projected)));
+        ++res.rows;
+      } else {
+        ++res.skipped;
+      }
+    }
+    first = eol == last ? last : eol + 1;
+  }
+  std::sort(res.advertized.begin(), res.advertized.end());
+  std::sort(res.regular.begin(), res.regular.end());
+}
+
+// Reads the next block of complete lines into `block` reusing its memory. `tail` holds the incomplete last line of
+// the previous block on input and the one of the read block on output. Block is empty at the end of the input.
+void read_block(std::streambuf& in, std::vector<char>& tail, std::vector<char>& block, size_t block_size) {
+  block.assign(tail.begin(), tail.end());
+  tail.clear();
+  for (;;) {
+    const size_t size = block.size();
+    block.resize(size + block_size);
+    block.resize(size + static_cast<size_t>(in.sgetn(block.data() + size, static_cast<std::streamsize>(block_size))));
+    // The rest of the input is the last line without line break
+    if (block.size() == size)
+      return;
+    const auto eol = std::find(block.rbegin(), block.rend(), '\n').base();
+    if (eol != block.begin()) {
+      tail.assign(eol, block.end());
+      block.erase(eol, block.end());
+      return;
+    }
+  }
+}
+
+// Splits the block at line breaks into parts parsed by separate tasks into the corresponding elements of `parsed`.
+// Both the text and `parsed` must outlive the tasks.
+std::vector<pc::future<void>> parse_block(
+    QThreadPool* pool, const std::vector<char>& text, std::vector<parsed_rows>& parsed, key_curve curve) {
+  std::vector<pc::future<void>> tasks;
+  tasks.reserve(parsed.size());
+  const char* const end = text.data() + text.size();
+  const char* first = text.data();
+  for (size_t task = 0; task < parsed.size(); ++task) {
+    const char* last = std::find(text.data() + text.size() * (task + 1) / parsed.size(), end, '\n');
+    last = std::max(last == end ? end : last + 1, first);
+    tasks.push_back(pc::async(pool, [first, last, curve, &rows = parsed[task]] {
+      with_curve(curve, [&](auto curve_policy) { parse_rows<decltype(curve_policy)>(first, last, rows); });
+    }));
+    first = last;
+  }
+  return tasks;
+}
+
+void open_run(std::filebuf& file, const QString& path, std::ios::openmode mode) {
+  if (!file.open(QFile::encodeName(path).constData(), mode | std::ios::binary))
+    throw io_error("open run file");
+}
+
+void write_keys(std::streambuf& out, const uint64_t* first, const uint64_t* last) {
+  const auto size = static_cast<std::streamsize>((last - first) * sizeof(uint64_t));
+  if (out.sputn(reinterpret_cast<const char*>(first), size) != size)
+    throw io_error("write run file");
+}
+
+// Buffered sequential reader of the keys stored in a run file
+class run_reader {
+public:
+  run_reader(const QString& path, size_t buffer_size) : buffer_(buffer_size) {
+    open_run(file_, path, std::ios::in);
+    fill();
+  }
+
+  bool empty() const noexcept { return pos_ == buffer_.size(); }
+  uint64_t front() const noexcept { return buffer_[pos_]; }
+  void pop() {
+    if (++pos_ == buffer_.size())
+      fill();
+  }
+
+private:
+  void fill() {
+    buffer_.resize(buffer_.capacity());
+    const auto size = static_cast<size_t>(file_.sgetn(
+        reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size() * sizeof(uint64_t))));
+    if (size % sizeof(uint64_t) != 0)
+      throw io_error("read run file");
+    buffer_.resize(size / sizeof(uint64_t));
+    pos_ = 0;
+  }
+
+  std::filebuf file_;
+  std::vector<uint64_t> buffer_;
+  size_t pos_ = 0;
+};
+
+// Merges sorted runs passing the merged keys to `sink` chunk by chunk
+template <typename Sink>
+void merge_runs(const std::vector<QString>& runs, size_t buffer_size, Sink&& sink) {
+  std::vector<run_reader> readers;
+  readers.reserve(runs.size());
+  for (const QString& path : runs)
+    readers.emplace_back(path, buffer_size);
+
+  using entry = std::pair<uint64_t, size_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+  for (size_t idx = 0; idx < readers.size(); ++idx) {
+    if (!readers[idx].empty())
+      heap.emplace(readers[idx].front(), idx);
+  }
+  std::vector<uint64_t> merged;
+  merged.reserve(buffer_size);
+  while (!heap.empty()) {
+    const auto [key, idx] = heap.top();
+    heap.pop();
+    merged.push_back(key);
+    run_reader& reader = readers[idx];
+    reader.pop();
+    if (!reader.empty())
+      heap.emplace(reader.front(), idx);
+    if (merged.size() == buffer_size) {
+      sink(merged.data(), merged.data() + merged.size());
+      merged.clear();
+    }
+  }
+  if (!merged.empty())
+    sink(merged.data(), merged.data() + merged.size());
+}
+
+// Sorts keys of one kind keeping them in memory while they fit into the budget and spilling them to sorted run files
+// when they don't
+class key_sorter {
+public:
+  key_sorter(QString name, QThreadPool* pool, size_t capacity) : name_{std::move(name)}, pool_{pool} {
+    // Reserved address space is not backed by memory until used, but prevents growth of the buffer beyond the budget
+    keys_.reserve(capacity);
+    scratch_.reserve(capacity);
+  }
+
+  uint64_t size() const noexcept { return size_; }
+  size_t buffered() const noexcept { return keys_.size(); }
+  size_t spilled() const noexcept { return spilled_; }
+
+  // Appends sorted keys to the buffer
+  void add(const std::vector<uint64_t>& keys) {
+    if (keys.empty())
+      return;
+    keys_.insert(keys_.end(), keys.begin(), keys.end());
+    bounds_.push_back(keys_.size());
+    size_ += keys.size();
+  }
+
+  // Writes sorted buffer to a new run file and clears the buffer
+  void spill(const QDir& dir) {
+    if (keys_.empty())
+      return;
+    sort_buffer();
+    std::filebuf file;
+    const QString path = next_run_path(dir);
+    open_run(file, path, std::ios::out | std::ios::trunc);
+    write_keys(file, keys_.data(), keys_.data() + keys_.size());
+    if (!file.close())
+      throw io_error("write run file");
+    runs_.push_back(path);
+    ++spilled_;
+    keys_.clear();
+    bounds_.clear();
+  }
+
+  // Passes all the keys in sorted order to `sink` chunk by chunk. Run files are read with buffers sharing the
+  // `merge_budget`. Returns the number of intermediate merge passes.
+  template <typename Sink>
+  size_t write(const QDir& dir, size_t merge_budget, Sink&& sink) {
+    const size_t chunk_size = std::max(merge_budget, min_merge_buffer) / sizeof(uint64_t);
+    if (runs_.empty()) {
+      sort_buffer();
+      for (size_t pos = 0; pos < keys_.size(); pos += chunk_size)
+        sink(keys_.data() + pos, keys_.data() + std::min(pos + chunk_size, keys_.size()));
+      return 0;
+    }
+
+    spill(dir);
+    std::vector<uint64_t>{}.swap(keys_);
+    std::vector<uint64_t>{}.swap(scratch_);
+    const size_t max_fan_in = std::max<size_t>(merge_budget / min_merge_buffer, 2);
+    size_t passes = 0;
+    for (; runs_.size() > max_fan_in; ++passes) {
+      std::vector<QString> merged;
+      for (size_t first = 0; first < runs_.size(); first += max_fan_in) {
+        const std::vector<QString> group{
+            runs_.begin() + first, runs_.begin() + std::min(first + max_fan_in, runs_.size())};
+        std::filebuf file;
+        merged.push_back(next_run_path(dir));
+        open_run(file, merged.back(), std::ios::out | std::ios::trunc);
+        merge_runs(group, run_buffer_size(merge_budget, group.size()),
+            [&file](const uint64_t* first, const uint64_t* last) { write_keys(file, first, last); });
+        if (!file.close())
+          throw io_error("write run file");
+        for (const QString& path : group)
+          QFile::remove(path);
+      }
+      runs_ = std::move(merged);
+    }
+    merge_runs(runs_, run_buffer_size(merge_budget, runs_.size()), std::forward<Sink>(sink));
+    return passes;
+  }
+
+private:
+  // Each run and the merged output get equal share of the budget
+  static size_t run_buffer_size(size_t merge_budget, size_t run_count) noexcept {
+    return std::max(merge_budget / (run_count + 1), min_merge_buffer) / sizeof(uint64_t);
+  }
+
+  QString next_run_path(const QDir& dir) { return dir.filePath(name_ + QString::number(run_index_++)); }
+
+  // Merges sorted segments of the buffer pairwise on the pool until a single one is left
+  void sort_buffer() {
+    while (bounds_.size() > 1) {
+      scratch_.resize(keys_.size());
+      std::vector<pc::future<void>> tasks;
+      std::vector<size_t> merged_bounds;
+      size_t first = 0;
+      for (size_t idx = 0; idx < bounds_.size(); idx += 2) {
+        const size_t mid = bounds_[idx];
+        const size_t last = idx + 1 < bounds_.size() ? bounds_[idx + 1] : mid;
+        tasks.push_back(pc::async(pool_, [src = keys_.data(), dest = scratch_.data(), first, mid, last] {
+          std::merge(src + first, src + mid, src + mid, src + last, dest + first);
+        }));
+        merged_bounds.push_back(last);
+        first = last;
+      }
+      for (pc::future<void>& task : tasks)
+        task.get();
+      keys_.swap(scratch_);
+      bounds_ = std::move(merged_bounds);
+    }
+  }
+
+  QString name_;
+  QThreadPool* pool_;
+  std::vector<uint64_t> keys_;
+  std::vector<uint64_t> scratch_;
+  // End of each sorted segment of `keys_`
+  std::vector<size_t> bounds_;
+  std::vector<QString> runs_;
+  size_t run_index_ = 0;
+  size_t spilled_ = 0;
+  uint64_t size_ = 0;
+};
+
+// Delta packs consequent chunks of a sorted sequence
+class delta_writer {
+public:
+  explicit delta_writer(std::streambuf& out) noexcept : out_{out} {}
+
+  void operator()(const uint64_t* first, const uint64_t* last) {
+    buffer_.clear();
+    delta::pack(first, last, std::back_inserter(buffer_), prev_);
+    prev_ = last[-1];
+    const auto size = static_cast<std::streamsize>(buffer_.size());
+    if (out_.sputn(buffer_.data(), size) != size)
+      throw io_error("write poi.bin");
+  }
+
+private:
+  std::streambuf& out_;
+  std::vector<char> buffer_;
+  uint64_t prev_ = 0;
+};
+
+// Points generated by a single task. Chunks are seeded independently so that the generated points don't depend on the
+// number of tasks.
+constexpr uint64_t generate_chunk_size = 0x1'0000;
+
+uint64_t mix_seed(uint64_t seed) noexcept {
+  // splitmix64 finalizer
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111eb;
+  return seed ^ (seed >> 31);
+}
+
+// Standard distributions are implementation defined, so the values are derived from the engine output directly to
+// generate the same file with any standard library.
+class generator_random {
+public:
+  explicit generator_random(uint64_t seed) : engine_{mix_seed(seed)} {}
+
+  // Uniform in [0, 1)
+  double uniform() noexcept { return static_cast<double>(engine_() >> 11) * 0x1p-53; }
+  // Standard normal with the Box-Muller transform
+  double normal() noexcept {
+    constexpr double two_pi = 6.283185307179586;
+    const double radius = std::sqrt(-2. * std::log(1. - uniform()));
+    return radius * std::cos(two_pi * uniform());
+  }
+
+private:
+  std::mt19937_64 engine_;
+};
+
+point to_world_point(double x, double y) noexcept {
+  constexpr double world_size = 0x1p32;
+  return {static_cast<uint32_t>(std::clamp(x * world_size, 0., world_size - 1.)),
+      static_cast<uint32_t>(std::clamp(y * world_size, 0., world_size - 1.))};
+}
+
+// City centers in projected coordinates with the Zipf weights
+class city_model {
+public:
+  explicit city_model(const generate_options& options) {
+    // Roughly the inhabited latitudes in the Web Mercator projection
+    constexpr double min_y = 0.25;
+    constexpr double max_y = 0.75;
+    generator_random rnd{options.seed};
+    double total_weight = 0;
+    for (size_t rank = 1; rank <= options.cities; ++rank) {
+      const double weight = 1. / rank;
+      const double x = rnd.uniform();
+      const double y = min_y + (max_y - min_y) * rnd.uniform();
+      cities_.push_back({QPointF{x, y}, options.city_radius * std::sqrt(weight)});
+      total_weight += weight;
+      cumulative_weights_.push_back(total_weight);
+    }
+    for (double& weight : cumulative_weights_)
+      weight /= total_weight;
+  }
+
+  bool empty() const noexcept { return cities_.empty(); }
+
+  point random_point(generator_random& rnd) const noexcept {
+    const size_t idx = std::lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), rnd.uniform()) -
+                       cumulative_weights_.begin();
+    const city& target = cities_[std::min(idx, cities_.size() - 1)];
+    const double x = target.center.x() + target.sigma * rnd.normal();
+    const double y = target.center.y() + target.sigma * rnd.normal();
+    return to_world_point(x, y);
+  }
+
+private:
+  struct city {
+    QPointF center;
+    double sigma;
+  };
+
+  std::vector<city> cities_;
+  std::vector<double> cumulative_weights_;
+};
+
+template <typename Curve>
+void generate_rows(const city_model& cities, const generate_options& options, uint64_t chunk, parsed_rows& res) {
+  res.advertized.clear();
+  res.regular.clear();
+  res.skipped = 0;
+  const uint64_t first = chunk * generate_chunk_size;
+  res.rows = std::min(options.count - first, generate_chunk_size);
+  // Chunk engines are seeded with consecutive values following the mixed seed so they differ from the city model one
+  generator_random rnd{mix_seed(options.seed) + chunk + 1};
+  for (uint64_t idx = 0; idx < res.rows; ++idx) {
+    const bool noise = cities.empty() || rnd.uniform() < options.noise_ratio;
+    const point pt = noise ? to_world_point(rnd.uniform(), rnd.uniform()) : cities.random_point(rnd);
+    (rnd.uniform() < options.advertized_ratio ? res.advertized : res.regular).push_back(Curve::code(pt));
+  }
+  std::sort(res.advertized.begin(), res.advertized.end());
+  std::sort(res.regular.begin(), res.regular.end());
+}
+
+// Sorts advertized and regular keys within the memory budget and writes them as poi.bin
+class poi_sorter {
+public:
+  // Half of the budget is taken by the buffered keys together with the scratch space used to merge them. Run files
+  // are merged with buffers taking a quarter of the budget.
+  poi_sorter(const pack_options& options, QThreadPool* pool)
+      : temp_dir_path_{options.temp_dir}, curve_{options.curve},
+        run_capacity_{std::max<size_t>(options.memory_budget / 4 / sizeof(uint64_t), 0x1000)},
+        merge_budget_{options.memory_budget / 4}, advertized_{QStringLiteral("advertized-"), pool, run_capacity_},
+        regular_{QStringLiteral("regular-"), pool, run_capacity_} {}
+
+  void add(const parsed_rows& rows, pack_stats& stats) {
+    stats.rows += rows.rows;
+    stats.skipped += rows.skipped;
+    if (advertized_.buffered() + regular_.buffered() + rows.advertized.size() + rows.regular.size() >
+        run_capacity_) {
+      advertized_.spill(run_dir());
+      regular_.spill(run_dir());
+    }
+    advertized_.add(rows.advertized);
+    regular_.add(rows.regular);
+  }
+
+  void write(std::streambuf& out, pack_stats& stats) {
+    stats.advertized = advertized_.size();
+    stats.regular = regular_.size();
+    const QDir dir = temp_dir_ ? run_dir() : QDir{};
+    write_poi_header(out, curve_, advertized_.size());
+    stats.merge_passes += advertized_.write(dir, merge_budget_, delta_writer{out});
+    stats.merge_passes += regular_.write(dir, merge_budget_, delta_writer{out});
+    stats.runs = advertized_.spilled() + regular_.spilled();
+  }
+
+private:
+  QDir run_dir() {
+    if (!temp_dir_) {
+      const QDir parent{temp_dir_path_.isEmpty() ? QDir::tempPath() : temp_dir_path_};
+      temp_dir_.emplace(parent.filePath(QStringLiteral("mapex-pack-XXXXXX")));
+      if (!temp_dir_->isValid())
+        throw io_error("create temporary directory");
+    }
+    return QDir{temp_dir_->path()};
+  }
+
+  QString temp_dir_path_;
+  key_curve curve_;
+  size_t run_capacity_;
+  size_t merge_budget_;
+  std::optional<QTemporaryDir> temp_dir_;
+  key_sorter advertized_;
+  key_sorter regular_;
+};
+
+} // namespace
+
+pack_stats pack_poi(std::streambuf& csv, std::streambuf& out, const pack_options& options) {
+  QThreadPool* pool = options.pool ? options.pool : QThreadPool::globalInstance();
+  const auto task_count = static_cast<size_t>(std::max(pool->maxThreadCount(), 1));
+  // Besides the keys buffered by the sorter two blocks of text (one is read while the other one is parsed) and the
+  // keys parsed from a block take much less. The rest is left for the allocator overhead.
+  const size_t block_size = std::max<size_t>(options.memory_budget / 32, 0x1000);
+
+  pack_stats stats;
+  poi_sorter sorter{options, pool};
+  // Input buffers are released before the keys are merged
+  {
+    std::vector<char> tail;
+    std::vector<char> text;
+    std::vector<char> next_text;
+    std::vector<parsed_rows> parsed(task_count);
+    read_block(csv, tail, text, block_size);
+    while (!text.empty()) {
+      // Next block is read while the current one is parsed. The text must outlive the parsing tasks.
+      std::vector<pc::future<void>> tasks = parse_block(pool, text, parsed, options.curve);
+      auto parsed_all = pc::when_all(tasks.begin(), tasks.end());
+      try {
+        read_block(csv, tail, next_text, block_size);
+      } catch (...) {
+        // The text and the parsed rows are destroyed when the exception leaves the scope
+        parsed_all.wait();
+        throw;
+      }
+      for (pc::future<void>& task : parsed_all.get())
+        task.get();
+      for (const parsed_rows& rows : parsed)
+        sorter.add(rows, stats);
+      text.swap(next_text);
+    }
+  }
+  sorter.write(out, stats);
+  return stats;
+}
+
+pack_stats generate_poi(std::streambuf& out, const generate_options& generation, const pack_options& options) {
+  QThreadPool* pool = options.pool ? options.pool : QThreadPool::globalInstance();
+  const auto task_count = static_cast<size_t>(std::max(pool->maxThreadCount(), 1));
+  const uint64_t chunk_count = (generation.count + generate_chunk_size - 1) / generate_chunk_size;
+
+  pack_stats stats;
+  poi_sorter sorter{options, pool};
+  {
+    const city_model cities{generation};
+    std::vector<parsed_rows> generated(task_count);
+    for (uint64_t first_chunk = 0; first_chunk < chunk_count; first_chunk += task_count) {
+      const size_t chunks = static_cast<size_t>(std::min<uint64_t>(chunk_count - first_chunk, task_count));
+      std::vector<pc::future<void>> tasks;
+      tasks.reserve(chunks);
+      for (size_t task = 0; task < chunks; ++task) {
+        tasks.push_back(pc::async(pool, [&cities, &generation, chunk = first_chunk + task, &rows = generated[task],
+                                            curve = options.curve] {
+          with_curve(curve, [&](auto curve_policy) {
+            generate_rows<decltype(curve_policy)>(cities, generation, chunk, rows);
+          });
+        }));
+      }
+      // Every task must finish writing its rows before the first failure is rethrown
+      for (pc::future<void>& task : pc::when_all(tasks.begin(), tasks.end()).get())
+        task.get();
+      for (size_t task = 0; task < chunks; ++task)
+        sorter.add(generated[task], stats);
+    }
+  }
+  sorter.write(out, stats);
+  return stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+
+#include <QtCore/QString>
+
+#include <mapex/poi_file.hpp>
+
+class QThreadPool;
+
+/// Settings of the poi.bin packer.
+struct pack_options {
+  /// Approximate limit of the memory used for the input text and the keys. Keys which don't fit into it are sorted in
+  /// runs written to temporary files which are merged into the output afterwards.
+  size_t memory_budget = size_t{256} << 20;
+  key_curve curve = key_curve::morton;
+  /// Directory for the temporary run files. The system temporary directory is used if empty.
+  QString temp_dir;
+  /// Pool to parse the input and sort the runs on. The global pool is used if null.
+  QThreadPool* pool = nullptr;
+};
+
+struct pack_stats {
+  /// Number of the rows converted to keys.
+  uint64_t rows = 0;
+  /// Number of the rows which can't be parsed, e.g. the CSV header, or which lie outside of the projection.
+  uint64_t skipped = 0;
+  uint64_t advertized = 0;
+  uint64_t regular = 0;
+  /// Number of the sorted runs written to temporary files. Zero if all the keys fit into the memory budget.
+  size_t runs = 0;
+  /// Number of the intermediate passes merging the runs when there are too many of them to merge at once.
+  size_t merge_passes = 0;
+};
+
+/// Reads `lat,lon[,advertized]` CSV rows from `csv`, projects the points the same way the map widget does and writes
+/// their keys to `out` as poi.bin of the varint format. Advertized flag is either `1`/`true` or `0`/`false`, missing
+/// flag means a regular POI. Keys are sorted with the external merge sort keeping the memory usage within the
+/// `options.memory_budget`. Throws `std::system_error` if temporary files can't be written or read.
+pack_stats pack_poi(std::streambuf& csv, std::streambuf& out, const pack_options& options = {});
+
+/// Settings of the synthetic POI generator.
+struct generate_options {
+  uint64_t count = 1'000'000;
+  /// Same seed and settings give the same keys regardless of the number of threads and the memory budget.
+  uint64_t seed = 0;
+  /// City sizes follow Zipf's law: the n-th city gets 1/n of the points of the largest one.
+  size_t cities = 100;
+  /// Standard deviation of the point coordinates around the center of the largest city in the projected units.
+  /// Smaller cities are scaled down with the square root of their size.
+  double city_radius = 1. / 2048;
+  /// Share of the points spread uniformly over the whole world.
+  double noise_ratio = 0.1;
+  double advertized_ratio = 0.001;
+};
+
+/// Writes `generation.count` synthetic POI to `out` as poi.bin of the varint format. Points are normally distributed
+/// around city centers placed uniformly between the 66th parallels with a share of uniform background noise. Keys are
+/// sorted the same way `pack_poi` sorts them within the `options.memory_budget`.
+pack_stats generate_poi(std::streambuf& out, const generate_options& generation, const pack_options& options = {});
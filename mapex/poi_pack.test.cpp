@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QtCore/QThreadPool>
+#include <QtTest/QtTest>
+
+#include <mapex/poi_file.hpp>
+#include <mapex/poi_pack.hpp>
+#include <mapex/projection.hpp>
+
+Q_DECLARE_METATYPE(key_curve);
+
+namespace {
+
+uint64_t key_of(key_curve curve, geo_point pt) {
+  return with_curve(
+      curve, [pt](auto curve_policy) { return decltype(curve_policy)::code(pointf_to_point(project(pt))); });
+}
+
+// Input which fails after a few successful reads
+class failing_buf : public std::stringbuf {
+public:
+  failing_buf(std::string content, int reads) : std::stringbuf{std::move(content)}, reads_{reads} {}
+
+protected:
+  std::streamsize xsgetn(char* s, std::streamsize count) override {
+    if (reads_-- == 0)
+      throw std::ios_base::failure{"read csv"};
+    return std::stringbuf::xsgetn(s, count);
+  }
+
+private:
+  int reads_;
+};
+
+} // namespace
+
+class poi_pack_tests : public QObject {
+  Q_OBJECT
+private slots:
+  void packed_keys_are_read_back_data() {
+    QTest::addColumn<key_curve>("curve");
+    QTest::addColumn<size_t>("memory_budget");
+    QTest::addColumn<bool>("spills");
+    QTest::addColumn<bool>("merges_in_passes");
+
+    for (auto [name, curve] : {std::pair{"morton", key_curve::morton}, std::pair{"hilbert", key_curve::hilbert}}) {
+      QTest::addRow("%s/in_memory", name) << curve << (size_t{256} << 20) << false << false;
+      QTest::addRow("%s/external", name) << curve << (size_t{2} << 20) << true << false;
+      QTest::addRow("%s/multipass", name) << curve << (size_t{64} << 10) << true << true;
+    }
+  }
+  void packed_keys_are_read_back() {
+    QFETCH(key_curve, curve);
+    QFETCH(size_t, memory_budget);
+    QFETCH(bool, spills);
+    QFETCH(bool, merges_in_passes);
+
+    std::uniform_real_distribution<double> lat_dist{-85., 85.};
+    std::uniform_real_distribution<double> lon_dist{-180., 180.};
+    std::bernoulli_distribution adv_dist{0.05};
+    poi_keys expected{curve, {}, {}};
+    std::ostringstream csv;
+    csv << "lat,lon,advertized\n";
+    csv.precision(17);
+    for (size_t i = 0; i < 100'000; ++i) {
+      const double lat = lat_dist(rnd_engine_);
+      const double lon = lon_dist(rnd_engine_);
+      const bool advertized = adv_dist(rnd_engine_);
+      csv << lat << ',' << lon << ',' << (advertized ? 1 : 0) << '\n';
+      (advertized ? expected.advertized : expected.regular).push_back(key_of(curve, {longitude{lon}, lattitude{lat}}));
+    }
+    std::sort(expected.advertized.begin(), expected.advertized.end());
+    std::sort(expected.regular.begin(), expected.regular.end());
+
+    std::stringbuf in{csv.str()};
+    std::stringbuf out;
+    pack_options options;
+    options.memory_budget = memory_budget;
+    options.curve = curve;
+    const pack_stats stats = pack_poi(in, out, options);
+    QCOMPARE(stats.rows, uint64_t{100'000});
+    QCOMPARE(stats.skipped, uint64_t{1});
+    QCOMPARE(stats.advertized, expected.advertized.size());
+    QCOMPARE(stats.regular, expected.regular.size());
+    QCOMPARE(stats.runs != 0, spills);
+    QCOMPARE(stats.merge_passes != 0, merges_in_passes);
+
+    const poi_keys keys = read_poi(out);
+    QCOMPARE(keys.curve, curve);
+    QVERIFY(keys.advertized == expected.advertized);
+    QVERIFY(keys.regular == expected.regular);
+  }
+
+  void rows_without_poi_are_skipped() {
+    std::stringbuf in{"lat,lon\r\n"
+                      "54.98, 82.94\r\n"
+                      "\n"
+                      "not a number,82.94\n"
+                      "89.99,82.94\n"
+                      "54.98,82.94,maybe\n"
+                      "-33.86 , 151.2 , true \n"
+                      "55.75,37.61,false"};
+    std::stringbuf out;
+    const pack_stats stats = pack_poi(in, out);
+    QCOMPARE(stats.rows, uint64_t{3});
+    QCOMPARE(stats.skipped, uint64_t{4});
+
+    const poi_keys keys = read_poi(out);
+    const std::vector<uint64_t> advertized{key_of(key_curve::morton, {151.2_lon, lattitude{-33.86}})};
+    std::vector<uint64_t> regular{
+        key_of(key_curve::morton, {82.94_lon, 54.98_lat}), key_of(key_curve::morton, {37.61_lon, 55.75_lat})};
+    std::sort(regular.begin(), regular.end());
+    QVERIFY(keys.advertized == advertized);
+    QVERIFY(keys.regular == regular);
+  }
+
+  void read_failure_is_reported_after_parsing_tasks_finish() {
+    std::string csv = "lat,lon,advertized\n";
+    for (int i = 0; i < 100'000; ++i)
+      csv += "54.98,82.94,0\n";
+    failing_buf in{std::move(csv), 2};
+    std::stringbuf out;
+    pack_options options;
+    options.memory_budget = size_t{64} << 10;
+    QVERIFY_EXCEPTION_THROWN(pack_poi(in, out, options), std::ios_base::failure);
+  }
+
+  void generated_poi_are_deterministic_data() {
+    QTest::addColumn<size_t>("memory_budget");
+    QTest::addColumn<int>("threads");
+
+    QTest::addRow("in_memory/1") << (size_t{256} << 20) << 1;
+    QTest::addRow("in_memory/4") << (size_t{256} << 20) << 4;
+    QTest::addRow("external/3") << (size_t{1} << 20) << 3;
+  }
+  void generated_poi_are_deterministic() {
+    QFETCH(size_t, memory_budget);
+    QFETCH(int, threads);
+
+    generate_options generation;
+    generation.count = 300'000;
+    generation.seed = 42;
+    generation.advertized_ratio = 0.01;
+    std::stringbuf expected;
+    generate_poi(expected, generation);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    pack_options options;
+    options.memory_budget = memory_budget;
+    options.pool = &pool;
+    std::stringbuf out;
+    const pack_stats stats = generate_poi(out, generation, options);
+    QCOMPARE(stats.rows, generation.count);
+    QCOMPARE(stats.advertized + stats.regular, generation.count);
+    QVERIFY(out.str() == expected.str());
+
+    generation.seed = 43;
+    std::stringbuf other;
+    generate_poi(other, generation, options);
+    QVERIFY(other.str() != expected.str());
+  }
+
+  void generated_poi_follow_options() {
+    generate_options generation;
+    generation.count = 200'000;
+    generation.cities = 1;
+    generation.noise_ratio = 0;
+    generation.advertized_ratio = 0.1;
+    std::stringbuf out;
+    pack_options options;
+    options.curve = key_curve::hilbert;
+    const pack_stats stats = generate_poi(out, generation, options);
+
+    const poi_keys keys = read_poi(out);
+    QCOMPARE(keys.curve, key_curve::hilbert);
+    QCOMPARE(keys.advertized.size(), stats.advertized);
+    QCOMPARE(keys.regular.size(), stats.regular);
+    QVERIFY(std::is_sorted(keys.advertized.begin(), keys.advertized.end()));
+    QVERIFY(std::is_sorted(keys.regular.begin(), keys.regular.end()));
+    // Binomial deviation of the advertized count is about 134
+    QVERIFY(stats.advertized > 19'000 && stats.advertized < 21'000);
+
+    // All the points are around a single city center
+    point min{~uint32_t{0}, ~uint32_t{0}};
+    point max{0, 0};
+    for (const auto* layer : {&keys.advertized, &keys.regular}) {
+      for (uint64_t key : *layer) {
+        const point pt = hilbert::decode(key);
+        min = {std::min(min.x, pt.x), std::min(min.y, pt.y)};
+        max = {std::max(max.x, pt.x), std::max(max.y, pt.y)};
+      }
+    }
+    const double sigma = generation.city_radius * 0x1p32;
+    QVERIFY(max.x - min.x < 12 * sigma);
+    QVERIFY(max.y - min.y < 12 * sigma);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(poi_pack_tests)
+#include "poi_pack.test.moc"
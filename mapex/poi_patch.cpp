@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <system_error>
+
+#include <mapex/deltapack.hpp>
+#include <mapex/poi_file_layout.hpp>
+#include <mapex/poi_patch.hpp>
+
+namespace {
+
+// Header of poi.bin with the patch version
+constexpr uint8_t patch_version = 0x7f;
+
+std::system_error bad_patch() {
+  return std::system_error{std::make_error_code(std::errc::illegal_byte_sequence), "read poi patch"};
+}
+
+std::system_error mismatched_patch() {
+  return std::system_error{std::make_error_code(std::errc::invalid_argument), "apply poi patch"};
+}
+
+key_patch make_key_patch(const std::vector<uint64_t>& from, const std::vector<uint64_t>& to) {
+  key_patch res;
+  std::set_difference(from.begin(), from.end(), to.begin(), to.end(), std::back_inserter(res.deleted));
+  std::set_difference(to.begin(), to.end(), from.begin(), from.end(), std::back_inserter(res.inserted));
+  return res;
+}
+
+std::vector<uint64_t> apply_key_patch(const std::vector<uint64_t>& keys, const key_patch& patch) {
+  if (patch.deleted.size() > keys.size())
+    throw mismatched_patch();
+  std::vector<uint64_t> res;
+  res.reserve(keys.size() - patch.deleted.size() + patch.inserted.size());
+  auto del = patch.deleted.begin();
+  auto ins = patch.inserted.begin();
+  for (uint64_t key : keys) {
+    for (; ins != patch.inserted.end() && *ins < key; ++ins)
+      res.push_back(*ins);
+    if (del != patch.deleted.end() && *del <= key) {
+      // Deleted key is missing in the sequence
+      if (*del < key)
+        throw mismatched_patch();
+      ++del;
+      continue;
+    }
+    res.push_back(key);
+  }
+  if (del != patch.deleted.end())
+    throw mismatched_patch();
+  res.insert(res.end(), ins, patch.inserted.end());
+  return res;
+}
+
+const char* read_varint(const char* first, const char* last, uint64_t& val) {
+  return poi_file_layout::read_varint(first, last, val, bad_patch);
+}
+
+const char* read_keys(const char* first, const char* last, uint64_t count, std::vector<uint64_t>& keys) {
+  // Each key takes at least one byte so the count is checked before the allocation
+  if (count > static_cast<uint64_t>(last - first))
+    throw bad_patch();
+  keys.resize(count);
+  delta::decoder<const char*> decoder{first, last};
+  for (uint64_t& key : keys) {
+    const std::optional<uint64_t> val = decoder.next();
+    if (!val)
+      throw bad_patch();
+    key = *val;
+  }
+  // Overflowed sum of deltas
+  if (!std::is_sorted(keys.begin(), keys.end()))
+    throw bad_patch();
+  return decoder.position();
+}
+
+const char* read_key_patch(const char* first, const char* last, key_patch& patch) {
+  uint64_t deleted = 0;
+  uint64_t inserted = 0;
+  first = read_varint(first, last, deleted);
+  first = read_varint(first, last, inserted);
+  first = read_keys(first, last, deleted, patch.deleted);
+  return read_keys(first, last, inserted, patch.inserted);
+}
+
+void write_key_patch(std::ostreambuf_iterator<char> out, const key_patch& patch) {
+  const uint64_t counts[] = {patch.deleted.size(), patch.inserted.size()};
+  varint::pack(std::begin(counts), std::end(counts), out);
+  delta::pack(patch.deleted.begin(), patch.deleted.end(), out);
+  delta::pack(patch.inserted.begin(), patch.inserted.end(), out);
+}
+
+} // namespace
+
+poi_patch make_poi_patch(const poi_keys& from, const poi_keys& to) {
+  return {to.curve, make_key_patch(from.advertized, to.advertized), make_key_patch(from.regular, to.regular)};
+}
+
+void apply_poi_patch(poi_keys& keys, const poi_patch& patch) {
+  if (keys.curve != patch.curve)
+    throw mismatched_patch();
+  std::vector<uint64_t> advertized = apply_key_patch(keys.advertized, patch.advertized);
+  keys.regular = apply_key_patch(keys.regular, patch.regular);
+  keys.advertized = std::move(advertized);
+}
+
+bool is_poi_patch(const char* first, const char* last) noexcept {
+  return poi_file_layout::has_magic(first, last) && static_cast<uint8_t>(first[2]) == patch_version;
+}
+
+poi_patch read_poi_patch(const char* first, const char* last) {
+  if (!is_poi_patch(first, last))
+    throw bad_patch();
+  const auto curve = static_cast<uint8_t>(first[3]);
+  if (curve != static_cast<uint8_t>(key_curve::morton) && curve != static_cast<uint8_t>(key_curve::hilbert))
+    throw bad_patch();
+  poi_patch res;
+  res.curve = static_cast<key_curve>(curve);
+  first = read_key_patch(first + poi_file_layout::header_size, last, res.advertized);
+  first = read_key_patch(first, last, res.regular);
+  if (first != last)
+    throw bad_patch();
+  return res;
+}
+
+void write_poi_patch(std::streambuf& out, const poi_patch& patch) {
+  std::ostreambuf_iterator<char> it{&out};
+  for (unsigned char bt : poi_file_layout::magic)
+    *it++ = static_cast<char>(bt);
+  *it++ = static_cast<char>(patch_version);
+  *it++ = static_cast<char>(patch.curve);
+  write_key_patch(it, patch.advertized);
+  write_key_patch(it, patch.regular);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+#include <mapex/poi_file.hpp>
+
+/// Sorted keys removed from and added to a sorted sequence of POI keys. Equal keys are counted, every deleted key
+/// removes a single occurrence.
+struct key_patch {
+  std::vector<uint64_t> deleted;
+  std::vector<uint64_t> inserted;
+};
+
+/// Difference between two versions of poi.bin content built with the same curve.
+struct poi_patch {
+  key_curve curve = key_curve::morton;
+  key_patch advertized;
+  key_patch regular;
+};
+
+/// Builds the patch which turns `from` keys into `to` keys. Both must be built with the same curve.
+poi_patch make_poi_patch(const poi_keys& from, const poi_keys& to);
+
+/// Merges the patch into sorted keys in a single linear pass. Throws `std::system_error` if the keys use another curve
+/// or don't contain some of the deleted keys, i.e. the patch is made for another version of the file.
+void apply_poi_patch(poi_keys& keys, const poi_patch& patch);
+
+/// Checks if the `[first, last)` memory region starts with a patch rather than with poi.bin content.
+bool is_poi_patch(const char* first, const char* last) noexcept;
+/// Reads the patch from the `[first, last)` memory region. Throws `std::system_error` if the patch is malformed.
+poi_patch read_poi_patch(const char* first, const char* last);
+/// Writes the patch with delta packed keys. Patch starts with the poi.bin magic followed by a version never used by
+/// poi.bin so that it is never mistaken for the file content.
+void write_poi_patch(std::streambuf& out, const poi_patch& patch);
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/poi_patch.hpp>
+
+class poi_patch_tests : public QObject {
+  Q_OBJECT
+private:
+  std::vector<uint64_t> gen_keys(size_t count) {
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  // Drops every `step`-th key and adds `added` new ones
+  std::vector<uint64_t> modified(const std::vector<uint64_t>& keys, size_t step, size_t added) {
+    std::vector<uint64_t> res;
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+      if (idx % step != 0)
+        res.push_back(keys[idx]);
+    }
+    const std::vector<uint64_t> new_keys = gen_keys(added);
+    res.insert(res.end(), new_keys.begin(), new_keys.end());
+    std::inplace_merge(res.begin(), res.end() - new_keys.size(), res.end());
+    return res;
+  }
+
+  std::string patch_content(const poi_patch& patch) {
+    std::stringbuf buf;
+    write_poi_patch(buf, patch);
+    return buf.str();
+  }
+
+private slots:
+  void applied_patch_gives_new_keys() {
+    const poi_keys from{key_curve::hilbert, gen_keys(100), gen_keys(100000)};
+    const poi_keys to{key_curve::hilbert, modified(from.advertized, 10, 5), modified(from.regular, 1000, 50)};
+    const poi_patch patch = make_poi_patch(from, to);
+    QCOMPARE(patch.advertized.deleted.size(), size_t{10});
+    QCOMPARE(patch.advertized.inserted.size(), size_t{5});
+    QCOMPARE(patch.regular.deleted.size(), size_t{100});
+    QCOMPARE(patch.regular.inserted.size(), size_t{50});
+
+    const std::string content = patch_content(patch);
+    QVERIFY(is_poi_patch(content.data(), content.data() + content.size()));
+    poi_keys keys = from;
+    apply_poi_patch(keys, read_poi_patch(content.data(), content.data() + content.size()));
+    QCOMPARE(keys.curve, to.curve);
+    QVERIFY(keys.advertized == to.advertized);
+    QVERIFY(keys.regular == to.regular);
+  }
+
+  void duplicate_keys_are_counted() {
+    const poi_keys from{key_curve::morton, {}, {1, 2, 2, 2, 5}};
+    const poi_keys to{key_curve::morton, {}, {0, 2, 5, 5, 7}};
+    const poi_patch patch = make_poi_patch(from, to);
+    QVERIFY((patch.regular.deleted == std::vector<uint64_t>{1, 2, 2}));
+    QVERIFY((patch.regular.inserted == std::vector<uint64_t>{0, 5, 7}));
+
+    poi_keys keys = from;
+    apply_poi_patch(keys, patch);
+    QVERIFY(keys.regular == to.regular);
+  }
+
+  void patch_for_other_keys_is_rejected() {
+    const poi_keys from{key_curve::morton, gen_keys(10), gen_keys(1000)};
+    const poi_keys to{key_curve::morton, from.advertized, modified(from.regular, 100, 10)};
+    const poi_patch patch = make_poi_patch(from, to);
+
+    poi_keys other{key_curve::morton, from.advertized, gen_keys(1000)};
+    QVERIFY_EXCEPTION_THROWN(apply_poi_patch(other, patch), std::system_error);
+    poi_keys other_curve{key_curve::hilbert, from.advertized, from.regular};
+    QVERIFY_EXCEPTION_THROWN(apply_poi_patch(other_curve, patch), std::system_error);
+  }
+
+  void malformed_patch_is_rejected() {
+    const poi_keys from{key_curve::morton, gen_keys(10), gen_keys(1000)};
+    const std::string content =
+        patch_content(make_poi_patch(from, {key_curve::morton, from.advertized, modified(from.regular, 100, 10)}));
+    QVERIFY_EXCEPTION_THROWN(read_poi_patch(content.data(), content.data() + content.size() - 1), std::system_error);
+    std::string garbage = content;
+    garbage[2] = static_cast<char>(poi_format::varint);
+    QVERIFY(!is_poi_patch(garbage.data(), garbage.data() + garbage.size()));
+    QVERIFY_EXCEPTION_THROWN(read_poi_patch(garbage.data(), garbage.data() + garbage.size()), std::system_error);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(poi_patch_tests)
+#include "poi_patch.test.moc"
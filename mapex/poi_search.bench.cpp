@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/poi_search.hpp>
+#include <mapex/search_index.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 10'000'000;
+// Points are spread over a square with the side of 2^24 world units around the world center which is close to a
+// size of a big city.
+constexpr uint32_t area_side_log2 = 24;
+constexpr uint32_t area_min = (uint32_t{1} << 31) - (uint32_t{1} << (area_side_log2 - 1));
+
+enum class search_path { sorted, indexed, blocks };
+
+} // namespace
+
+Q_DECLARE_METATYPE(search_path);
+
+class poi_search_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  void search_paths() {
+    QTest::addColumn<search_path>("path");
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<uint64_t>("min");
+    QTest::addColumn<uint64_t>("max");
+    QTest::addColumn<size_t>("k");
+
+    const std::pair<const char*, search_path> paths[] = {
+        {"sorted", search_path::sorted}, {"indexed", search_path::indexed}, {"blocks", search_path::blocks}};
+    // Area under a finger tap and a full HD viewport
+    const std::pair<const char*, point> shapes[] = {{"tap", {64, 64}}, {"viewport", {1920, 1080}}};
+    for (const auto& [path_name, path] : paths) {
+      for (const auto& [shape_name, size_px] : shapes) {
+        for (int z_level : {10, 14, 16}) {
+          const uint32_t px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+          const point size{size_px.x << px_log2, size_px.y << px_log2};
+          const point center{uint32_t{1} << 31, uint32_t{1} << 31};
+          const point min{center.x - size.x / 2, center.y - size.y / 2};
+          const point max{center.x + size.x / 2, center.y + size.y / 2};
+          for (size_t k : {1, 10, 100}) {
+            QTest::addRow("%s/%s/z%d/k%d", path_name, shape_name, z_level, static_cast<int>(k))
+                << path << z_level << morton::code(min) << morton::code(max) << k;
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<uint64_t> run_rect(search_path path, uint64_t min, uint64_t max, scan_stats* stats) {
+    switch (path) {
+    case search_path::sorted:
+      return query_rect(points_, min, max, stats);
+    case search_path::indexed:
+      return query_rect({points_, &index_}, min, max, stats);
+    case search_path::blocks:
+      return query_rect(blocks_, min, max, default_block_ranges, stats);
+    }
+    return {};
+  }
+
+  // Nearest points to the rect center
+  std::vector<uint64_t> run_nearest(search_path path, uint64_t min, uint64_t max, size_t k, scan_stats* stats) {
+    const point min_pt = morton::decode(min);
+    const point max_pt = morton::decode(max);
+    const point center{min_pt.x + (max_pt.x - min_pt.x) / 2, min_pt.y + (max_pt.y - min_pt.y) / 2};
+    switch (path) {
+    case search_path::sorted:
+      return nearest(points_, center, k, stats);
+    case search_path::indexed:
+      return nearest({points_, &index_}, center, k, stats);
+    case search_path::blocks:
+      return nearest(blocks_, center, k, stats);
+    }
+    return {};
+  }
+
+private slots:
+  void initTestCase() {
+    std::default_random_engine rnd_engine;
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + ((uint32_t{1} << area_side_log2) - 1)};
+    points_.resize(sample_size);
+    std::generate(points_.begin(), points_.end(), [&] { return morton::code({dist(rnd_engine), dist(rnd_engine)}); });
+    std::sort(points_.begin(), points_.end());
+    index_ = search_index{points_};
+    blocks_ = key_blocks{points_};
+  }
+
+  // Rect queries do not depend on `k`, it is only used by the nearest point queries
+  void rect_query_time_data() { search_paths(); }
+  void rect_query_time() {
+    QFETCH(search_path, path);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (k != 1)
+      QSKIP("Rect query does not depend on k");
+    QBENCHMARK { run_rect(path, min, max, nullptr); }
+  }
+
+  void rect_keys_scanned_data() { search_paths(); }
+  void rect_keys_scanned() {
+    QFETCH(search_path, path);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (k != 1)
+      QSKIP("Rect query does not depend on k");
+    scan_stats stats;
+    run_rect(path, min, max, &stats);
+    QTest::setBenchmarkResult(stats.keys_scanned, QTest::Events);
+  }
+
+  void rect_bigmin_jumps_data() { search_paths(); }
+  void rect_bigmin_jumps() {
+    QFETCH(search_path, path);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (k != 1)
+      QSKIP("Rect query does not depend on k");
+    scan_stats stats;
+    run_rect(path, min, max, &stats);
+    QTest::setBenchmarkResult(stats.bigmin_jumps, QTest::Events);
+  }
+
+  // Nearest queries do not depend on the rect size, only its center is used
+  void nearest_time_data() { search_paths(); }
+  void nearest_time() {
+    QFETCH(search_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (z_level != max_z_level)
+      QSKIP("Nearest query does not depend on the rect size");
+    QBENCHMARK { run_nearest(path, min, max, k, nullptr); }
+  }
+
+  void nearest_keys_scanned_data() { search_paths(); }
+  void nearest_keys_scanned() {
+    QFETCH(search_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (z_level != max_z_level)
+      QSKIP("Nearest query does not depend on the rect size");
+    scan_stats stats;
+    run_nearest(path, min, max, k, &stats);
+    QTest::setBenchmarkResult(stats.keys_scanned, QTest::Events);
+  }
+
+  void nearest_bigmin_jumps_data() { search_paths(); }
+  void nearest_bigmin_jumps() {
+    QFETCH(search_path, path);
+    QFETCH(int, z_level);
+    QFETCH(uint64_t, min);
+    QFETCH(uint64_t, max);
+    QFETCH(size_t, k);
+    if (z_level != max_z_level)
+      QSKIP("Nearest query does not depend on the rect size");
+    scan_stats stats;
+    run_nearest(path, min, max, k, &stats);
+    QTest::setBenchmarkResult(stats.bigmin_jumps, QTest::Events);
+  }
+
+private:
+  std::vector<uint64_t> points_;
+  search_index index_;
+  key_blocks blocks_;
+};
+
+QTEST_MAIN(poi_search_benchmarks)
+#include "poi_search.bench.moc"
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_search.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/poi_search.hpp>
+
+namespace {
+
+template <typename Curve, typename Codec, typename Key>
+void append_rect(Codec codec, const basic_sorted_keys<Key>& points, Key vp_min, Key vp_max, std::vector<Key>& res,
+    scan_stats& stats) {
+  const point rect_min = codec.decode(vp_min);
+  const point rect_max = codec.decode(vp_max);
+  auto first = search(points, points.keys.begin(), points.keys.end(), Curve::rect_first(vp_min, vp_max));
+  const auto last = search_after(points, first, points.keys.end(), Curve::rect_last(vp_min, vp_max));
+  stats.searches += 2;
+  bool in_run = false;
+  while (first != last) {
+    ++stats.keys_scanned;
+    if (!is_in_rect(codec.decode(*first), rect_min, rect_max)) {
+      ++stats.bigmin_jumps;
+      ++stats.searches;
+      first = search(points, first, last, Curve::bigmin(*first, vp_min, vp_max));
+      in_run = false;
+      continue;
+    }
+    stats.runs += in_run ? 0 : 1;
+    in_run = true;
+    res.push_back(*first++);
+  }
+}
+
+template <typename Curve, typename Codec>
+void append_rect(Codec codec, const key_blocks& blocks, uint64_t vp_min, uint64_t vp_max, size_t max_ranges,
+    std::vector<uint64_t>& res, scan_stats& stats) {
+  const point rect_min = codec.decode(vp_min);
+  const point rect_max = codec.decode(vp_max);
+  key_blocks::decoder decoder{blocks};
+  std::optional<uint64_t> key;
+  for (const morton::z_range& range : Curve::decompose(vp_min, vp_max, max_ranges)) {
+    if (!key || *key < range.min) {
+      key = decoder.skip_to(range.min);
+      ++stats.searches;
+    }
+    bool in_run = false;
+    while (key && *key <= range.max) {
+      ++stats.keys_scanned;
+      if (!range.exact && !is_in_rect(codec.decode(*key), rect_min, rect_max)) {
+        ++stats.bigmin_jumps;
+        ++stats.searches;
+        key = decoder.skip_to(Curve::bigmin(*key, vp_min, vp_max));
+        in_run = false;
+        continue;
+      }
+      stats.runs += in_run ? 0 : 1;
+      in_run = true;
+      res.push_back(*key);
+      key = decoder.next();
+    }
+  }
+  stats.blocks_decoded += decoder.blocks_decoded();
+}
+
+point clamped_point(int64_t x, int64_t y) noexcept {
+  constexpr int64_t world_max = (int64_t{1} << world_coord_range_log2) - 1;
+  return {static_cast<uint32_t>(std::clamp<int64_t>(x, 0, world_max)),
+      static_cast<uint32_t>(std::clamp<int64_t>(y, 0, world_max))};
+}
+
+// `append` collects keys of the rect with the corners passed as points
+template <typename Curve, typename Codec, typename F>
+std::vector<key_type_of<Curve>> nearest_keys(Codec codec, point pt, size_t k, F&& append) {
+  using key_type = key_type_of<Curve>;
+  std::vector<key_type> res;
+  if (k == 0)
+    return res;
+  constexpr int64_t world_size = int64_t{1} << world_coord_range_log2;
+  std::vector<std::pair<double, key_type>> candidates;
+  for (int64_t radius = nearest_initial_radius;;) {
+    const point min = clamped_point(int64_t{pt.x} - radius, int64_t{pt.y} - radius);
+    const point max = clamped_point(int64_t{pt.x} + radius, int64_t{pt.y} + radius);
+    res.clear();
+    append(min, max, res);
+    const bool whole_world = radius >= world_size;
+    if (res.size() < k && !whole_world) {
+      radius *= 2;
+      continue;
+    }
+
+    candidates.clear();
+    for (key_type key : res)
+      candidates.emplace_back(squared_distance(codec.decode(key), pt), key);
+    const size_t count = std::min(k, candidates.size());
+    if (count == 0)
+      return res;
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+    // Keys out of the square may be closer than the k-th key unless it lies in the circle inscribed into the square
+    const double kth_distance = std::sqrt(candidates[count - 1].first);
+    if (whole_world || kth_distance <= radius) {
+      res.resize(count);
+      std::transform(candidates.begin(), candidates.begin() + count, res.begin(),
+          [](const std::pair<double, key_type>& candidate) { return candidate.second; });
+      return res;
+    }
+    radius = std::min(static_cast<int64_t>(std::ceil(kth_distance)), world_size);
+  }
+}
+
+} // namespace
+
+template <typename Curve>
+std::vector<key_type_of<Curve>> query_rect(const basic_sorted_keys<key_type_of<Curve>>& points,
+    key_type_of<Curve> vp_min, key_type_of<Curve> vp_max, scan_stats* stats) {
+  scan_stats local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    std::vector<key_type_of<Curve>> res;
+    append_rect<Curve>(codec, points, vp_min, vp_max, res, stats ? *stats : local_stats);
+    return res;
+  });
+}
+
+template <typename Curve>
+std::vector<uint64_t> query_rect(
+    const key_blocks& blocks, uint64_t vp_min, uint64_t vp_max, size_t max_ranges, scan_stats* stats) {
+  scan_stats local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    std::vector<uint64_t> res;
+    append_rect<Curve>(codec, blocks, vp_min, vp_max, max_ranges, res, stats ? *stats : local_stats);
+    return res;
+  });
+}
+
+template <typename Curve>
+std::vector<key_type_of<Curve>> nearest(
+    const basic_sorted_keys<key_type_of<Curve>>& points, point pt, size_t k, scan_stats* stats) {
+  scan_stats local_stats;
+  scan_stats& res_stats = stats ? *stats : local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    return nearest_keys<Curve>(codec, pt, k, [&](point min, point max, std::vector<key_type_of<Curve>>& res) {
+      append_rect<Curve>(codec, points, Curve::code(min), Curve::code(max), res, res_stats);
+    });
+  });
+}
+
+template <typename Curve>
+std::vector<uint64_t> nearest(const key_blocks& blocks, point pt, size_t k, scan_stats* stats) {
+  scan_stats local_stats;
+  scan_stats& res_stats = stats ? *stats : local_stats;
+  return Curve::with_fast_codec([&](auto codec) {
+    return nearest_keys<Curve>(codec, pt, k, [&](point min, point max, std::vector<uint64_t>& res) {
+      append_rect<Curve>(codec, blocks, Curve::code(min), Curve::code(max), default_block_ranges, res, res_stats);
+    });
+  });
+}
+
+template std::vector<uint64_t> query_rect<morton::curve>(const sorted_keys&, uint64_t, uint64_t, scan_stats*);
+template std::vector<uint64_t> query_rect<morton::curve>(const key_blocks&, uint64_t, uint64_t, size_t, scan_stats*);
+template std::vector<uint64_t> nearest<morton::curve>(const sorted_keys&, point, size_t, scan_stats*);
+template std::vector<uint64_t> nearest<morton::curve>(const key_blocks&, point, size_t, scan_stats*);
+
+template std::vector<uint64_t> query_rect<hilbert::curve>(const sorted_keys&, uint64_t, uint64_t, scan_stats*);
+template std::vector<uint64_t> query_rect<hilbert::curve>(const key_blocks&, uint64_t, uint64_t, size_t, scan_stats*);
+template std::vector<uint64_t> nearest<hilbert::curve>(const sorted_keys&, point, size_t, scan_stats*);
+template std::vector<uint64_t> nearest<hilbert::curve>(const key_blocks&, point, size_t, scan_stats*);
+
+template std::vector<uint32_t> query_rect<morton::quantized_curve>(
+    const basic_sorted_keys<uint32_t>&, uint32_t, uint32_t, scan_stats*);
+template std::vector<uint32_t> nearest<morton::quantized_curve>(
+    const basic_sorted_keys<uint32_t>&, point, size_t, scan_stats*);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mapex/generalization.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/search_index.hpp>
+
+/// Half side of the first square searched by `nearest`, a pixel of the most detailed z-level.
+constexpr uint32_t nearest_initial_radius = uint32_t{1}
+                                           << (world_coord_range_log2 - tile_pixel_size_log2 - max_z_level);
+
+// Search functions are instantiated for `morton::curve` and `hilbert::curve` policies. Keys passed to them must be
+// built with the same curve. Rect corners `vp_min` and `vp_max` are the keys of the top left and the bottom right
+// corners of the rect. Plain sorted keys overloads are also instantiated for `morton::quantized_curve`.
+
+/// Sorted keys of `points` lying in the rect with corners `vp_min` and `vp_max`. Out of rect runs are skipped with
+/// bigmin, long distance searches use the index of `points` if it is provided.
+template <typename Curve = morton::curve>
+std::vector<key_type_of<Curve>> query_rect(const basic_sorted_keys<key_type_of<Curve>>& points,
+    key_type_of<Curve> vp_min, key_type_of<Curve> vp_max, scan_stats* stats = nullptr);
+
+/// Same as above over the keys kept compressed in `blocks`. The rect is split into at most `max_ranges` key intervals
+/// and only the blocks overlapping them are decoded.
+template <typename Curve = morton::curve>
+std::vector<uint64_t> query_rect(const key_blocks& blocks, uint64_t vp_min, uint64_t vp_max,
+    size_t max_ranges = default_block_ranges, scan_stats* stats = nullptr);
+
+/// Up to `k` keys of `points` nearest to `pt` sorted by the distance. Squares around `pt` are queried with a doubling
+/// side until they contain `k` keys and then once more with the half side equal to the distance to the k-th of them
+/// which is guaranteed to contain all the closer keys.
+template <typename Curve = morton::curve>
+std::vector<key_type_of<Curve>> nearest(
+    const basic_sorted_keys<key_type_of<Curve>>& points, point pt, size_t k, scan_stats* stats = nullptr);
+
+/// Same as above over the keys kept compressed in `blocks`.
+template <typename Curve = morton::curve>
+std::vector<uint64_t> nearest(const key_blocks& blocks, point pt, size_t k, scan_stats* stats = nullptr);
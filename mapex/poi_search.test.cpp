@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/poi_search.hpp>
+#include <mapex/search_index.hpp>
+#include <mapex/test_helpers.hpp>
+
+namespace {
+
+double distance(point l, point r) noexcept {
+  return std::hypot(static_cast<double>(l.x) - r.x, static_cast<double>(l.y) - r.y);
+}
+
+std::vector<point> decoded(const std::vector<uint64_t>& keys, point (*decode)(uint64_t)) {
+  std::vector<point> res(keys.size());
+  std::transform(keys.begin(), keys.end(), res.begin(), decode);
+  return res;
+}
+
+} // namespace
+
+class poi_search_tests : public QObject {
+  Q_OBJECT
+private:
+  void random_points() {
+    QTest::addColumn<int>("seed");
+    for (int seed = 0; seed < 50; ++seed)
+      QTest::addRow("%d", seed) << seed;
+  }
+
+  // Points are taken from the area around the world center so that some queries reach the area border
+  point random_point(std::default_random_engine& rnd_engine) {
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + area_side - 1};
+    return {dist(rnd_engine), dist(rnd_engine)};
+  }
+
+  std::vector<point> brute_force_rect(point min, point max) const {
+    std::vector<point> res;
+    std::copy_if(points_.begin(), points_.end(), std::back_inserter(res), [&](point pt) {
+      return is_in_rect(pt, min, max);
+    });
+    return res;
+  }
+
+  // Distances to the k nearest points. Points at the same distance can be reported in any order.
+  std::vector<double> brute_force_distances(point pt, size_t k) const {
+    std::vector<double> res(points_.size());
+    std::transform(points_.begin(), points_.end(), res.begin(), [&](point item) { return distance(item, pt); });
+    std::sort(res.begin(), res.end());
+    res.resize(std::min(k, res.size()));
+    return res;
+  }
+
+  std::vector<double> distances(const std::vector<point>& points, point pt) const {
+    std::vector<double> res(points.size());
+    std::transform(points.begin(), points.end(), res.begin(), [&](point item) { return distance(item, pt); });
+    return res;
+  }
+
+private slots:
+  void initTestCase() {
+    std::default_random_engine rnd_engine;
+    points_.resize(0x1'0000);
+    std::generate(points_.begin(), points_.end(), [&] { return random_point(rnd_engine); });
+    for (point pt : points_) {
+      morton_keys_.push_back(morton::code(pt));
+      hilbert_keys_.push_back(hilbert::code(pt));
+    }
+    std::sort(morton_keys_.begin(), morton_keys_.end());
+    std::sort(hilbert_keys_.begin(), hilbert_keys_.end());
+    morton_index_ = search_index{morton_keys_};
+    morton_blocks_ = key_blocks{morton_keys_};
+    hilbert_blocks_ = key_blocks{hilbert_keys_};
+
+    quantized_keys_.resize(morton_keys_.size());
+    std::transform(morton_keys_.begin(), morton_keys_.end(), quantized_keys_.begin(), morton::quantize);
+    quantized_index_ = basic_search_index<uint32_t>{quantized_keys_};
+  }
+
+  void rect_query_finds_all_rect_points_data() { random_points(); }
+  void rect_query_finds_all_rect_points() {
+    QFETCH(int, seed);
+    std::default_random_engine rnd_engine(seed);
+    point min = random_point(rnd_engine);
+    point max = random_point(rnd_engine);
+    if (min.x > max.x)
+      std::swap(min.x, max.x);
+    if (min.y > max.y)
+      std::swap(min.y, max.y);
+    const auto expected = sorted(brute_force_rect(min, max));
+    const uint64_t mmin = morton::code(min);
+    const uint64_t mmax = morton::code(max);
+    const uint64_t hmin = hilbert::code(min);
+    const uint64_t hmax = hilbert::code(max);
+
+    const auto keys = query_rect(morton_keys_, mmin, mmax);
+    QVERIFY(std::is_sorted(keys.begin(), keys.end()));
+    QVERIFY(sorted(decoded(keys, morton::decode)) == expected);
+    QVERIFY(query_rect({morton_keys_, &morton_index_}, mmin, mmax) == keys);
+    QVERIFY(query_rect(morton_blocks_, mmin, mmax) == keys);
+    QVERIFY(sorted(decoded(query_rect<hilbert::curve>(hilbert_keys_, hmin, hmax), hilbert::decode)) == expected);
+    QVERIFY(sorted(decoded(query_rect<hilbert::curve>(hilbert_blocks_, hmin, hmax), hilbert::decode)) == expected);
+  }
+
+  void nearest_finds_closest_points_data() {
+    QTest::addColumn<int>("seed");
+    QTest::addColumn<size_t>("k");
+    for (int seed = 0; seed < 20; ++seed) {
+      for (size_t k : {1, 10, 100})
+        QTest::addRow("%d/%d", seed, static_cast<int>(k)) << seed << k;
+    }
+  }
+  void nearest_finds_closest_points() {
+    QFETCH(int, seed);
+    QFETCH(size_t, k);
+    std::default_random_engine rnd_engine(seed);
+    // Some points are out of the area with POI
+    std::uniform_int_distribution<uint32_t> dist{area_min - area_side, area_min + 2 * area_side};
+    const point pt{dist(rnd_engine), dist(rnd_engine)};
+    const auto expected = brute_force_distances(pt, k);
+
+    const auto keys = nearest(morton_keys_, pt, k);
+    QVERIFY(distances(decoded(keys, morton::decode), pt) == expected);
+    QVERIFY(distances(decoded(nearest({morton_keys_, &morton_index_}, pt, k), morton::decode), pt) == expected);
+    QVERIFY(distances(decoded(nearest(morton_blocks_, pt, k), morton::decode), pt) == expected);
+    QVERIFY(distances(decoded(nearest<hilbert::curve>(hilbert_keys_, pt, k), hilbert::decode), pt) == expected);
+    QVERIFY(distances(decoded(nearest<hilbert::curve>(hilbert_blocks_, pt, k), hilbert::decode), pt) == expected);
+  }
+
+  // Quantized keys find the same points as the full ones would find after snapping them to the centers of their squares
+  void quantized_queries_find_snapped_points_data() { random_points(); }
+  void quantized_queries_find_snapped_points() {
+    QFETCH(int, seed);
+    using curve = morton::quantized_curve;
+    std::default_random_engine rnd_engine(seed);
+    point min = random_point(rnd_engine);
+    point max = random_point(rnd_engine);
+    if (min.x > max.x)
+      std::swap(min.x, max.x);
+    if (min.y > max.y)
+      std::swap(min.y, max.y);
+    std::vector<point> snapped(quantized_keys_.size());
+    curve::decode_n(quantized_keys_.data(), quantized_keys_.size(), snapped.data());
+    const basic_sorted_keys<uint32_t> indexed{quantized_keys_, &quantized_index_};
+
+    const uint32_t qmin = curve::code(min);
+    const uint32_t qmax = curve::code(max);
+    std::vector<point> expected;
+    std::copy_if(snapped.begin(), snapped.end(), std::back_inserter(expected),
+        [&](point pt) { return is_in_rect(pt, curve::decode(qmin), curve::decode(qmax)); });
+    const auto keys = query_rect<curve>(indexed, qmin, qmax);
+    QVERIFY(std::is_sorted(keys.begin(), keys.end()));
+    QVERIFY(query_rect<curve>(quantized_keys_, qmin, qmax) == keys);
+    std::vector<point> found(keys.size());
+    curve::decode_n(keys.data(), keys.size(), found.data());
+    QVERIFY(sorted(found) == sorted(expected));
+
+    const size_t k = 10;
+    std::vector<double> expected_distances = distances(snapped, min);
+    std::sort(expected_distances.begin(), expected_distances.end());
+    expected_distances.resize(k);
+    const auto nearest_keys = nearest<curve>(indexed, min, k);
+    std::vector<point> nearest_points(nearest_keys.size());
+    curve::decode_n(nearest_keys.data(), nearest_keys.size(), nearest_points.data());
+    QVERIFY(distances(nearest_points, min) == expected_distances);
+  }
+
+  void nearest_reports_all_points_if_there_are_less_than_k() {
+    const std::vector<uint64_t> keys{morton::code({0, 0}), morton::code({~uint32_t{0}, ~uint32_t{0}})};
+    QCOMPARE(nearest(keys, {uint32_t{1} << 31, uint32_t{1} << 31}, 10).size(), size_t{2});
+    QVERIFY(nearest(std::vector<uint64_t>{}, {0, 0}, 10).empty());
+    QVERIFY(nearest(keys, {0, 0}, 0).empty());
+  }
+
+private:
+  static constexpr uint32_t area_side = uint32_t{1} << 24;
+  static constexpr uint32_t area_min = (uint32_t{1} << 31) - area_side / 2;
+
+  std::vector<point> points_;
+  std::vector<uint64_t> morton_keys_;
+  std::vector<uint64_t> hilbert_keys_;
+  search_index morton_index_;
+  key_blocks morton_blocks_;
+  key_blocks hilbert_blocks_;
+  std::vector<uint32_t> quantized_keys_;
+  basic_search_index<uint32_t> quantized_index_;
+};
+
+QTEST_MAIN(poi_search_tests)
+#include "poi_search.test.moc"
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <QtCore/QRectF>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThreadPool>
+#include <QtTest/QtTest>
+
+#include <portable_concurrency/future>
+
+#include <mapex/allocation_count.hpp>
+#include <mapex/generalization.hpp>
+#include <mapex/morton_code.hpp>
+#include <mapex/poi_file.hpp>
+#include <mapex/poidb.hpp>
+#include <mapex/projection.hpp>
+
+namespace {
+
+constexpr size_t sample_size = 0x40'0000;
+// Dataset of the thread scaling benchmark is generated on the first use
+constexpr size_t large_sample_size = 50'000'000;
+constexpr size_t advertized_per_regular = 1000;
+constexpr uint32_t area_side_log2 = 24;
+constexpr uint32_t area_min = (uint32_t{1} << 31) - (uint32_t{1} << (area_side_log2 - 1));
+
+// Full HD viewport panned diagonally at 60 frames per second
+constexpr point vp_size{1920, 1080};
+constexpr int pan_frames = 120;
+constexpr int frame_interval_ms = 16;
+
+struct pan_result {
+  generalization_work work;
+  double seconds = 0;
+};
+
+point clamped_point(int64_t x, int64_t y) noexcept {
+  constexpr int64_t world_max = (int64_t{1} << world_coord_range_log2) - 1;
+  return {static_cast<uint32_t>(std::clamp<int64_t>(x, 0, world_max)),
+      static_cast<uint32_t>(std::clamp<int64_t>(y, 0, world_max))};
+}
+
+// Corners of the viewport centered at `x`, `y` scaled by `scale`
+std::pair<point, point> viewport_rect(int64_t x, int64_t y, int z_level, int64_t scale) noexcept {
+  const unsigned px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+  const int64_t half_w = scale * (int64_t{vp_size.x} << px_log2) / 2;
+  const int64_t half_h = scale * (int64_t{vp_size.y} << px_log2) / 2;
+  return {clamped_point(x - half_w, y - half_h), clamped_point(x + half_w, y + half_h)};
+}
+
+} // namespace
+
+Q_DECLARE_METATYPE(poi_index);
+
+class poidb_benchmarks : public QObject {
+  Q_OBJECT
+private:
+  void pan_scripts() {
+    QTest::addColumn<poi_index>("index");
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<int>("pan_speed");
+
+    const std::pair<const char*, poi_index> indexes[] = {{"pyramid", poi_index::pyramid},
+        {"prefix_sums", poi_index::prefix_sums}, {"blocks", poi_index::blocks}, {"quantized", poi_index::quantized}};
+    for (const auto& [index_name, index] : indexes) {
+      for (int z_level : {10, 14}) {
+        // Pixels per frame of a slow drag, a fling and a fling faster than the queries complete
+        for (int pan_speed : {16, 128, 1024})
+          QTest::addRow("%s/z%d/%dpx", index_name, z_level, pan_speed) << index << z_level << pan_speed;
+      }
+    }
+  }
+
+  void write_poi_file(const QString& path, size_t count) {
+    std::uniform_int_distribution<uint32_t> dist{area_min, area_min + ((uint32_t{1} << area_side_log2) - 1)};
+    auto gen_keys = [&](size_t size) {
+      std::vector<uint64_t> res(size);
+      std::generate(res.begin(), res.end(), [&] { return morton::code({dist(rnd_engine_), dist(rnd_engine_)}); });
+      std::sort(res.begin(), res.end());
+      return res;
+    };
+    poi_keys keys;
+    keys.advertized = gen_keys(count / advertized_per_regular);
+    keys.regular = gen_keys(count);
+    std::filebuf out;
+    if (!out.open(path.toLocal8Bit().constData(), std::ios_base::out | std::ios_base::binary))
+      qFatal("Can't write POI file");
+    write_poi(out, keys, poi_format::blocks);
+  }
+
+  std::unique_ptr<poidb> load_db(poi_index index, const QString& path) {
+    auto res = std::make_unique<poidb>(index);
+    QSignalSpy updated{res.get(), &poidb::updated};
+    res->load(path);
+    if (!updated.wait(600'000))
+      qFatal("POI are not loaded");
+    return res;
+  }
+
+  // Large dataset is loaded for a single index at once to limit memory usage
+  poidb& large_db(poi_index index) {
+    if (large_db_ && large_db_index_ == index)
+      return *large_db_;
+    large_db_.reset();
+    if (large_poi_path_.isEmpty()) {
+      large_poi_path_ = dir_.filePath("large.bin");
+      write_poi_file(large_poi_path_, large_sample_size);
+    }
+    large_db_ = load_db(index, large_poi_path_);
+    large_db_index_ = index;
+    // Every query generalizes the whole viewport
+    large_db_->set_cache_budget(0);
+    return *large_db_;
+  }
+
+  // Pans the viewport from the world center like the tile widget does: area twice as large as the viewport is
+  // requested once the viewport leaves the previous one and the markers of the previous area are abandoned. Every
+  // script runs once with a fresh cache and its result is shared by all the metrics.
+  const pan_result& run_pan(poi_index index, int z_level, int pan_speed) {
+    const auto key = std::tuple{index, z_level, pan_speed};
+    if (const auto it = pan_results_.find(key); it != pan_results_.end())
+      return it->second;
+
+    const std::unique_ptr<poidb> db = load_db(index, poi_path_);
+    const unsigned px_log2 = world_coord_range_log2 - tile_pixel_size_log2 - z_level;
+    point area_min{1, 1};
+    point area_max{0, 0};
+    size_t queries = 0;
+    pc::future<std::vector<marker>> markers;
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < pan_frames; ++frame) {
+      const int64_t x = (int64_t{1} << 31) + (int64_t{pan_speed} * frame << px_log2);
+      const int64_t y = (int64_t{1} << 31) + (int64_t{pan_speed} * frame << px_log2);
+      const auto [vp_min, vp_max] = viewport_rect(x, y, z_level, 1);
+      if (!is_in_rect(vp_min, area_min, area_max) || !is_in_rect(vp_max, area_min, area_max)) {
+        std::tie(area_min, area_max) = viewport_rect(x, y, z_level, 2);
+        markers = db->generalize({pointf_from_point(area_min), pointf_from_point(area_max)}, z_level);
+        ++queries;
+      }
+      QTest::qWait(frame_interval_ms);
+    }
+    // Abandoned queries finish in background
+    if (!QTest::qWaitFor([&] { return db->work_stats().queries == queries; }, 60'000))
+      qFatal("Queries are not finished");
+    pan_result res;
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    res.work = db->work_stats();
+    return pan_results_.emplace(key, res).first->second;
+  }
+
+private slots:
+  void initTestCase() {
+    QVERIFY(dir_.isValid());
+    poi_path_ = dir_.filePath("poi.bin");
+    write_poi_file(poi_path_, sample_size);
+    default_thread_count_ = QThreadPool::globalInstance()->maxThreadCount();
+  }
+
+  void cleanup() { QThreadPool::globalInstance()->setMaxThreadCount(default_thread_count_); }
+
+  // Single query of the area twice as large as the viewport at the center of the large dataset with the pool limited
+  // to `threads`
+  void generalize_scaling_data() {
+    QTest::addColumn<poi_index>("index");
+    QTest::addColumn<int>("z_level");
+    QTest::addColumn<int>("threads");
+
+    const std::pair<const char*, poi_index> indexes[] = {{"pyramid", poi_index::pyramid},
+        {"prefix_sums", poi_index::prefix_sums}, {"blocks", poi_index::blocks}, {"quantized", poi_index::quantized}};
+    for (const auto& [index_name, index] : indexes) {
+      for (int z_level : {10, 14}) {
+        for (int threads : {1, 2, 4, 8, 16, 32})
+          QTest::addRow("%s/z%d/%d", index_name, z_level, threads) << index << z_level << threads;
+      }
+    }
+  }
+  void generalize_scaling() {
+    QFETCH(poi_index, index);
+    QFETCH(int, z_level);
+    QFETCH(int, threads);
+    poidb& db = large_db(index);
+    const auto [min, max] = viewport_rect(int64_t{1} << 31, int64_t{1} << 31, z_level, 2);
+    const QRectF area{pointf_from_point(min), pointf_from_point(max)};
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    QBENCHMARK { db.generalize(area, z_level).get(); }
+  }
+
+  // Heap allocations of all threads made by a query of the area twice as large as the viewport whose blocks are
+  // cached by the previous query
+  void allocations_per_query_data() {
+    QTest::addColumn<poi_index>("index");
+    QTest::addColumn<int>("z_level");
+
+    const std::pair<const char*, poi_index> indexes[] = {{"pyramid", poi_index::pyramid},
+        {"prefix_sums", poi_index::prefix_sums}, {"blocks", poi_index::blocks}, {"quantized", poi_index::quantized}};
+    for (const auto& [index_name, index] : indexes) {
+      for (int z_level : {10, 14})
+        QTest::addRow("%s/z%d", index_name, z_level) << index << z_level;
+    }
+  }
+  void allocations_per_query() {
+    QFETCH(poi_index, index);
+    QFETCH(int, z_level);
+    const std::unique_ptr<poidb> db = load_db(index, poi_path_);
+    const auto [min, max] = viewport_rect(int64_t{1} << 31, int64_t{1} << 31, z_level, 2);
+    const QRectF area{pointf_from_point(min), pointf_from_point(max)};
+    db->generalize(area, z_level).get();
+    const size_t before = allocation_count();
+    db->generalize(area, z_level).get();
+    QTest::setBenchmarkResult(allocation_count() - before, QTest::Events);
+  }
+
+  // Keys scanned by the queries abandoned before their markers were merged
+  void wasted_keys_per_second_data() { pan_scripts(); }
+  void wasted_keys_per_second() {
+    QFETCH(poi_index, index);
+    QFETCH(int, z_level);
+    QFETCH(int, pan_speed);
+    const pan_result& res = run_pan(index, z_level, pan_speed);
+    QTest::setBenchmarkResult(res.work.wasted_keys_scanned / res.seconds, QTest::Events);
+  }
+
+  void useful_keys_per_second_data() { pan_scripts(); }
+  void useful_keys_per_second() {
+    QFETCH(poi_index, index);
+    QFETCH(int, z_level);
+    QFETCH(int, pan_speed);
+    const pan_result& res = run_pan(index, z_level, pan_speed);
+    QTest::setBenchmarkResult((res.work.keys_scanned - res.work.wasted_keys_scanned) / res.seconds, QTest::Events);
+  }
+
+  void cancelled_queries_per_second_data() { pan_scripts(); }
+  void cancelled_queries_per_second() {
+    QFETCH(poi_index, index);
+    QFETCH(int, z_level);
+    QFETCH(int, pan_speed);
+    const pan_result& res = run_pan(index, z_level, pan_speed);
+    QTest::setBenchmarkResult(res.work.cancelled / res.seconds, QTest::Events);
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  QTemporaryDir dir_;
+  QString poi_path_;
+  QString large_poi_path_;
+  std::unique_ptr<poidb> large_db_;
+  poi_index large_db_index_ = poi_index::pyramid;
+  int default_thread_count_ = 0;
+  std::map<std::tuple<poi_index, int, int>, pan_result> pan_results_;
+};
+
+QTEST_MAIN(poidb_benchmarks)
+#include "poidb.bench.moc"
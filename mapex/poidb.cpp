@@ -1,30 +1,118 @@
+#include <algorithm>
 #include <array>
-#include <cmath>
-#include <fstream>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
 
 #include <QtCore/QDir>
 #include <QtCore/QMetaMethod>
 #include <QtCore/QRectF>
-#include <QtCore/QSaveFile>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QThreadPool>
-
-#include <QtNetwork/QNetworkReply>
+#include <QtCore/QUrl>
 
 #include <portable_concurrency/future>
 
-#include <mapex/deltapack.hpp>
+#include <mapex/generalization.hpp>
+#include <mapex/generalization_cache.hpp>
+#include <mapex/hilbert_code.hpp>
+#include <mapex/key_blocks.hpp>
+#include <mapex/key_search.hpp>
+#include <mapex/mapped_file.hpp>
+#include <mapex/markers.hpp>
 #include <mapex/morton_code.hpp>
 #include <mapex/network_thread.hpp>
+#include <mapex/parallel_decode.hpp>
+#include <mapex/poi_download.hpp>
+#include <mapex/poi_file.hpp>
+#include <mapex/poi_search.hpp>
 #include <mapex/poidb.hpp>
+#include <mapex/projection.hpp>
+#include <mapex/search_index.hpp>
+
+// Layer keys are stored either in `keys`, in `blocks` or in `quantized` depending on the `poi_index` mode.
+struct poi_layer {
+  std::vector<uint64_t> keys;
+  key_blocks blocks;
+  cell_pyramid pyramid;
+  prefix_sums sums;
+  search_index search;
+  std::vector<uint32_t> quantized;
+  basic_search_index<uint32_t> quantized_search;
+};
 
 struct poi_data {
-  std::vector<uint64_t> advertized;
-  std::vector<uint64_t> regular;
+  key_curve curve = key_curve::morton;
+  poi_layer advertized;
+  poi_layer regular;
+};
+
+struct generalization_work_counters {
+  std::atomic<size_t> queries{0};
+  std::atomic<size_t> cancelled{0};
+  std::atomic<size_t> keys_scanned{0};
+  std::atomic<size_t> wasted_keys_scanned{0};
+  std::atomic<size_t> bigmin_jumps{0};
+};
+
+// Memory of a single `poidb::generalize` call. Buffers of the finished calls are reused by the following ones, so
+// querying cached blocks makes no heap allocations besides the tasks and the reported markers.
+struct generalization_buffers {
+  std::vector<cell_block> blocks;
+  // Groups of the advertized layer followed by the groups of the consecutive parts of the regular layer
+  std::vector<std::vector<point_group>> groups;
+  // Concatenated groups of the regular layer parts
+  std::vector<point_group> regular;
+  std::vector<pc::future<void>> tasks;
+};
+
+struct generalization_buffer_pool {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<generalization_buffers>> free;
+
+  std::unique_ptr<generalization_buffers> acquire() {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (free.empty())
+      return std::make_unique<generalization_buffers>();
+    auto res = std::move(free.back());
+    free.pop_back();
+    return res;
+  }
+
+  // Buffers are dropped if they can't be stored
+  void release(std::unique_ptr<generalization_buffers> buffers) noexcept try {
+    std::lock_guard<std::mutex> lock{mutex};
+    free.push_back(std::move(buffers));
+  } catch (...) {
+  }
 };
 
 namespace {
 
+// Layer ids in the generalization cache
+constexpr unsigned advertized_layer = 0;
+constexpr unsigned regular_layer = 1;
+
+// State of a single `poidb::generalize` call shared by its tasks
+struct generalization_query {
+  cancellation_token cancel;
+  std::unique_ptr<generalization_buffers> buffers;
+  std::atomic<size_t> keys_scanned{0};
+  std::atomic<size_t> bigmin_jumps{0};
+
+  void finish(generalization_work_counters& work, bool cancelled) const noexcept {
+    const size_t keys = keys_scanned.load(std::memory_order_relaxed);
+    ++work.queries;
+    work.keys_scanned += keys;
+    work.bigmin_jumps += bigmin_jumps.load(std::memory_order_relaxed);
+    if (cancelled) {
+      ++work.cancelled;
+      work.wasted_keys_scanned += keys;
+    }
+  }
+};
+
 QString poi_cache_path() {
   const auto cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
   if (!QFileInfo::exists(cache_dir) && !QDir{cache_dir}.mkpath(".")) {
@@ -34,190 +122,222 @@ QString poi_cache_path() {
   return QDir{cache_dir}.filePath("poi.bin");
 }
 
-poi_data read_poi(const QString& path) {
+poi_data make_poi_data(poi_keys keys, poi_index index) {
   poi_data res;
-  if (!QFileInfo::exists(path))
+  res.curve = keys.curve;
+  if (index == poi_index::blocks) {
+    res.advertized.blocks = key_blocks{keys.advertized};
+    res.regular.blocks = key_blocks{keys.regular};
     return res;
-
-  std::filebuf in;
-  if (!in.open(path.toLocal8Bit().constData(), std::ios_base::in))
-    throw std::system_error{errno, std::system_category(), "open: " + path.toStdString()};
-
-  uint64_t adv_count;
-  auto it = varint::unpack_n(std::istreambuf_iterator{&in}, {}, 1, &adv_count);
-  it = delta::unpack_n(it, {}, adv_count, std::back_inserter(res.advertized));
-  delta::unpack(it, {}, std::back_inserter(res.regular));
+  }
+  res.advertized.keys = std::move(keys.advertized);
+  res.regular.keys = std::move(keys.regular);
   return res;
 }
 
-pc::future<poi_data> load_poi(network_thread& net) {
-  return net.send_request(QUrl("https://raw.githubusercontent.com/VestniK/mapex/master/poi.bin"))
-      .next([](std::unique_ptr<QNetworkReply> reply) {
-        QSaveFile sf{poi_cache_path()};
-        if (!sf.open(QIODevice::WriteOnly)) {
-          throw std::system_error{
-              std::make_error_code(std::errc::no_such_file_or_directory), "create cache file"}; // TODO: better error
-        }
-        const QByteArray content = reply->readAll();
-        sf.write(content);
-        if (!sf.commit())
-          throw std::system_error{std::make_error_code(std::errc::io_error), "save cache file"}; // TODO: better error
+pc::future<poi_data> read_poi(const QString& path, poi_index index) {
+  if (!QFileInfo::exists(path))
+    return pc::make_ready_future(poi_data{});
+
+  // Blocks are queried in place of the mapping and keep it alive. Other indexes decode the keys and drop the mapping.
+  const auto file = std::make_shared<const mapped_file>(path);
+  const char* first = file->data();
+  const char* last = file->data() + file->size();
+  if (index == poi_index::blocks) {
+    poi_blocks blocks = ::read_poi_blocks(first, last, file);
+    poi_data res;
+    res.curve = blocks.curve;
+    res.advertized.blocks = std::move(blocks.advertized);
+    res.regular.blocks = std::move(blocks.regular);
+    return pc::make_ready_future(std::move(res));
+  }
+
+  if (!has_poi_blocks(first, last))
+    return pc::make_ready_future(make_poi_data(::read_poi(first, last), index));
 
-        return pc::async(QThreadPool::globalInstance(), read_poi, poi_cache_path());
+  // Blocks are independent so the keys are decoded by several pool tasks at once
+  poi_blocks blocks = ::read_poi_blocks(first, last, file);
+  std::array<pc::future<std::vector<uint64_t>>, 2> futures = {
+      decode_all(QThreadPool::globalInstance(), std::make_shared<const key_blocks>(std::move(blocks.advertized))),
+      decode_all(QThreadPool::globalInstance(), std::make_shared<const key_blocks>(std::move(blocks.regular)))};
+  return pc::when_all(std::make_move_iterator(futures.begin()), std::make_move_iterator(futures.end()))
+      .next([curve = blocks.curve](std::vector<pc::future<std::vector<uint64_t>>> keys) {
+        poi_data res;
+        res.curve = curve;
+        res.advertized.keys = keys[0].get();
+        res.regular.keys = keys[1].get();
+        return res;
       });
 }
 
-pc::future<poi_data> fetch_poi_cache() { return pc::async(QThreadPool::globalInstance(), read_poi, poi_cache_path()); }
+bool is_empty(const poi_data& data) noexcept {
+  return data.advertized.keys.empty() && data.regular.keys.empty() && data.advertized.blocks.size() == 0 &&
+         data.regular.blocks.size() == 0;
+}
 
-struct point_group {
-  uint64_t morton_code;
-  int count;
-};
+pc::future<poi_data> load_poi(
+    network_thread& net, const QUrl& url, poi_index index, pc::unique_function<void(const poi_keys&)> on_progress) {
+  return download_poi(net, url, poi_cache_path(), std::move(on_progress))
+      .next(QThreadPool::globalInstance(), [index](poi_keys keys) { return make_poi_data(std::move(keys), index); });
+}
 
-point pointf_to_point(QPointF pt) noexcept {
-  assert(pt.x() < 1.0 && pt.x() >= 0.0);
-  assert(pt.y() < 1.0 && pt.y() >= 0.0);
-  return point{static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() * pt.x()),
-      static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() * pt.y())};
-}
-
-uint64_t pointf_to_morton(QPointF pt) noexcept { return morton::code(pointf_to_point(pt)); }
-
-QPointF pointf_from_morton(uint64_t code) noexcept {
-  const auto pt = morton::decode(code);
-  const double max_coord = std::pow(2., 32.);
-  return {pt.x / max_coord, pt.y / max_coord};
-}
-
-constexpr unsigned cell_pixel_size_log2 = 5;
-constexpr unsigned tile_pixel_size_log2 = 8;
-constexpr unsigned world_coord_range_log2 = 32;
-
-std::vector<point_group> generalize(
-    const std::vector<uint64_t>& points, uint64_t vp_min, uint64_t vp_max, int z_level) {
-
-  const int cell_coord_range_log2 = world_coord_range_log2 - (tile_pixel_size_log2 - cell_pixel_size_log2 + z_level);
-  const uint64_t cell_mask = ~uint64_t{0} << (2 * cell_coord_range_log2);
-  const uint64_t cell_step = uint64_t{1} << (2 * cell_coord_range_log2);
-  std::vector<point_group> res;
-  auto first = std::lower_bound(points.begin(), points.end(), vp_min);
-  const auto last = std::upper_bound(points.begin(), points.end(), vp_max);
-  while (first != last) {
-    if (!is_in_rect(morton::decode(*first), morton::decode(vp_min), morton::decode(vp_max)))
-      first = std::lower_bound(first, last, morton::bigmin(*first, vp_min, vp_max));
-
-    uint64_t x_sum = 0;
-    uint64_t y_sum = 0;
-    int count = 0;
-    const uint64_t next_cell_start = ((*first) & cell_mask) + cell_step;
-    for (; first != last && *first < next_cell_start; ++first) {
-      const point pt = morton::decode(*first);
-      x_sum += pt.x;
-      y_sum += pt.y;
-      ++count;
-    }
-    if (count > 0) {
-      res.push_back(point_group{
-          morton::code({static_cast<uint32_t>(x_sum / count), static_cast<uint32_t>(y_sum / count)}), count});
+pc::future<poi_data> fetch_poi(const QString& path, poi_index index) {
+  return pc::async(QThreadPool::globalInstance(), read_poi, path, index);
+}
+
+void convert_keys(poi_data& data, key_curve curve) {
+  if (data.curve == curve)
+    return;
+  for (poi_layer* layer : {&data.advertized, &data.regular}) {
+    const bool packed = layer->blocks.size() > 0;
+    if (packed)
+      layer->keys = layer->blocks.decode_all();
+    std::transform(layer->keys.begin(), layer->keys.end(), layer->keys.begin(),
+        curve == key_curve::hilbert ? hilbert::from_morton : hilbert::to_morton);
+    std::sort(layer->keys.begin(), layer->keys.end());
+    if (packed) {
+      layer->blocks = key_blocks{layer->keys};
+      layer->keys = {};
     }
   }
-  return res;
+  data.curve = curve;
 }
 
-constexpr point aligned_point(point pt, unsigned bit_alignment) noexcept {
-  const uint32_t mask = ~uint32_t{0} << bit_alignment;
-  return {pt.x & mask, pt.y & mask};
+template <typename Curve>
+void build_index(poi_layer& layer, poi_index index, Curve curve) {
+  switch (index) {
+  case poi_index::pyramid:
+    layer.pyramid = cell_pyramid{layer.keys, curve};
+    break;
+  case poi_index::prefix_sums:
+    layer.sums = prefix_sums{layer.keys, curve};
+    layer.search = search_index{layer.keys};
+    break;
+  case poi_index::blocks:
+    break;
+  case poi_index::quantized:
+    layer.quantized.resize(layer.keys.size());
+    std::transform(layer.keys.begin(), layer.keys.end(), layer.quantized.begin(), morton::quantize);
+    layer.quantized_search = basic_search_index<uint32_t>{layer.quantized};
+    layer.keys = {};
+    break;
+  }
 }
 
-QPointF abs(QPointF pt) noexcept { return {std::abs(pt.x()), std::abs(pt.y())}; }
+// Converts keys to the requested curve and builds the index over them. Quantized keys are built from Morton codes only.
+void prepare_poi_data(poi_data& data, poi_index index, key_curve curve) {
+  convert_keys(data, index == poi_index::quantized ? key_curve::morton : curve);
+  with_curve(data.curve, [&](auto curve_policy) {
+    build_index(data.advertized, index, curve_policy);
+    build_index(data.regular, index, curve_policy);
+  });
+}
 
-bool marker_overlaps(const QPointF& lhs, const QPointF& rhs, uint32_t min_dist) noexcept {
-  const point diff = pointf_to_point(abs(rhs - lhs));
-  return diff.x < min_dist || diff.y < min_dist;
+template <typename Curve>
+std::vector<point_group> generalize_layer(const poi_layer& layer, poi_index index, Curve, point vp_min, point vp_max,
+    int z_level, scan_stats* stats, const cancellation_token* cancel) {
+  switch (index) {
+  case poi_index::pyramid:
+    return ::generalize<Curve>(layer.pyramid, Curve::code(vp_min), Curve::code(vp_max), z_level, stats, cancel);
+  case poi_index::prefix_sums:
+    return ::generalize<Curve>({layer.keys, &layer.search}, layer.sums, Curve::code(vp_min), Curve::code(vp_max),
+        z_level, stats, cancel);
+  case poi_index::blocks:
+    return ::generalize<Curve>(layer.blocks, Curve::code(vp_min), Curve::code(vp_max), z_level,
+        default_block_ranges, stats, cancel);
+  case poi_index::quantized:
+    return ::generalize<morton::quantized_curve>({layer.quantized, &layer.quantized_search},
+        morton::quantized_curve::code(vp_min), morton::quantized_curve::code(vp_max), z_level, stats, cancel);
+  }
+  return {};
 }
 
-marker merge_marker(marker lhs, marker rhs) noexcept {
-  marker res{(lhs.poi_count * lhs.point + rhs.poi_count * rhs.point) / (lhs.poi_count + rhs.poi_count),
-      (lhs.poi_count + rhs.poi_count), lhs.has_advertizers || rhs.has_advertizers};
+template <typename Curve>
+std::vector<point> decode_keys(const std::vector<key_type_of<Curve>>& keys) {
+  std::vector<point> res(keys.size());
+  Curve::decode_n(keys.data(), keys.size(), res.data());
   return res;
 }
 
-void merge_marker(std::vector<marker>& markers, marker item, uint32_t min_dist) noexcept {
-  for (auto it = markers.begin(); it != markers.end();) {
-    if (!marker_overlaps(it->point, item.point, min_dist)) {
-      ++it;
-      continue;
-    }
-    item = merge_marker(item, *it);
-    it = markers.erase(it);
-    return merge_marker(markers, item, min_dist);
+// Pyramid index keeps the plain keys which are searched without the index. Keys are decoded in place since the
+// quantized ones are not the `Curve` keys.
+template <typename Curve>
+std::vector<point> query_layer_rect(const poi_layer& layer, poi_index index, Curve, point min, point max) {
+  using quantized_curve = morton::quantized_curve;
+  switch (index) {
+  case poi_index::blocks:
+    return decode_keys<Curve>(::query_rect<Curve>(layer.blocks, Curve::code(min), Curve::code(max)));
+  case poi_index::quantized:
+    return decode_keys<quantized_curve>(::query_rect<quantized_curve>(
+        {layer.quantized, &layer.quantized_search}, quantized_curve::code(min), quantized_curve::code(max)));
+  default:
+    return decode_keys<Curve>(::query_rect<Curve>(
+        {layer.keys, index == poi_index::prefix_sums ? &layer.search : nullptr}, Curve::code(min), Curve::code(max)));
   }
-  markers.push_back(item);
-}
-
-std::vector<marker> merge_generalizations(
-    std::vector<point_group> ads, std::vector<point_group> poi, uint64_t vp_min, uint64_t vp_max, int z_level) {
-  std::vector<marker> res;
-  std::vector<marker> box_markers;
-  const unsigned group_bit_alignment =
-      world_coord_range_log2 - (tile_pixel_size_log2 - (cell_pixel_size_log2 + 1) + z_level);
-  const point vp_min_pt = aligned_point(morton::decode(vp_min), group_bit_alignment);
-  const point vp_max_pt = morton::decode(vp_max);
-
-  const uint32_t box_side = (uint32_t{1} << group_bit_alignment);
-  for (point box_min = vp_min_pt; box_min.x < vp_max_pt.x; box_min.x += box_side / 2) { // TODO: handle overflows
-    for (box_min.y = vp_min_pt.y; box_min.y < vp_max_pt.y; box_min.y += box_side / 2) { // TODO: handle overflows
-      const point box_max = box_min + point{box_side, box_side};                        // TODO: handle overflows
-
-      for (auto it = res.begin(); it != res.end();) {
-        if (!is_in_rect(pointf_to_point(it->point), box_min, box_max)) {
-          ++it;
-          continue;
-        }
-        box_markers.push_back(*it); // No markers in res overlaps. No need to to search and merge overlaps
-        it = res.erase(it);
-      }
-
-      for (auto it = ads.begin(); it != ads.end();) {
-        if (!is_in_rect(morton::decode(it->morton_code), box_min, box_max)) {
-          ++it;
-          continue;
-        }
-        merge_marker(box_markers, {pointf_from_morton(it->morton_code), it->count, true}, box_side / 2);
-        it = ads.erase(it);
-      }
+}
 
-      for (auto it = poi.begin(); it != poi.end();) {
-        if (!is_in_rect(morton::decode(it->morton_code), box_min, box_max)) {
-          ++it;
-          continue;
-        }
-        merge_marker(box_markers, {pointf_from_morton(it->morton_code), it->count, false}, box_side / 2);
-        it = poi.erase(it);
-      }
-      std::move(box_markers.begin(), box_markers.end(), std::back_inserter(res));
-      box_markers.clear();
-    }
+template <typename Curve>
+std::vector<point> layer_nearest(const poi_layer& layer, poi_index index, Curve, point pt, size_t k) {
+  using quantized_curve = morton::quantized_curve;
+  switch (index) {
+  case poi_index::blocks:
+    return decode_keys<Curve>(::nearest<Curve>(layer.blocks, pt, k));
+  case poi_index::quantized:
+    return decode_keys<quantized_curve>(
+        ::nearest<quantized_curve>({layer.quantized, &layer.quantized_search}, pt, k));
+  default:
+    return decode_keys<Curve>(
+        ::nearest<Curve>({layer.keys, index == poi_index::prefix_sums ? &layer.search : nullptr}, pt, k));
   }
-  return res;
 }
 
 } // namespace
 
-poidb::poidb(QObject* parent) : QObject(parent) {}
+poidb::poidb(poi_index index, key_curve curve, QObject* parent)
+    : QObject(parent), index_{index}, curve_{curve}, cache_{std::make_shared<generalization_cache>()},
+      work_{std::make_shared<generalization_work_counters>()},
+      buffers_{std::make_shared<generalization_buffer_pool>()} {}
+
+poidb::~poidb() = default;
 
 void poidb::reload(network_thread& net) {
+  reload(net, QUrl("https://raw.githubusercontent.com/VestniK/mapex/master/poi.bin"));
+}
+
+void poidb::reload(network_thread& net, const QUrl& url) {
   auto notify = [this](pc::future<poi_data> f) {
     QMetaObject::invokeMethod(this, &poidb::on_loaded, Qt::QueuedConnection);
     return f;
   };
-  std::array<pc::future<poi_data>, 2> futures = {load_poi(net).then(notify).detach(), fetch_poi_cache()};
+  // Keys decoded so far are indexed on the pool while the download continues. Once a non-empty cache or the whole
+  // download is loaded the snapshots would be discarded, so they are neither copied on the network thread nor indexed.
+  auto partial_wanted = std::make_shared<std::atomic<bool>>(true);
+  auto on_progress = [this, index = index_, curve = curve_, partial_wanted](const poi_keys& keys) {
+    if (!partial_wanted->load(std::memory_order_relaxed))
+      return;
+    post(QThreadPool::globalInstance(), [this, keys, index, curve, partial_wanted]() mutable {
+      if (!partial_wanted->load(std::memory_order_relaxed))
+        return;
+      const size_t key_count = keys.advertized.size() + keys.regular.size();
+      auto data = std::make_shared<poi_data>(make_poi_data(std::move(keys), index));
+      prepare_poi_data(*data, index, curve);
+      QMetaObject::invokeMethod(
+          this, [this, data, key_count] { on_partial_loaded(data, key_count); }, Qt::QueuedConnection);
+    });
+  };
+  auto downloaded = [partial_wanted, notify](pc::future<poi_data> f) {
+    partial_wanted->store(false, std::memory_order_relaxed);
+    return notify(std::move(f));
+  };
+  std::array<pc::future<poi_data>, 2> futures = {
+      load_poi(net, url, index_, on_progress).then(downloaded).detach(), fetch_poi(poi_cache_path(), index_)};
   load_future_ = pc::when_any(futures.begin(), futures.end())
-                     .next([](pc::when_any_result<std::vector<pc::future<poi_data>>> res) {
+                     .next([partial_wanted](pc::when_any_result<std::vector<pc::future<poi_data>>> res) {
                        try {
                          poi_data data = res.futures[res.index].get(); // TODO: handle network errors here
-                         if (res.index == 1 && data.regular.empty() && data.advertized.empty())
+                         if (res.index == 1 && is_empty(data))
                            return std::move(res.futures[0]);
+                         partial_wanted->store(false, std::memory_order_relaxed);
                          return pc::make_ready_future(std::move(data));
                        } catch (network_error err) { // TODO: network error
                          assert(res.index == 0);
@@ -225,30 +345,182 @@ void poidb::reload(network_thread& net) {
                          return std::move(res.futures[1]);
                        }
                      })
+                     .next(QThreadPool::globalInstance(),
+                         [index = index_, curve = curve_](poi_data data) {
+                           prepare_poi_data(data, index, curve);
+                           return data;
+                         })
                      .then(notify);
 }
 
-pc::future<std::vector<marker>> poidb::generalize(const QRectF& viewport, int z_level) const {
-  const uint64_t min = pointf_to_morton(viewport.topLeft());
-  const uint64_t max = pointf_to_morton(viewport.bottomRight());
+void poidb::load(const QString& path) {
+  load_future_ = fetch_poi(path, index_)
+                     .next(QThreadPool::globalInstance(),
+                         [index = index_, curve = curve_](poi_data data) {
+                           prepare_poi_data(data, index, curve);
+                           return data;
+                         })
+                     .then([this](pc::future<poi_data> f) {
+                       QMetaObject::invokeMethod(this, &poidb::on_loaded, Qt::QueuedConnection);
+                       return f;
+                     });
+}
 
-  auto generalize_func = [min, max, z_level](std::shared_ptr<const std::vector<uint64_t>> points) {
-    return ::generalize(*points, min, max, z_level);
+pc::future<std::vector<marker>> poidb::generalize(const QRectF& viewport, int z_level) const {
+  const point min = pointf_to_point(viewport.topLeft());
+  const point max = pointf_to_point(viewport.bottomRight());
+
+  if (!data_)
+    return pc::make_ready_future(std::vector<marker>{});
+
+  // Query is cancelled once nobody waits for its markers, e.g. the viewport has moved away before they are ready
+  auto query = std::make_shared<generalization_query>();
+  query->buffers = buffers_->acquire();
+  generalization_buffers& buffers = *query->buffers;
+  pc::promise<std::vector<marker>> promise{pc::canceler_arg, [query] { query->cancel.cancel(); }};
+  auto res = promise.get_future();
+
+  // Blocks shared with the recent viewports are taken from the cache. Regular POI dominate so their blocks are split
+  // into consecutive parts generalized by separate pool tasks. Advertized POI are few and take a single task.
+  QThreadPool* pool = QThreadPool::globalInstance();
+  cover_with_blocks(min, max, z_level, buffers.blocks);
+  const size_t block_count = buffers.blocks.size();
+  const size_t parts = std::clamp<size_t>(pool->maxThreadCount(), 1, std::max<size_t>(block_count, 1));
+  if (buffers.groups.size() < parts + 1)
+    buffers.groups.resize(parts + 1);
+  auto generalize_func = [min, max, z_level, index = index_, curve = data_->curve, cache = cache_,
+                             generation = cache_->generation(), query](std::shared_ptr<const poi_layer> layer,
+                             unsigned layer_id, size_t groups_id, size_t first, size_t last) {
+    scan_stats stats;
+    const std::vector<cell_block>& blocks = query->buffers->blocks;
+    std::vector<point_group>& groups = query->buffers->groups[groups_id];
+    groups.clear();
+    generalize_blocks(
+        *cache, generation, layer_id, blocks.begin() + first, blocks.begin() + last, min, max,
+        [&](const cell_block& block) {
+          return with_curve(curve, [&](auto curve_policy) {
+            return generalize_layer(
+                *layer, index, curve_policy, block.min, block.max, z_level, &stats, &query->cancel);
+          });
+        },
+        groups, &query->cancel);
+    query->keys_scanned += stats.keys_scanned;
+    query->bigmin_jumps += stats.bigmin_jumps;
   };
-  std::array<pc::future<std::vector<point_group>>, 2> futures = {
-      pc::async(QThreadPool::globalInstance(), generalize_func,
-          std::shared_ptr<const std::vector<uint64_t>>{data_, &data_->advertized}),
-      pc::async(QThreadPool::globalInstance(), generalize_func,
-          std::shared_ptr<const std::vector<uint64_t>>{data_, &data_->regular})};
-  return pc::when_all(std::make_move_iterator(futures.begin()), std::make_move_iterator(futures.end()))
-      .next([min, max, z_level](std::vector<pc::future<std::vector<point_group>>> results) {
-        return merge_generalizations(results[0].get(), results[1].get(), min, max, z_level);
-      });
+  buffers.tasks.clear();
+  buffers.tasks.push_back(pc::async(pool, generalize_func,
+      std::shared_ptr<const poi_layer>{data_, &data_->advertized}, advertized_layer, size_t{0}, size_t{0},
+      block_count));
+  const std::shared_ptr<const poi_layer> regular{data_, &data_->regular};
+  for (size_t part = 0; part < parts; ++part) {
+    buffers.tasks.push_back(pc::async(pool, generalize_func, regular, regular_layer, part + 1,
+        block_count * part / parts, block_count * (part + 1) / parts));
+  }
+  pc::when_all(std::make_move_iterator(buffers.tasks.begin()), std::make_move_iterator(buffers.tasks.end()))
+      .next([promise = std::move(promise), query, work = work_, buffer_pool = buffers_, min, max, z_level, parts](
+                std::vector<pc::future<void>> tasks) mutable {
+        // Tasks are done with the buffers so they may be taken by the next query before the markers are reported
+        std::unique_ptr<generalization_buffers> buffers = std::move(query->buffers);
+        if (query->cancel.is_cancelled() || !promise.is_awaiten()) {
+          query->finish(*work, true);
+          buffer_pool->release(std::move(buffers));
+          return;
+        }
+        // Work is counted before the markers are reported so that it is seen by the code waiting for them
+        std::vector<marker> markers;
+        try {
+          for (pc::future<void>& task : tasks)
+            task.get();
+          const std::vector<point_group>* regular = &buffers->groups[1];
+          if (parts > 1) {
+            std::vector<point_group>& joined = buffers->regular;
+            joined.clear();
+            for (size_t part = 1; part <= parts; ++part)
+              joined.insert(joined.end(), buffers->groups[part].begin(), buffers->groups[part].end());
+            regular = &joined;
+          }
+          merge_generalizations(buffers->groups.front(), *regular, min, max, z_level, markers);
+        } catch (...) {
+          query->finish(*work, false);
+          buffer_pool->release(std::move(buffers));
+          promise.set_exception(std::current_exception());
+          return;
+        }
+        query->finish(*work, false);
+        buffer_pool->release(std::move(buffers));
+        promise.set_value(std::move(markers));
+      })
+      .detach();
+  return res;
+}
+
+pc::future<std::vector<poi_hit>> poidb::query_rect(const QRectF& rect) const {
+  if (!data_)
+    return pc::make_ready_future(std::vector<poi_hit>{});
+
+  const point min = pointf_to_point(rect.topLeft());
+  const point max = pointf_to_point(rect.bottomRight());
+  return pc::async(QThreadPool::globalInstance(), [data = data_, index = index_, min, max] {
+    return with_curve(data->curve, [&](auto curve_policy) {
+      std::vector<poi_hit> res;
+      for (const auto& [layer, advertized] : {std::pair{&data->advertized, true}, std::pair{&data->regular, false}}) {
+        for (point pt : query_layer_rect(*layer, index, curve_policy, min, max))
+          res.push_back({pointf_from_point(pt), advertized});
+      }
+      return res;
+    });
+  });
+}
+
+pc::future<std::vector<poi_hit>> poidb::nearest(const QPointF& pt, size_t k) const {
+  if (!data_)
+    return pc::make_ready_future(std::vector<poi_hit>{});
+
+  const point target = pointf_to_point(pt);
+  return pc::async(QThreadPool::globalInstance(), [data = data_, index = index_, target, k] {
+    return with_curve(data->curve, [&](auto curve_policy) {
+      // k nearest of both layers are merged by the distance
+      std::vector<std::pair<double, poi_hit>> candidates;
+      for (const auto& [layer, advertized] : {std::pair{&data->advertized, true}, std::pair{&data->regular, false}}) {
+        for (point key_pt : layer_nearest(*layer, index, curve_policy, target, k)) {
+          candidates.push_back({squared_distance(key_pt, target), poi_hit{pointf_from_point(key_pt), advertized}});
+        }
+      }
+      const size_t count = std::min(k, candidates.size());
+      std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+          [](const auto& l, const auto& r) { return l.first < r.first; });
+      std::vector<poi_hit> res(count);
+      std::transform(candidates.begin(), candidates.begin() + count, res.begin(),
+          [](const std::pair<double, poi_hit>& candidate) { return candidate.second; });
+      return res;
+    });
+  });
+}
+
+void poidb::set_cache_budget(size_t budget) { cache_ = std::make_shared<generalization_cache>(budget); }
+
+generalization_cache_stats poidb::cache_stats() const { return cache_->stats(); }
+
+generalization_work poidb::work_stats() const {
+  return {work_->queries, work_->cancelled, work_->keys_scanned, work_->wasted_keys_scanned, work_->bigmin_jumps};
 }
 
 void poidb::on_loaded() {
   if (!load_future_.valid() || !load_future_.is_ready())
     return;
   data_ = std::make_shared<poi_data>(load_future_.get());
+  partial_key_count_ = 0;
+  cache_->clear();
+  emit updated();
+}
+
+void poidb::on_partial_loaded(std::shared_ptr<const poi_data> data, size_t key_count) {
+  // Partially downloaded data is shown only until complete data is loaded. Snapshots may be indexed out of order.
+  if ((load_future_.valid() && load_future_.is_ready()) || (data_ && partial_key_count_ == 0) ||
+      key_count <= partial_key_count_)
+    return;
+  data_ = std::move(data);
+  partial_key_count_ = key_count;
+  cache_->clear();
   emit updated();
 }
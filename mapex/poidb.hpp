@@ -1,29 +1,87 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <QtCore/QObject>
 #include <QtCore/QPointF>
 
 #include <portable_concurrency/future_fwd>
 
+#include <mapex/markers.hpp>
+#include <mapex/poi_file.hpp>
+
+class QUrl;
+class generalization_cache;
 class network_thread;
+struct generalization_buffer_pool;
+struct generalization_cache_stats;
+struct generalization_work_counters;
 struct poi_data;
 
-struct marker {
+/// Index built for POI data on load and used to generalize it.
+enum class poi_index {
+  /// Cell sums for every z-level. Fastest queries, memory usage is a few times of the POI data size.
+  pyramid,
+  /// Cumulative coordinate sums and a search tree over the POI keys. Logarithmic cost per cell, memory usage is about
+  /// twice of the POI data size.
+  prefix_sums,
+  /// No index, POI keys are kept in compressed blocks and only the blocks overlapping the viewport are decoded by
+  /// each query. Slowest queries, memory usage is below the uncompressed POI data size.
+  blocks,
+  /// 32 bit Morton keys of points snapped to squares with the side of 2^16 world units and a search tree over them.
+  /// Keys take half of the POI data size and are always Morton codes whatever curve is requested. Markers are exact up
+  /// to z-level 13, each distinct square is a cell of its own at the higher ones.
+  quantized
+};
+
+/// Work done by `poidb::generalize` calls. Keys scanned by the queries abandoned before their markers were merged are
+/// counted as wasted. Cell sums read from the pyramid are counted as keys.
+struct generalization_work {
+  size_t queries = 0;
+  size_t cancelled = 0;
+  size_t keys_scanned = 0;
+  size_t wasted_keys_scanned = 0;
+  size_t bigmin_jumps = 0;
+};
+
+/// POI found by `poidb::query_rect` and `poidb::nearest`.
+struct poi_hit {
   QPointF point;
-  int poi_count = 1;
-  bool has_advertizers = false;
+  bool advertized = false;
 };
 
 class poidb : public QObject {
   Q_OBJECT
 public:
-  explicit poidb(QObject* parent = nullptr);
+  /// POI keys are converted to the `curve` on load if the file uses another one.
+  explicit poidb(
+      poi_index index = poi_index::pyramid, key_curve curve = key_curve::morton, QObject* parent = nullptr);
+  ~poidb() override;
 
+  /// Loads POI from the cache and downloads fresh POI from `url`. Keys decoded so far are shown while the download is
+  /// in progress if the cache is empty.
+  void reload(network_thread& net, const QUrl& url);
   void reload(network_thread& net);
+  /// Loads POI from the poi.bin file at `path` without touching the cache or the network.
+  void load(const QString& path);
 
+  /// Cells are generalized in aligned blocks which are cached until the POI data is updated. Blocks of regular POI
+  /// are split between up to `QThreadPool::maxThreadCount()` pool tasks. Reports cells overlapping the `viewport` with
+  /// all their points. Abandoning the returned future cancels the query: remaining
+  /// cells are skipped and markers are not merged.
   [[nodiscard]] pc::future<std::vector<marker>> generalize(const QRectF& viewport, int z_level) const;
+  /// All POI inside of the `rect`, advertized ones go first. Runs as a single pool task.
+  [[nodiscard]] pc::future<std::vector<poi_hit>> query_rect(const QRectF& rect) const;
+  /// Up to `k` POI of both layers nearest to `pt` sorted by the distance. Runs as a single pool task.
+  [[nodiscard]] pc::future<std::vector<poi_hit>> nearest(const QPointF& pt, size_t k) const;
+  /// Replaces the generalization cache with an empty one limited to `budget` bytes. Zero budget disables caching.
+  void set_cache_budget(size_t budget);
+  /// Block lookups made by `generalize` calls since the cache was created.
+  generalization_cache_stats cache_stats() const;
+  /// Work done by completed `generalize` calls including the cancelled ones. Calls are counted before their futures
+  /// become ready.
+  generalization_work work_stats() const;
 
 signals:
   void updated();
@@ -32,6 +90,16 @@ private slots:
   void on_loaded();
 
 private:
+  void on_partial_loaded(std::shared_ptr<const poi_data> data, size_t key_count);
+
+  poi_index index_;
+  key_curve curve_;
   pc::future<poi_data> load_future_;
   std::shared_ptr<const poi_data> data_;
+  // Number of keys in `data_` if it is built from partially downloaded POI, zero otherwise
+  size_t partial_key_count_ = 0;
+  // Shared with the running generalization tasks
+  std::shared_ptr<generalization_cache> cache_;
+  std::shared_ptr<generalization_work_counters> work_;
+  std::shared_ptr<generalization_buffer_pool> buffers_;
 };
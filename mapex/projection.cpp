@@ -0,0 +1,30 @@
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include <mapex/projection.hpp>
+
+namespace {
+
+constexpr double deg2rad(double deg) noexcept { return deg * M_PI / 180.; }
+
+} // namespace
+
+QPointF project(geo_point point) noexcept {
+  const double x = (static_cast<double>(point.lon) + 180.) / 360.;
+
+  const double lat_rad = deg2rad(static_cast<double>(point.lat));
+  const double y = (1. - std::log(std::tan(lat_rad) + 1. / std::cos(lat_rad)) / M_PI) / 2.;
+  return {x, y};
+}
+
+point pointf_to_point(QPointF pt) noexcept {
+  assert(is_projectable(pt));
+  return point{static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() * pt.x()),
+      static_cast<uint32_t>(std::numeric_limits<uint32_t>::max() * pt.y())};
+}
+
+QPointF pointf_from_point(point pt) noexcept {
+  const double max_coord = std::pow(2., 32.);
+  return {pt.x / max_coord, pt.y / max_coord};
+}
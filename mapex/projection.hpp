@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QtCore/QPointF>
+
+#include <mapex/geo_point.hpp>
+#include <mapex/morton_code.hpp>
+
+/// Projects the point with Web Mercator projection to the unit square with the top left corner at the north west.
+QPointF project(geo_point point) noexcept;
+
+/// Checks if the projected point lies inside of the unit square and can be converted to the key space.
+constexpr bool is_projectable(QPointF pt) noexcept {
+  return pt.x() >= 0.0 && pt.x() < 1.0 && pt.y() >= 0.0 && pt.y() < 1.0;
+}
+
+/// Converts the projected point to the integer coordinates POI keys are built from.
+point pointf_to_point(QPointF pt) noexcept;
+/// Converts the integer coordinates of the POI key back to the projected point.
+QPointF pointf_from_point(point pt) noexcept;
@@ -0,0 +1,58 @@
+#include <string>
+
+#include <mapex/qfile_category.hpp>
+
+const std::error_category& qfile_category() noexcept {
+  static const struct : std::error_category {
+    const char* name() const noexcept override { return "QFileDevice::FileError"; }
+
+    std::string message(int cond) const noexcept override {
+      switch (static_cast<QFileDevice::FileError>(cond)) {
+      case QFileDevice::NoError:
+        return "no error occurred.";
+      case QFileDevice::ReadError:
+        return "an error occurred when reading from the file.";
+      case QFileDevice::WriteError:
+        return "an error occurred when writing to the file.";
+      case QFileDevice::FatalError:
+        return "a fatal error occurred.";
+      case QFileDevice::ResourceError:
+        return "out of resources (e.g., too many open files, out of memory, etc.)";
+      case QFileDevice::OpenError:
+        return "the file could not be opened.";
+      case QFileDevice::AbortError:
+        return "the operation was aborted.";
+      case QFileDevice::TimeOutError:
+        return "a timeout occurred.";
+      case QFileDevice::UnspecifiedError:
+        return "an unspecified error occurred.";
+      case QFileDevice::RemoveError:
+        return "the file could not be removed.";
+      case QFileDevice::RenameError:
+        return "the file could not be renamed.";
+      case QFileDevice::PositionError:
+        return "the position in the file could not be changed.";
+      case QFileDevice::ResizeError:
+        return "the file could not be resized.";
+      case QFileDevice::PermissionsError:
+        return "the file could not be accessed.";
+      case QFileDevice::CopyError:
+        return "the file could not be copied.";
+      }
+      return "Unknown QFileDevice::FileError code: " + std::to_string(cond);
+    }
+
+    bool equivalent(int code, const std::error_condition& cond) const noexcept override {
+      return ((code == QFileDevice::ReadError || code == QFileDevice::WriteError) && cond == std::errc::io_error) ||
+             (code == QFileDevice::PermissionsError && cond == std::errc::permission_denied) ||
+             (code == QFileDevice::AbortError && cond == std::errc::operation_canceled) ||
+             (code == QFileDevice::TimeOutError && cond == std::errc::timed_out);
+    }
+  } inst;
+  return inst;
+}
+
+std::system_error file_error(const QFileDevice& file, const char* operation) {
+  return std::system_error{file.error(),
+      std::string{operation} + " " + file.fileName().toStdString() + ": " + file.errorString().toStdString()};
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <system_error>
+
+#include <QtCore/QFileDevice>
+
+namespace std {
+template <>
+struct is_error_code_enum<QFileDevice::FileError> : std::true_type {};
+} // namespace std
+
+const std::error_category& qfile_category() noexcept;
+
+inline std::error_code make_error_code(QFileDevice::FileError err) noexcept {
+  return {static_cast<int>(err), qfile_category()};
+}
+
+/// Error of the last failed operation on the `file`. The message holds the `operation` name, the file name and the
+/// description provided by Qt which is more specific than the error code.
+std::system_error file_error(const QFileDevice& file, const char* operation);
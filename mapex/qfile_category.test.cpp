@@ -0,0 +1,103 @@
+#include <QtTest/QtTest>
+
+#include <mapex/qfile_category.hpp>
+
+Q_DECLARE_METATYPE(std::errc);
+
+class qfile_category_tests : public QObject {
+  Q_OBJECT
+private:
+  bool starts_with(const std::string& str, const std::string& prefix) {
+    auto mismatch_pos = std::mismatch(str.begin(), str.end(), prefix.begin(), prefix.end());
+    return mismatch_pos.second == prefix.end();
+  }
+
+  void generate_all_errors_dataset() {
+    QTest::addColumn<QFileDevice::FileError>("error");
+
+    QTest::addRow("NoError") << QFileDevice::NoError;
+    QTest::addRow("ReadError") << QFileDevice::ReadError;
+    QTest::addRow("WriteError") << QFileDevice::WriteError;
+    QTest::addRow("FatalError") << QFileDevice::FatalError;
+    QTest::addRow("ResourceError") << QFileDevice::ResourceError;
+    QTest::addRow("OpenError") << QFileDevice::OpenError;
+    QTest::addRow("AbortError") << QFileDevice::AbortError;
+    QTest::addRow("TimeOutError") << QFileDevice::TimeOutError;
+    QTest::addRow("UnspecifiedError") << QFileDevice::UnspecifiedError;
+    QTest::addRow("RemoveError") << QFileDevice::RemoveError;
+    QTest::addRow("RenameError") << QFileDevice::RenameError;
+    QTest::addRow("PositionError") << QFileDevice::PositionError;
+    QTest::addRow("ResizeError") << QFileDevice::ResizeError;
+    QTest::addRow("PermissionsError") << QFileDevice::PermissionsError;
+    QTest::addRow("CopyError") << QFileDevice::CopyError;
+  }
+
+private slots:
+  void NoError_converts_to_zero_error_code() {
+    std::error_code ec = QFileDevice::NoError;
+    QVERIFY(!ec);
+  }
+
+  void ec_value_equals_to_enum_value_data() { generate_all_errors_dataset(); }
+  void ec_value_equals_to_enum_value() {
+    QFETCH(QFileDevice::FileError, error);
+    std::error_code ec = error;
+    QCOMPARE(ec.value(), static_cast<int>(error));
+  }
+
+  void ec_category_is_qfile_category_data() { generate_all_errors_dataset(); }
+  void ec_category_is_qfile_category() {
+    QFETCH(QFileDevice::FileError, error);
+    std::error_code ec = error;
+    QCOMPARE(ec.category(), qfile_category());
+  }
+
+  void ec_message_matches_the_error() {
+    std::error_code ec = QFileDevice::OpenError;
+    QCOMPARE(ec.message(), "the file could not be opened.");
+  }
+
+  void ec_message_is_not_unknown_code_message_data() { generate_all_errors_dataset(); }
+  void ec_message_is_not_unknown_code_message() {
+    QFETCH(QFileDevice::FileError, error);
+    std::error_code ec = error;
+    QVERIFY(!starts_with(ec.message(), "Unknown QFileDevice::FileError code:"));
+  }
+
+  void ec_matches_semantically_equivalent_generic_conditions_data() {
+    QTest::addColumn<QFileDevice::FileError>("error");
+    QTest::addColumn<std::errc>("generic");
+
+    QTest::addRow("ReadError") << QFileDevice::ReadError << std::errc::io_error;
+    QTest::addRow("WriteError") << QFileDevice::WriteError << std::errc::io_error;
+    QTest::addRow("AbortError") << QFileDevice::AbortError << std::errc::operation_canceled;
+    QTest::addRow("TimeOutError") << QFileDevice::TimeOutError << std::errc::timed_out;
+    QTest::addRow("PermissionsError") << QFileDevice::PermissionsError << std::errc::permission_denied;
+  }
+  void ec_matches_semantically_equivalent_generic_conditions() {
+    QFETCH(QFileDevice::FileError, error);
+    QFETCH(std::errc, generic);
+    std::error_code ec = error;
+    std::error_condition cond = generic;
+    QCOMPARE(ec, cond);
+  }
+
+  void ec_matches_same_value_and_category_condition_data() { generate_all_errors_dataset(); }
+  void ec_matches_same_value_and_category_condition() {
+    QFETCH(QFileDevice::FileError, error);
+    std::error_code ec = error;
+    std::error_condition cond{ec.value(), ec.category()};
+    QCOMPARE(ec, cond);
+  }
+
+  void file_error_describes_the_operation_and_file() {
+    QFile file{QStringLiteral("/nonexistent/mapex/poi.bin")};
+    QVERIFY(!file.open(QIODevice::ReadOnly));
+    const std::system_error err = file_error(file, "open");
+    QCOMPARE(err.code(), std::error_code{QFileDevice::OpenError});
+    QVERIFY(starts_with(err.what(), "open /nonexistent/mapex/poi.bin: "));
+  }
+};
+
+QTEST_MAIN(qfile_category_tests)
+#include "qfile_category.test.moc"
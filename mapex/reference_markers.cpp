@@ -0,0 +1,52 @@
+#include <iterator>
+
+#include <mapex/projection.hpp>
+#include <mapex/reference_markers.hpp>
+
+std::vector<marker> reference_merge_generalizations(
+    std::vector<point_group> ads, std::vector<point_group> poi, point vp_min, point vp_max, int z_level) {
+  std::vector<marker> res;
+  std::vector<marker> box_markers;
+  const unsigned group_bit_alignment = cell_coord_bits(z_level) + 1;
+  const uint32_t mask = ~uint32_t{0} << group_bit_alignment;
+  const point vp_min_pt{vp_min.x & mask, vp_min.y & mask};
+  const point vp_max_pt = vp_max;
+
+  const uint32_t box_side = (uint32_t{1} << group_bit_alignment);
+  for (point box_min = vp_min_pt; box_min.x < vp_max_pt.x; box_min.x += box_side / 2) { // TODO: handle overflows
+    for (box_min.y = vp_min_pt.y; box_min.y < vp_max_pt.y; box_min.y += box_side / 2) { // TODO: handle overflows
+      const point box_max = box_min + point{box_side, box_side};                        // TODO: handle overflows
+
+      for (auto it = res.begin(); it != res.end();) {
+        if (!is_in_rect(pointf_to_point(it->point), box_min, box_max)) {
+          ++it;
+          continue;
+        }
+        box_markers.push_back(*it); // No markers in res overlaps. No need to to search and merge overlaps
+        it = res.erase(it);
+      }
+
+      for (auto it = ads.begin(); it != ads.end();) {
+        if (!is_in_rect(it->centroid, box_min, box_max)) {
+          ++it;
+          continue;
+        }
+        merge_marker(box_markers, {pointf_from_point(it->centroid), it->count, true}, box_side / 2);
+        it = ads.erase(it);
+      }
+
+      for (auto it = poi.begin(); it != poi.end();) {
+        if (!is_in_rect(it->centroid, box_min, box_max)) {
+          ++it;
+          continue;
+        }
+        merge_marker(box_markers, {pointf_from_point(it->centroid), it->count, false}, box_side / 2);
+        it = poi.erase(it);
+      }
+      std::move(box_markers.begin(), box_markers.end(), std::back_inserter(res));
+      box_markers.clear();
+    }
+  }
+  return res;
+}
+
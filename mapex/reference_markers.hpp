@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include <mapex/generalization.hpp>
+#include <mapex/markers.hpp>
+#include <mapex/morton_code.hpp>
+
+/// Same as `merge_generalizations` but scans all groups and markers for every box. Quadratic in the number of groups,
+/// kept as a reference for tests and benchmarks.
+std::vector<marker> reference_merge_generalizations(
+    std::vector<point_group> ads, std::vector<point_group> poi, point vp_min, point vp_max, int z_level);
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/search_index.hpp>
+
+namespace {
+
+// Each iteration of the benchmark performs this many searches so the reported time divided by it is the latency of
+// a single search.
+constexpr size_t queries_count = 0x1000;
+
+} // namespace
+
+class search_index_benchmarks : public QObject {
+  Q_OBJECT
+private slots:
+  void initTestCase() {
+    std::uniform_int_distribution<uint64_t> dist;
+    queries_.resize(queries_count);
+    std::generate(queries_.begin(), queries_.end(), [&] { return dist(rnd_engine_); });
+  }
+
+  void lower_bound_latency_data() {
+    QTest::addColumn<bool>("indexed");
+    QTest::addColumn<int>("size_log2");
+
+    for (int size_log2 = 10; size_log2 <= 24; size_log2 += 2) {
+      QTest::addRow("std/2^%d", size_log2) << false << size_log2;
+      QTest::addRow("index/2^%d", size_log2) << true << size_log2;
+    }
+  }
+  void lower_bound_latency() {
+    QFETCH(bool, indexed);
+    QFETCH(int, size_log2);
+
+    std::uniform_int_distribution<uint64_t> dist;
+    std::vector<uint64_t> keys(size_t{1} << size_log2);
+    std::generate(keys.begin(), keys.end(), [&] { return dist(rnd_engine_); });
+    std::sort(keys.begin(), keys.end());
+    const search_index index{keys};
+
+    // Every query depends on the result of the previous one so the searches are not overlapped by the CPU
+    size_t pos = 0;
+    QBENCHMARK {
+      for (uint64_t key : queries_) {
+        key ^= pos & 1;
+        pos = indexed ? index.lower_bound(keys, key)
+                      : static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+      }
+    }
+    sink_ = pos;
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+  std::vector<uint64_t> queries_;
+  volatile size_t sink_ = 0;
+};
+
+QTEST_MAIN(search_index_benchmarks)
+#include "search_index.bench.moc"
@@ -0,0 +1,76 @@
+#include <algorithm>
+
+#include <mapex/search_index.hpp>
+
+namespace {
+
+template <typename Node, typename Key>
+size_t count_less(const Node& node, Key key) noexcept {
+  size_t res = 0;
+  for (Key node_key : node.keys)
+    res += node_key < key ? 1 : 0;
+  return res;
+}
+
+void prefetch(const void* first, const void* last) noexcept {
+  for (auto it = static_cast<const char*>(first); it < static_cast<const char*>(last); it += 64)
+    __builtin_prefetch(it);
+}
+
+} // namespace
+
+template <typename Key>
+basic_search_index<Key>::basic_search_index(const std::vector<Key>& keys) {
+  // Number of keys on the level below the one being built excluding padding
+  size_t count = keys.size();
+  if (count <= node_size)
+    return;
+  do {
+    const size_t blocks = (count + node_size - 1) / node_size;
+    node padding;
+    std::fill(std::begin(padding.keys), std::end(padding.keys), ~Key{0});
+    std::vector<node> level((blocks + node_size - 1) / node_size, padding);
+    for (size_t block = 0; block < blocks; ++block) {
+      const size_t last = std::min(block * node_size + node_size, count) - 1;
+      level[block / node_size].keys[block % node_size] =
+          levels_.empty() ? keys[last] : levels_.back()[last / node_size].keys[last % node_size];
+    }
+    levels_.push_back(std::move(level));
+    count = blocks;
+  } while (count > node_size);
+  root_size_ = count;
+}
+
+template <typename Key>
+size_t basic_search_index<Key>::lower_bound(const std::vector<Key>& keys, Key key) const noexcept {
+  if (levels_.empty())
+    return static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+
+  // Padding keys are never less then `key` so the root counts all of its real keys only if `key` is greater then any
+  // of the keys.
+  size_t pos = count_less(levels_.back().front(), key);
+  if (pos == root_size_)
+    return keys.size();
+  for (size_t level = levels_.size() - 1; level-- > 0;) {
+    // Children of a node are adjacent so all of them are prefetched while the node itself is examined
+    if (level > 0) {
+      const auto& children = levels_[level - 1];
+      const size_t first = pos * node_size;
+      prefetch(children.data() + first, children.data() + std::min(first + node_size, children.size()));
+    } else {
+      const size_t first = pos * node_size * node_size;
+      prefetch(keys.data() + first, keys.data() + std::min(first + node_size * node_size, keys.size()));
+    }
+    pos = pos * node_size + count_less(levels_[level][pos], key);
+  }
+
+  const size_t first = pos * node_size;
+  const size_t last = std::min(first + node_size, keys.size());
+  size_t res = first;
+  for (size_t i = first; i < last; ++i)
+    res += keys[i] < key ? 1 : 0;
+  return res;
+}
+
+template class basic_search_index<uint64_t>;
+template class basic_search_index<uint32_t>;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Static search tree over sorted keys. Inner nodes are cache line sized blocks holding maximal keys of their children
+/// (S+ tree). Leaves are blocks of the keys array itself so the keys are neither copied nor reordered and positions
+/// returned are valid positions in the original array. Tree takes about 1/7 of the keys array size. Narrower keys get
+/// more keys per node and a shallower tree.
+template <typename Key>
+class basic_search_index {
+public:
+  basic_search_index() = default;
+  explicit basic_search_index(const std::vector<Key>& keys);
+
+  /// Returns the position of the first key in `keys` not less then `key` same as `std::lower_bound` does. Must be used
+  /// with the same keys array the index was created from.
+  size_t lower_bound(const std::vector<Key>& keys, Key key) const noexcept;
+
+private:
+  static constexpr size_t node_size = 64 / sizeof(Key);
+  struct alignas(64) node {
+    Key keys[node_size];
+  };
+  static_assert(sizeof(node) == 64, "node must occupy exactly one cache line");
+
+  // levels_[0] is the lowest inner level with a key per a leaf block, levels_.back() is the root node.
+  std::vector<std::vector<node>> levels_;
+  size_t root_size_ = 0;
+};
+
+/// Index over the full 64 bit keys.
+using search_index = basic_search_index<uint64_t>;
+
+/// Sorted keys optionally accompanied with a search index over them.
+template <typename Key>
+struct basic_sorted_keys {
+  basic_sorted_keys(const std::vector<Key>& keys, const basic_search_index<Key>* index = nullptr) noexcept
+      : keys{keys}, index{index} {}
+
+  const std::vector<Key>& keys;
+  const basic_search_index<Key>* index;
+};
+
+using sorted_keys = basic_sorted_keys<uint64_t>;
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <QtTest/QtTest>
+
+#include <mapex/search_index.hpp>
+
+class search_index_tests : public QObject {
+  Q_OBJECT
+private:
+  template <typename Key = uint64_t>
+  std::vector<Key> gen_keys(size_t count, Key max_key) {
+    std::uniform_int_distribution<Key> dist{0, max_key};
+    std::vector<Key> res(count);
+    std::generate(res.begin(), res.end(), [&] { return dist(rnd_engine_); });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+private slots:
+  void lower_bound_matches_std_lower_bound_data() {
+    QTest::addColumn<size_t>("count");
+    QTest::addColumn<uint64_t>("max_key");
+
+    for (size_t count : {0u, 1u, 7u, 8u, 9u, 63u, 64u, 65u, 511u, 512u, 513u, 4097u, 100'000u}) {
+      QTest::addRow("unique/%d", static_cast<int>(count)) << count << ~uint64_t{0};
+      QTest::addRow("with_duplicates/%d", static_cast<int>(count)) << count << uint64_t{count / 4};
+    }
+  }
+  void lower_bound_matches_std_lower_bound() {
+    QFETCH(size_t, count);
+    QFETCH(uint64_t, max_key);
+
+    const std::vector<uint64_t> keys = gen_keys(count, max_key);
+    const search_index index{keys};
+    std::vector<uint64_t> queries = gen_keys(1000, max_key);
+    queries.insert(queries.end(), keys.begin(), keys.end());
+    queries.insert(queries.end(), {0, 1, max_key, ~uint64_t{0}});
+    for (uint64_t key : queries) {
+      const auto expected = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+      QCOMPARE(index.lower_bound(keys, key), expected);
+    }
+  }
+
+  void max_keys_are_not_confused_with_padding() {
+    std::vector<uint64_t> keys(100, ~uint64_t{0});
+    keys[0] = 5;
+    const search_index index{keys};
+    QCOMPARE(index.lower_bound(keys, 0), size_t{0});
+    QCOMPARE(index.lower_bound(keys, 6), size_t{1});
+    QCOMPARE(index.lower_bound(keys, ~uint64_t{0}), size_t{1});
+  }
+
+  // 32 bit keys have twice as many keys per node
+  void narrow_keys_lower_bound_matches_std_lower_bound_data() {
+    QTest::addColumn<size_t>("count");
+    QTest::addColumn<uint32_t>("max_key");
+
+    for (size_t count : {0u, 1u, 15u, 16u, 17u, 255u, 256u, 257u, 4097u, 100'000u}) {
+      QTest::addRow("unique/%d", static_cast<int>(count)) << count << ~uint32_t{0};
+      QTest::addRow("with_duplicates/%d", static_cast<int>(count)) << count << static_cast<uint32_t>(count / 4);
+    }
+  }
+  void narrow_keys_lower_bound_matches_std_lower_bound() {
+    QFETCH(size_t, count);
+    QFETCH(uint32_t, max_key);
+
+    const std::vector<uint32_t> keys = gen_keys(count, max_key);
+    const basic_search_index<uint32_t> index{keys};
+    std::vector<uint32_t> queries = gen_keys(1000, max_key);
+    queries.insert(queries.end(), keys.begin(), keys.end());
+    queries.insert(queries.end(), {0, 1, max_key, ~uint32_t{0}});
+    for (uint32_t key : queries) {
+      const auto expected = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+      QCOMPARE(index.lower_bound(keys, key), expected);
+    }
+  }
+
+private:
+  std::default_random_engine rnd_engine_;
+};
+
+QTEST_MAIN(search_index_tests)
+#include "search_index.test.moc"
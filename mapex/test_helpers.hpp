@@ -0,0 +1,23 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <mapex/generalization.hpp>
+#include <mapex/morton_code.hpp>
+
+// Helpers shared by the tests. Results of different query paths are compared after sorting them with these since the
+// order depends on the curve and the way the keys are stored.
+
+inline std::vector<point> sorted(std::vector<point> points) {
+  std::sort(points.begin(), points.end(), [](point l, point r) { return std::pair{l.x, l.y} < std::pair{r.x, r.y}; });
+  return points;
+}
+
+inline std::vector<point_group> sorted(std::vector<point_group> groups) {
+  std::sort(groups.begin(), groups.end(), [](const point_group& l, const point_group& r) {
+    return std::pair{l.centroid.x, l.centroid.y} < std::pair{r.centroid.x, r.centroid.y};
+  });
+  return groups;
+}
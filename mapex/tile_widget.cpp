@@ -7,26 +7,17 @@
 #include <portable_concurrency/future>
 
 #include <mapex/network_thread.hpp>
+#include <mapex/projection.hpp>
 #include <mapex/tile_loader.hpp>
 #include <mapex/tile_widget.hpp>
 
 namespace {
 
-constexpr double deg2rad(double deg) noexcept { return deg * M_PI / 180.; }
-
 constexpr int tile_pixel_size = 256;
 constexpr int max_z_level = 16;
 constexpr QSize tile_size{tile_pixel_size, tile_pixel_size};
 constexpr QSize poi_icon_size{24, 24};
 
-QPointF project(geo_point point) noexcept {
-  const double x = (static_cast<double>(point.lon) + 180.) / 360.;
-
-  const double lat_rad = deg2rad(static_cast<double>(point.lat));
-  const double y = (1. - std::log(std::tan(lat_rad) + 1. / std::cos(lat_rad)) / M_PI) / 2.;
-  return {x, y};
-}
-
 QPoint floor(QPointF point) noexcept {
   return {static_cast<int>(std::floor(point.x())), static_cast<int>(std::floor(point.y()))};
 }